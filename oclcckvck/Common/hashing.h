@@ -12,6 +12,53 @@ namespace hashing {
 
 	
 
+/*! SHA-256 compression functions, see sha256.cpp. Blocks are 64 bytes as they appear in the message, so words are big endian.
+States are the eight working variables in host order, the same as AbstractSHA_bits::h. */
+namespace sha256 {
+
+typedef std::array<auint, 8> State;
+
+inline State IV() {
+	State hstart;
+	hstart[0] = 0x6a09e667; //2^32 times the square root of the first 8 primes 2..19
+	hstart[1] = 0xbb67ae85;
+	hstart[2] = 0x3c6ef372;
+	hstart[3] = 0xa54ff53a;
+	hstart[4] = 0x510e527f;
+	hstart[5] = 0x9b05688c;
+	hstart[6] = 0x1f83d9ab;
+	hstart[7] = 0x5be0cd19;
+	return hstart;
+}
+
+//! Code paths the functions below can take, as bits.
+enum Feature {
+	SSE2 = 1, //!< 4 independent blocks at once
+	AVX2 = 2, //!< 8 independent blocks at once
+	SHA_NI = 4 //!< one block at a time with the SHA extensions
+};
+
+//! Features supported by the CPU and the OS, probed once.
+auint Available();
+
+/*! All available features are used by default. Restricting them is mostly useful to compare the various paths.
+Not thread safe, set it before hashing. */
+void Enable(auint features);
+auint Enabled();
+
+//! Portable version, which is also the fallback.
+void CompressScalar(State &h, const aubyte *block);
+
+//! Compress a single block, using the SHA extensions if enabled.
+void Compress(State &h, const aubyte *block);
+
+/*! Compress block[i] into h[i] for each i in [0..count). Those are independent messages so they are processed in lockstep
+8 or 4 at a time when AVX2 or SSE2 are enabled, unless the SHA extensions are enabled, which are faster one block at a time. */
+void Compress(State *h, const aubyte *const *block, asizei count);
+
+}
+
+
 /*! A bit of warning about the LenType parameter.
 The SHA standard mandates the use of a 64-bit length and SHA blocks must be sized according to that length.
 However, some implementation only use 32bit length. They still reserve 8 bytes, but only use 4.
@@ -20,20 +67,19 @@ len=0x1234ABCD					len=0x000000001234ABCD
 written as (last eight bytes), big endian
 CDAB4312						CDAB431200000000
 Which is a very different thing. Therefore, before writing the length, it will be cast to the appropriate
-type. Blocks are still sized with an 8 bit length anyway. */
-template<auint HASH_BITS, typename LenType>
+type. Blocks are still sized with an 8 bit length anyway.
+
+Derived is the final hasher class (CRTP), it must provide BlockProcessing and a static GetIV. Those were virtual,
+costing an indirect call for each block of each nonce in PBKDF2 and friends. */
+template<auint HASH_BITS, typename LenType, typename Derived>
 class AbstractSHA_bits {
 protected:
 	std::array<auint, HASH_BITS / (4 * 8)> h;
 	std::array<aubyte, 64> pad;
 	aulong bytesProcessed;
-	virtual std::array<auint, HASH_BITS / 32> GetIV() const = 0;
 public:
 	AbstractSHA_bits() : bytesProcessed(0) { if(sizeof(LenType) > sizeof(aulong)) throw std::exception("SHA have length count up to 64 bits."); }
 
-	//! Ouch! This might be a performance path! Hopefully an optimizing compiler will de-virtualize it.
-	virtual void BlockProcessing(const aubyte *chunk) = 0;
-
 	asizei GetBlockSize() const { return sizeof(pad); }
 	asizei GetHashSize() const  { return sizeof(h); };
 	typedef std::array<aubyte, HASH_BITS / 8> Digest;
@@ -51,7 +97,7 @@ public:
 		return serializer;
 	}
 	void Restart() {
-		std::array<auint, HASH_BITS / 32> hstart(GetIV());
+		std::array<auint, HASH_BITS / 32> hstart(Derived::GetIV());
 		memcpy_s(h.data(), sizeof(h), hstart.data(), sizeof(hstart));
 		bytesProcessed = 0;
 	}
@@ -62,8 +108,9 @@ public:
 	\note this can really mangle multiple blocks, as long as the last is partial and is the
 	closing one. */
 	void EndBlocks(const aubyte *msg, asizei count) {
+		Derived &self(static_cast<Derived&>(*this));
 		while(count >= GetBlockSize()) {
-			BlockProcessing(msg);
+			self.BlockProcessing(msg);
 			msg += GetBlockSize();
 			count -= GetBlockSize();
 		}
@@ -78,7 +125,7 @@ public:
 			DestinationStream serializer(pad.data() + off, sizeof(pad) - off);
 			serializer<<bitLen;
 		}
-		BlockProcessing(pad.data());
+		self.BlockProcessing(pad.data());
 		if(count + sizeof(aulong) < sizeof(pad)) return;
 		// If here, either the length overflows or we have been explicitly asked to put it in
 		// another block. No real difference.
@@ -86,74 +133,27 @@ public:
 		asizei off = sizeof(pad) - sizeof(LenType);
 		DestinationStream serializer(pad.data() + off, sizeof(LenType));
 		serializer<<bitLen;
-		BlockProcessing(pad.data());
+		self.BlockProcessing(pad.data());
 	}
 };
 
 
 template<typename LenType>
-class VariableLengthSHA256 : public AbstractSHA_bits<256, LenType> {
-private:
-	static auint SigmaO(auint v) { return _rotr(v,  7) ^ _rotr(v, 18) ^    (v >>  3); };
-	static auint SigmaI(auint v) { return _rotr(v, 17) ^ _rotr(v, 19) ^    (v >> 10); };
-	static auint SumO(auint v)   { return _rotr(v,  2) ^ _rotr(v, 13) ^ _rotr(v, 22); };
-	static auint SumI(auint v)   { return _rotr(v,  6) ^ _rotr(v, 11) ^ _rotr(v, 25); };
-	static auint Ch(auint x, auint y, auint z)  { return (x & y) ^ (~x & z); };
-	static auint Maj(auint x, auint y, auint z) { return (x & y) ^ ( x & z) ^ (y & z); };
-
-	std::array<auint, 8> GetIV() const {
-		std::array<auint, 8> hstart;
-		hstart[0] = 0x6a09e667; //2^32 times the square root of the first 8 primes 2..19
-		hstart[1] = 0xbb67ae85;
-		hstart[2] = 0x3c6ef372;
-		hstart[3] = 0xa54ff53a;
-		hstart[4] = 0x510e527f;
-		hstart[5] = 0x9b05688c;
-		hstart[6] = 0x1f83d9ab;
-		hstart[7] = 0x5be0cd19;
-		return hstart;
-	}
+class VariableLengthSHA256 : public AbstractSHA_bits<256, LenType, VariableLengthSHA256<LenType> > {
+	typedef AbstractSHA_bits<256, LenType, VariableLengthSHA256<LenType> > Base;
+	friend class AbstractSHA_bits<256, LenType, VariableLengthSHA256<LenType> >;
+	using Base::h;
+	using Base::pad;
+	using Base::bytesProcessed;
+
+	static std::array<auint, 8> GetIV() { return sha256::IV(); }
 public:
+	typedef typename Base::Digest Digest;
+	using Base::Restart;
+	using Base::EndBlocks;
+
 	void BlockProcessing(const aubyte *chunk) {
-		const auint K[64] = {
-			0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
-			0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
-			0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
-			0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
-			0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
-			0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
-			0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
-			0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
-		};
-		std::array<auint, 64> w;
-		const auint *cbytes = reinterpret_cast<const auint*>(chunk);
-		for(size_t cp = 0; cp < 16; cp++) w[cp] = HTON(cbytes[cp]);
-		for(size_t cp = 16; cp < 64; cp++) {
-			auint so = SigmaO(w[cp - 15]);
-			auint si = SigmaI(w[cp -  2]);
-			w[cp] = w[cp - 16] + so + w[cp - 7] + si;
-		}
-		auint a = h[0],  b  = h[1];
-		auint c = h[2],  d  = h[3];
-		auint e = h[4],  f  = h[5];
-		auint g = h[6],  hp = h[7];
-		for(size_t inner = 0; inner < 64; inner++) {
-			auint t1 = hp + SumI(e) + Ch(e, f, g) + K[inner] + w[inner];
-			auint t2 = SumO(a) + Maj(a, b, c);			
-			hp = g;
-			g = f;
-			f = e;
-			e = d + t1;
-			d = c;
-			c = b;
-			b = a;
-			a = t1 + t2;
-		}
-		// Add the hash to result so far.
-		h[0] += a;  h[1] += b;
-		h[2] += c;  h[3] += d;
-		h[4] += e;	h[5] += f;
-		h[6] += g;	h[7] += hp;
+		sha256::Compress(h, chunk);
 		bytesProcessed += 16 * sizeof(auint);
 	}
 	VariableLengthSHA256() { Restart(); }
@@ -176,9 +176,9 @@ public:
 
 /*! SHA160 is different enough from SHA256 I cannot be bothered in looking to give them a common code base.
 Just copypasting most. \sa VariableLengthSHA256 */
-class SHA160 : public AbstractSHA_bits<160, aulong> {
-private:
-	std::array<auint, 5> GetIV() const {
+class SHA160 : public AbstractSHA_bits<160, aulong, SHA160> {
+	friend class AbstractSHA_bits<160, aulong, SHA160>;
+	static std::array<auint, 5> GetIV() {
 		std::array<auint, 5> hstart;
 		hstart[0] = 0x67452301;
 		hstart[1] = 0xEFCDAB89;
@@ -306,7 +306,7 @@ void PBKDF2(std::array<auint, 32> &output, const std::array<auint, 20> &passwd)
 	memcpy(pad+4, passwdpad, 48);
 	tstate.BlockProcessing(reinterpret_cast<const aubyte*>(pad));
 
-	HASHER::Digest ihashDWORD;
+	typename HASHER::Digest ihashDWORD;
 	tstate.GetHashLE(ihashDWORD);
 	const auint *ihash = reinterpret_cast<const auint*>(ihashDWORD.data());
 	
@@ -373,7 +373,7 @@ void PBKDF2(std::array<aubyte, 8*4> &output, const std::array<auint, 20> &passwd
 		memcpy_s(pad, sizeof(pad), passwd.data() + 16, 4 * 4);
 		memcpy_s(pad + 4, sizeof(pad) - 4 * 4, passwdpad, sizeof(passwdpad));
 		tstate.BlockProcessing(reinterpret_cast<const aubyte*>(pad));
-		HASHER::Digest hash;
+		typename HASHER::Digest hash;
 		tstate.GetHashLE(hash);
 		memcpy_s(ihash, sizeof(ihash), hash.data(), sizeof(hash[0]) * hash.size());
 	}
@@ -398,7 +398,7 @@ void PBKDF2(std::array<aubyte, 8*4> &output, const std::array<auint, 20> &passwd
 		finalBlock[15] = HTON(auint(0x00000620));
 		tstate.BlockProcessing(reinterpret_cast<const aubyte*>(finalBlock));
 
-		HASHER::Digest hash;
+		typename HASHER::Digest hash;
 		tstate.GetHashLE(hash);
 		memcpy_s(pad, sizeof(pad), hash.data(), sizeof(hash));
 		memcpy_s(pad + 8, sizeof(pad) - 8 * 4, outerpad, sizeof(outerpad));
@@ -411,10 +411,126 @@ void PBKDF2(std::array<aubyte, 8*4> &output, const std::array<auint, 20> &passwd
 }
 
 
+/*! Helper for the batched PBKDF2 below: a 64 byte block for each of up to MAX_LANES independent SHA-256 being computed.
+Words are as they would be in memory when calling BlockProcessing on them, so the code mirrors the single hash versions. */
+struct SHA256Blocks {
+	static const asizei MAX_LANES = 8;
+	auint words[MAX_LANES][16];
+	const aubyte *ptr[MAX_LANES];
+	const asizei lanes;
+	explicit SHA256Blocks(asizei count) : lanes(count) {
+		for(asizei lane = 0; lane < MAX_LANES; lane++) ptr[lane] = reinterpret_cast<const aubyte*>(words[lane]);
+	}
+	void Compress(sha256::State *h) const { sha256::Compress(h, ptr, lanes); }
+};
+
+
+/*! First steps of both PBKDF2 flavours: hash the 80 bytes password so ihash[lane] can be used for the HMAC pads.
+Also initializes the pads, key xor constant (ipad or opad) in each word of the first block. */
+inline void PBKDF2HashPassword(sha256::State *ihash, const std::array<auint, 20> *passwd, SHA256Blocks &blocks) {
+	for(asizei lane = 0; lane < blocks.lanes; lane++) {
+		ihash[lane] = sha256::IV();
+		memcpy(blocks.words[lane], passwd[lane].data(), sizeof(blocks.words[lane]));
+	}
+	blocks.Compress(ihash);
+	for(asizei lane = 0; lane < blocks.lanes; lane++) {
+		auint *block = blocks.words[lane];
+		memcpy(block, passwd[lane].data() + 16, 4 * sizeof(auint));
+		memset(block + 4, 0, 12 * sizeof(auint));
+		block[4] = 0x00000080;
+		block[15] = 0x80020000;
+	}
+	blocks.Compress(ihash);
+}
+
+
+inline void PBKDF2StartHMAC(sha256::State *state, const sha256::State *ihash, auint xorValue, SHA256Blocks &blocks) {
+	for(asizei lane = 0; lane < blocks.lanes; lane++) {
+		state[lane] = sha256::IV();
+		for(asizei i = 0; i <  8; i++) blocks.words[lane][i] = HTON(auint(ihash[lane][i] ^ xorValue));
+		for(asizei i = 8; i < 16; i++) blocks.words[lane][i] = HTON(xorValue);
+	}
+	blocks.Compress(state);
+}
+
+
+/*! Batched PBKDF2_SHA256_80_128: output[i] is the same as PBKDF2<SHA256>(output[i], passwd[i]) for i in [0..count).
+Passwords are processed SHA256Blocks::MAX_LANES at a time so each SHA-256 step goes through sha256::Compress for all of them. */
+inline void PBKDF2(std::array<auint, 32> *output, const std::array<auint, 20> *passwd, asizei count) {
+	const asizei MAX_LANES = SHA256Blocks::MAX_LANES;
+	for(asizei base = 0; base < count; base += MAX_LANES) {
+		SHA256Blocks blocks(count - base < MAX_LANES? count - base : MAX_LANES);
+		sha256::State ihash[MAX_LANES], hi[MAX_LANES], ho[MAX_LANES], istate[MAX_LANES], ostate[MAX_LANES];
+		PBKDF2HashPassword(ihash, passwd + base, blocks);
+		PBKDF2StartHMAC(hi, ihash, 0x36363636, blocks);
+		for(asizei lane = 0; lane < blocks.lanes; lane++) memcpy(blocks.words[lane], passwd[base + lane].data(), sizeof(blocks.words[lane]));
+		blocks.Compress(hi);
+		PBKDF2StartHMAC(ho, ihash, 0x5c5c5c5c, blocks);
+		for(auint block = 0; block < 4; block++) {
+			for(asizei lane = 0; lane < blocks.lanes; lane++) {
+				auint *words = blocks.words[lane];
+				istate[lane] = hi[lane];
+				memcpy(words, passwd[base + lane].data() + 16, 4 * sizeof(auint));
+				words[4] = HTON(block + 1);
+				memset(words + 5, 0, 11 * sizeof(auint));
+				words[5] = 0x00000080;
+				words[15] = 0xa0040000;
+			}
+			blocks.Compress(istate);
+			for(asizei lane = 0; lane < blocks.lanes; lane++) {
+				auint *words = blocks.words[lane];
+				ostate[lane] = ho[lane];
+				for(asizei cp = 0; cp < 8; cp++) words[cp] = HTON(istate[lane][cp]);
+				memset(words + 8, 0, 8 * sizeof(auint));
+				words[8] = 0x00000080;
+				words[15] = 0x00030000;
+			}
+			blocks.Compress(ostate);
+			for(asizei lane = 0; lane < blocks.lanes; lane++) {
+				for(auint cp = 0; cp < 8; cp++) output[base + lane][block * 8 + cp] = HTON(ostate[lane][cp]);
+			}
+		}
+	}
+}
+
+
+//! Batched version of the salted PBKDF2 above, same as calling it for each i in [0..count).
+inline void PBKDF2(std::array<aubyte, 8*4> *output, const std::array<auint, 20> *passwd, const std::array<auint, 32> *salt, asizei count) {
+	const asizei MAX_LANES = SHA256Blocks::MAX_LANES;
+	for(asizei base = 0; base < count; base += MAX_LANES) {
+		SHA256Blocks blocks(count - base < MAX_LANES? count - base : MAX_LANES);
+		sha256::State ihash[MAX_LANES], ostate[MAX_LANES], tstate[MAX_LANES];
+		PBKDF2HashPassword(ihash, passwd + base, blocks);
+		PBKDF2StartHMAC(ostate, ihash, 0x5c5c5c5c, blocks);
+		PBKDF2StartHMAC(tstate, ihash, 0x36363636, blocks);
+		for(asizei half = 0; half < 2; half++) {
+			for(asizei lane = 0; lane < blocks.lanes; lane++) memcpy(blocks.words[lane], salt[base + lane].data() + half * 16, sizeof(blocks.words[lane]));
+			blocks.Compress(tstate);
+		}
+		for(asizei lane = 0; lane < blocks.lanes; lane++) {
+			auint *words = blocks.words[lane];
+			memset(words, 0, sizeof(blocks.words[lane]));
+			words[ 0] = HTON(auint(0x00000001));
+			words[ 1] = HTON(auint(0x80000000));
+			words[15] = HTON(auint(0x00000620));
+		}
+		blocks.Compress(tstate);
+		for(asizei lane = 0; lane < blocks.lanes; lane++) {
+			auint *words = blocks.words[lane];
+			for(asizei cp = 0; cp < 8; cp++) words[cp] = HTON(tstate[lane][cp]);
+			memset(words + 8, 0, 8 * sizeof(auint));
+			words[8] = 0x00000080;
+			words[15] = 0x00030000;
+		}
+		blocks.Compress(ostate);
+		for(asizei lane = 0; lane < blocks.lanes; lane++) memcpy_s(output[base + lane].data(), sizeof(output[base + lane]), ostate[lane].data(), sizeof(ostate[lane]));
+	}
+}
+
+
+//! The memory hard part of Scrypt, X goes from the first PBKDF2 result to the salt of the second.
 template<auint N>
-void Scrypt(std::array<aubyte, 32> &result, const std::array<auint, 20> &header, std::array<auint, 4 * 8 * N> &pad) {
-	std::array<auint, 32> X;
-	hashing::PBKDF2<hashing::SHA256>(X, header);
+void ROMix(std::array<auint, 32> &X, std::array<auint, 4 * 8 * N> &pad) {
 	for(auint loop = 0; loop < N; loop++) {
 		for(asizei cp = 0; cp < 32; cp++) pad[loop * 32 + cp] = X[cp];
 		hashing::DoubleSalsa20<8>(X);
@@ -424,7 +540,66 @@ void Scrypt(std::array<aubyte, 32> &result, const std::array<auint, 20> &header,
 		for(auint k = 0; k < 32; k++) X[k] ^= pad[j * 32 + k]; // let the compiler figure out what to do, don't mess with uint64
 		hashing::DoubleSalsa20<8>(X);
 	}
+}
+
+
+template<auint N>
+void Scrypt(std::array<aubyte, 32> &result, const std::array<auint, 20> &header, std::array<auint, 4 * 8 * N> &pad) {
+	std::array<auint, 32> X;
+	hashing::PBKDF2<hashing::SHA256>(X, header);
+	ROMix<N>(X, pad);
 	hashing::PBKDF2<hashing::SHA256>(result, header, X);
 }
 
+
+/*! Scrypt for result[i] and header[i], i in [0..count). PBKDF2 steps go through the batched versions,
+ROMix still runs one header at a time using the same pad. */
+template<auint N>
+void Scrypt(std::array<aubyte, 32> *result, const std::array<auint, 20> *header, asizei count, std::array<auint, 4 * 8 * N> &pad) {
+	const asizei MAX_LANES = SHA256Blocks::MAX_LANES;
+	std::array<auint, 32> X[MAX_LANES];
+	for(asizei base = 0; base < count; base += MAX_LANES) {
+		const asizei lanes = count - base < MAX_LANES? count - base : MAX_LANES;
+		PBKDF2(X, header + base, lanes);
+		for(asizei lane = 0; lane < lanes; lane++) ROMix<N>(X[lane], pad);
+		PBKDF2(result + base, header + base, X, lanes);
+	}
+}
+
+
+/*! Scratch memory for the batched hashing functions. It only grows and is reused across calls so the hot loops do not allocate.
+Each thread gets its own by ThisThread(). VS2013 has no thread_local so nothing destroys it when the thread exits: every thread
+which might hash puts a ThreadScope in its thread function, or the arena leaks. */
+class ScratchArena {
+public:
+	ScratchArena() : block(nullptr), size(0) { }
+	~ScratchArena();
+	//! 64 byte aligned, content undefined. Previous pointers are invalidated.
+	void* Get(asizei bytes);
+	static ScratchArena& ThisThread();
+	static void ReleaseThisThread();
+
+	//! Releases the arena of the calling thread when going out of scope, even by an exception.
+	class ThreadScope {
+	public:
+		ThreadScope() { }
+		~ThreadScope() { ReleaseThisThread(); }
+	private:
+		ThreadScope(const ThreadScope&);
+		ThreadScope& operator=(const ThreadScope&);
+	};
+private:
+	void *block;
+	asizei size;
+	ScratchArena(const ScratchArena&);
+	ScratchArena& operator=(const ScratchArena&);
+};
+
+
+/*! Scrypt with N given at runtime so the same code serves the various Scrypt-N: result[i] for header[i], i in [0..count).
+Headers are processed up to 8 at a time. PBKDF2 goes through the batched version, ROMix keeps a header in each SIMD lane
+with 8 lanes for AVX2 and 4 for SSE2, following sha256::Enable. Leftovers run one by one. Pads, N * 128 bytes for each lane,
+come from ScratchArena::ThisThread(). */
+void Scrypt(std::array<aubyte, 32> *result, const std::array<auint, 20> *header, asizei count, auint N);
+
 }
@@ -0,0 +1,196 @@
+/*
+ * Copyright (C) 2015 Massimo Del Zotto
+ * This code is released under the MIT license.
+ * For conditions of distribution and use, see the LICENSE or hit the web.
+ */
+#include "hashing.h"
+#include <malloc.h>
+#include <immintrin.h>
+#include <new>
+
+namespace hashing {
+
+
+static __declspec(thread) ScratchArena *threadArena = nullptr;
+
+
+ScratchArena::~ScratchArena() {
+	if(block) _aligned_free(block);
+}
+
+
+void* ScratchArena::Get(asizei bytes) {
+	if(bytes <= size) return block;
+	asizei grow = size * 2;
+	if(grow < bytes) grow = bytes;
+	if(block) _aligned_free(block);
+	block = nullptr;
+	size = 0;
+	block = _aligned_malloc(grow, 64);
+	if(!block) throw std::bad_alloc();
+	size = grow;
+	return block;
+}
+
+
+ScratchArena& ScratchArena::ThisThread() {
+	if(!threadArena) threadArena = new ScratchArena;
+	return *threadArena;
+}
+
+
+void ScratchArena::ReleaseThisThread() {
+	delete threadArena;
+	threadArena = nullptr;
+}
+
+
+//! Same as ROMix<N> but N is a parameter. pad must be at least N * 32 uints.
+static void ROMix1(std::array<auint, 32> &X, auint *pad, auint N) {
+	for(auint loop = 0; loop < N; loop++) {
+		for(asizei cp = 0; cp < 32; cp++) pad[loop * 32 + cp] = X[cp];
+		DoubleSalsa20<8>(X);
+	}
+	for(auint loop = 0; loop < N; loop++) {
+		const auint j(X[16] % N);
+		for(auint k = 0; k < 32; k++) X[k] ^= pad[j * 32 + k];
+		DoubleSalsa20<8>(X);
+	}
+}
+
+
+/* Multi-lane ROMix, each vector holds the same word of LANES different X. Salsa20/8 is written in terms of the
+quarter-round: see the scalar Salsa20 for the order, here it is spelled out. The pad is interleaved, word k of
+block i for lane l is at (i * 32 + k) * LANES + l so writes are plain vector stores. Reads are at different
+indices for each lane and are gathered with scalar loads. */
+#define SALSA_QR(a, b, c, d) \
+	w[b] = V_XOR(w[b], V_ROTL(V_ADD(w[a], w[d]),  7)); \
+	w[c] = V_XOR(w[c], V_ROTL(V_ADD(w[b], w[a]),  9)); \
+	w[d] = V_XOR(w[d], V_ROTL(V_ADD(w[c], w[b]), 13)); \
+	w[a] = V_XOR(w[a], V_ROTL(V_ADD(w[d], w[c]), 18));
+
+#define SALSA8_LANES_BODY \
+	V w[16]; \
+	for(asizei i = 0; i < 16; i++) { \
+		B[i] = V_XOR(B[i], Bx[i]); \
+		w[i] = B[i]; \
+	} \
+	for(auint round = 0; round < 8; round += 2) { \
+		SALSA_QR( 0,  4,  8, 12) \
+		SALSA_QR( 5,  9, 13,  1) \
+		SALSA_QR(10, 14,  2,  6) \
+		SALSA_QR(15,  3,  7, 11) \
+		SALSA_QR( 0,  1,  2,  3) \
+		SALSA_QR( 5,  6,  7,  4) \
+		SALSA_QR(10, 11,  8,  9) \
+		SALSA_QR(15, 12, 13, 14) \
+	} \
+	for(asizei i = 0; i < 16; i++) B[i] = V_ADD(B[i], w[i]);
+
+#define ROMIX_LANES_BODY(LANES, SALSA) \
+	V x[32]; \
+	auint lane[LANES]; \
+	for(asizei k = 0; k < 32; k++) { \
+		for(asizei l = 0; l < LANES; l++) lane[l] = X[l][k]; \
+		x[k] = V_LOAD(lane); \
+	} \
+	V *vpad = reinterpret_cast<V*>(pad); \
+	for(auint loop = 0; loop < N; loop++) { \
+		for(asizei k = 0; k < 32; k++) vpad[loop * 32 + k] = x[k]; \
+		SALSA(x, x + 16); \
+		SALSA(x + 16, x); \
+	} \
+	auint j[LANES]; \
+	for(auint loop = 0; loop < N; loop++) { \
+		V_STORE(j, x[16]); \
+		for(asizei l = 0; l < LANES; l++) j[l] = (j[l] % N) * 32 * LANES + l; \
+		for(asizei k = 0; k < 32; k++) { \
+			for(asizei l = 0; l < LANES; l++) lane[l] = pad[j[l] + k * LANES]; \
+			x[k] = V_XOR(x[k], V_LOAD(lane)); \
+		} \
+		SALSA(x, x + 16); \
+		SALSA(x + 16, x); \
+	} \
+	for(asizei k = 0; k < 32; k++) { \
+		V_STORE(lane, x[k]); \
+		for(asizei l = 0; l < LANES; l++) X[l][k] = lane[l]; \
+	}
+
+#define V __m128i
+#define V_LOAD(p) _mm_loadu_si128(reinterpret_cast<const __m128i*>(p))
+#define V_STORE(p, v) _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v)
+#define V_ADD _mm_add_epi32
+#define V_XOR _mm_xor_si128
+#define V_ROTL(v, n) _mm_or_si128(_mm_slli_epi32(v, n), _mm_srli_epi32(v, 32 - (n)))
+
+static void Salsa8x4(V *B, const V *Bx) {
+	SALSA8_LANES_BODY
+}
+
+//! pad must be 16 byte aligned and have room for N * 32 * 4 uints.
+static void ROMix4(std::array<auint, 32> *X, auint *pad, auint N) {
+	ROMIX_LANES_BODY(4, Salsa8x4)
+}
+
+#undef V
+#undef V_LOAD
+#undef V_STORE
+#undef V_ADD
+#undef V_XOR
+#undef V_ROTL
+
+#define V __m256i
+#define V_LOAD(p) _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p))
+#define V_STORE(p, v) _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v)
+#define V_ADD _mm256_add_epi32
+#define V_XOR _mm256_xor_si256
+#define V_ROTL(v, n) _mm256_or_si256(_mm256_slli_epi32(v, n), _mm256_srli_epi32(v, 32 - (n)))
+
+static void Salsa8x8(V *B, const V *Bx) {
+	SALSA8_LANES_BODY
+}
+
+//! pad must be 32 byte aligned and have room for N * 32 * 8 uints.
+static void ROMix8(std::array<auint, 32> *X, auint *pad, auint N) {
+	ROMIX_LANES_BODY(8, Salsa8x8)
+	_mm256_zeroupper();
+}
+
+#undef V
+#undef V_LOAD
+#undef V_STORE
+#undef V_ADD
+#undef V_XOR
+#undef V_ROTL
+#undef ROMIX_LANES_BODY
+#undef SALSA8_LANES_BODY
+#undef SALSA_QR
+
+
+void Scrypt(std::array<aubyte, 32> *result, const std::array<auint, 20> *header, asizei count, auint N) {
+	if(N == 0) throw std::exception("Scrypt N must be at least 1.");
+	const auint use = sha256::Enabled();
+	const asizei maxLanes = (use & sha256::AVX2)? 8 : ((use & sha256::SSE2)? 4 : 1);
+	const asizei padBytes = 32 * sizeof(auint) * maxLanes;
+	if(N > asizei(-1) / padBytes) throw std::exception("Scrypt N too big, pads would not fit in the address space.");
+	auint *pad = reinterpret_cast<auint*>(ScratchArena::ThisThread().Get(N * padBytes));
+
+	const asizei MAX_LANES = SHA256Blocks::MAX_LANES;
+	std::array<auint, 32> X[MAX_LANES];
+	for(asizei base = 0; base < count; base += MAX_LANES) {
+		const asizei lanes = count - base < MAX_LANES? count - base : MAX_LANES;
+		PBKDF2(X, header + base, lanes);
+		asizei done = 0;
+		if(use & sha256::AVX2) {
+			for(; lanes - done >= 8; done += 8) ROMix8(X + done, pad, N);
+		}
+		if(use & sha256::SSE2) {
+			for(; lanes - done >= 4; done += 4) ROMix4(X + done, pad, N);
+		}
+		for(; done < lanes; done++) ROMix1(X[done], pad, N);
+		PBKDF2(result + base, header + base, X, lanes);
+	}
+}
+
+
+}
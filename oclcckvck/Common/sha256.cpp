@@ -0,0 +1,249 @@
+/*
+ * Copyright (C) 2015 Massimo Del Zotto
+ * This code is released under the MIT license.
+ * For conditions of distribution and use, see the LICENSE or hit the web.
+ */
+#include "hashing.h"
+#include <intrin.h>
+#include <immintrin.h>
+
+namespace hashing {
+namespace sha256 {
+
+
+static const auint K[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+
+static auint Probe() {
+	int regs[4];
+	__cpuid(regs, 0);
+	const int maxLeaf = regs[0];
+	__cpuid(regs, 1);
+	auint ret = (regs[3] & (1 << 26))? SSE2 : 0;
+	const bool osxsave = (regs[2] & (1 << 27)) != 0;
+	const bool sse41 = (regs[2] & (1 << 19)) != 0;
+	if(maxLeaf < 7) return ret;
+	__cpuidex(regs, 7, 0);
+	if((regs[1] & (1 << 29)) && sse41) ret |= SHA_NI;
+	if((regs[1] & (1 << 5)) && osxsave && (_xgetbv(0) & 6) == 6) ret |= AVX2; // the OS must save YMM registers too
+	return ret;
+}
+
+static const auint available = Probe();
+static auint enabled = ~0u;
+
+
+auint Available() { return available; }
+void Enable(auint features) { enabled = features; }
+auint Enabled() { return available & enabled; }
+
+
+static auint SigmaO(auint v) { return _rotr(v,  7) ^ _rotr(v, 18) ^    (v >>  3); };
+static auint SigmaI(auint v) { return _rotr(v, 17) ^ _rotr(v, 19) ^    (v >> 10); };
+static auint SumO(auint v)   { return _rotr(v,  2) ^ _rotr(v, 13) ^ _rotr(v, 22); };
+static auint SumI(auint v)   { return _rotr(v,  6) ^ _rotr(v, 11) ^ _rotr(v, 25); };
+static auint Ch(auint x, auint y, auint z)  { return (x & y) ^ (~x & z); };
+static auint Maj(auint x, auint y, auint z) { return (x & y) ^ ( x & z) ^ (y & z); };
+
+
+void CompressScalar(State &h, const aubyte *chunk) {
+	std::array<auint, 64> w;
+	const auint *cbytes = reinterpret_cast<const auint*>(chunk);
+	for(size_t cp = 0; cp < 16; cp++) w[cp] = HTON(cbytes[cp]);
+	for(size_t cp = 16; cp < 64; cp++) {
+		auint so = SigmaO(w[cp - 15]);
+		auint si = SigmaI(w[cp -  2]);
+		w[cp] = w[cp - 16] + so + w[cp - 7] + si;
+	}
+	auint a = h[0],  b  = h[1];
+	auint c = h[2],  d  = h[3];
+	auint e = h[4],  f  = h[5];
+	auint g = h[6],  hp = h[7];
+	for(size_t inner = 0; inner < 64; inner++) {
+		auint t1 = hp + SumI(e) + Ch(e, f, g) + K[inner] + w[inner];
+		auint t2 = SumO(a) + Maj(a, b, c);
+		hp = g;
+		g = f;
+		f = e;
+		e = d + t1;
+		d = c;
+		c = b;
+		b = a;
+		a = t1 + t2;
+	}
+	// Add the hash to result so far.
+	h[0] += a;  h[1] += b;
+	h[2] += c;  h[3] += d;
+	h[4] += e;  h[5] += f;
+	h[6] += g;  h[7] += hp;
+}
+
+
+/* Multi-buffer: each vector holds the same variable for LANES different messages. The round function is the scalar one,
+written with the macros below which are defined differently for SSE2 and AVX2. Moving words between the lanes and the
+blocks/states is done with scalar loads and stores, it is a small fraction of the 64 rounds. */
+#define SHA256_LANES_BODY(LANES) \
+	V w[64]; \
+	auint lane[LANES]; \
+	for(asizei cp = 0; cp < 16; cp++) { \
+		for(asizei l = 0; l < LANES; l++) lane[l] = _byteswap_ulong(reinterpret_cast<const auint*>(block[l])[cp]); \
+		w[cp] = V_LOAD(lane); \
+	} \
+	for(asizei cp = 16; cp < 64; cp++) { \
+		const V so = V_XOR(V_XOR(V_ROTR(w[cp - 15],  7), V_ROTR(w[cp - 15], 18)), V_SHR(w[cp - 15],  3)); \
+		const V si = V_XOR(V_XOR(V_ROTR(w[cp -  2], 17), V_ROTR(w[cp -  2], 19)), V_SHR(w[cp -  2], 10)); \
+		w[cp] = V_ADD(V_ADD(w[cp - 16], so), V_ADD(w[cp - 7], si)); \
+	} \
+	V s[8]; \
+	for(asizei i = 0; i < 8; i++) { \
+		for(asizei l = 0; l < LANES; l++) lane[l] = h[l][i]; \
+		s[i] = V_LOAD(lane); \
+	} \
+	V a = s[0], b = s[1], c = s[2], d = s[3]; \
+	V e = s[4], f = s[5], g = s[6], hp = s[7]; \
+	for(asizei inner = 0; inner < 64; inner++) { \
+		const V sumI = V_XOR(V_XOR(V_ROTR(e, 6), V_ROTR(e, 11)), V_ROTR(e, 25)); \
+		const V ch = V_XOR(V_AND(e, f), V_ANDNOT(e, g)); \
+		const V t1 = V_ADD(V_ADD(V_ADD(hp, sumI), V_ADD(ch, V_SET1(K[inner]))), w[inner]); \
+		const V sumO = V_XOR(V_XOR(V_ROTR(a, 2), V_ROTR(a, 13)), V_ROTR(a, 22)); \
+		const V maj = V_XOR(V_AND(a, b), V_AND(c, V_XOR(a, b))); \
+		hp = g; \
+		g = f; \
+		f = e; \
+		e = V_ADD(d, t1); \
+		d = c; \
+		c = b; \
+		b = a; \
+		a = V_ADD(t1, V_ADD(sumO, maj)); \
+	} \
+	s[0] = a;  s[1] = b;  s[2] = c;  s[3] = d; \
+	s[4] = e;  s[5] = f;  s[6] = g;  s[7] = hp; \
+	for(asizei i = 0; i < 8; i++) { \
+		V_STORE(lane, s[i]); \
+		for(asizei l = 0; l < LANES; l++) h[l][i] += lane[l]; \
+	}
+
+#define V __m128i
+#define V_LOAD(p) _mm_loadu_si128(reinterpret_cast<const __m128i*>(p))
+#define V_STORE(p, v) _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v)
+#define V_SET1(x) _mm_set1_epi32(int(x))
+#define V_ADD _mm_add_epi32
+#define V_XOR _mm_xor_si128
+#define V_AND _mm_and_si128
+#define V_ANDNOT _mm_andnot_si128
+#define V_SHR _mm_srli_epi32
+#define V_ROTR(v, n) _mm_or_si128(_mm_srli_epi32(v, n), _mm_slli_epi32(v, 32 - (n)))
+
+static void Compress4(State *h, const aubyte *const *block) {
+	SHA256_LANES_BODY(4)
+}
+
+#undef V
+#undef V_LOAD
+#undef V_STORE
+#undef V_SET1
+#undef V_ADD
+#undef V_XOR
+#undef V_AND
+#undef V_ANDNOT
+#undef V_SHR
+#undef V_ROTR
+
+#define V __m256i
+#define V_LOAD(p) _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p))
+#define V_STORE(p, v) _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v)
+#define V_SET1(x) _mm256_set1_epi32(int(x))
+#define V_ADD _mm256_add_epi32
+#define V_XOR _mm256_xor_si256
+#define V_AND _mm256_and_si256
+#define V_ANDNOT _mm256_andnot_si256
+#define V_SHR _mm256_srli_epi32
+#define V_ROTR(v, n) _mm256_or_si256(_mm256_srli_epi32(v, n), _mm256_slli_epi32(v, 32 - (n)))
+
+static void Compress8(State *h, const aubyte *const *block) {
+	SHA256_LANES_BODY(8)
+	_mm256_zeroupper(); // avoid the AVX to SSE transition penalty in the caller
+}
+
+#undef V
+#undef V_LOAD
+#undef V_STORE
+#undef V_SET1
+#undef V_ADD
+#undef V_XOR
+#undef V_AND
+#undef V_ANDNOT
+#undef V_SHR
+#undef V_ROTR
+#undef SHA256_LANES_BODY
+
+
+/* SHA extensions. The state is kept as ABEF and CDGH, each SHA256RNDS2 does two rounds. Message schedule for the next
+four rounds is computed four words at a time by SHA256MSG1/SHA256MSG2, msg[g % 4] holding the words for rounds 4g..4g+3. */
+static void CompressSHANI(State &h, const aubyte *block) {
+	const __m128i bswap = _mm_set_epi64x(0x0c0d0e0f08090a0bull, 0x0405060700010203ull);
+	__m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(h.data())), 0xB1); // CDAB
+	__m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(h.data() + 4)), 0x1B); // EFGH
+	__m128i state0 = _mm_alignr_epi8(tmp, state1, 8); // ABEF
+	state1 = _mm_blend_epi16(state1, tmp, 0xF0); // CDGH
+	const __m128i abefStart = state0, cdghStart = state1;
+	__m128i msg[4];
+	for(asizei g = 0; g < 4; g++) msg[g] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(block + g * 16)), bswap);
+	for(asizei g = 0; g < 16; g++) {
+		const __m128i &cur(msg[g % 4]);
+		__m128i wk = _mm_add_epi32(cur, _mm_loadu_si128(reinterpret_cast<const __m128i*>(K + g * 4)));
+		state1 = _mm_sha256rnds2_epu32(state1, state0, wk);
+		if(g >= 3 && g <= 14) {
+			__m128i &next(msg[(g + 1) % 4]);
+			next = _mm_add_epi32(next, _mm_alignr_epi8(cur, msg[(g + 3) % 4], 4));
+			next = _mm_sha256msg2_epu32(next, cur);
+		}
+		wk = _mm_shuffle_epi32(wk, 0x0E);
+		state0 = _mm_sha256rnds2_epu32(state0, state1, wk);
+		if(g >= 1 && g <= 12) {
+			__m128i &prev(msg[(g + 3) % 4]);
+			prev = _mm_sha256msg1_epu32(prev, cur);
+		}
+	}
+	state0 = _mm_add_epi32(state0, abefStart);
+	state1 = _mm_add_epi32(state1, cdghStart);
+	tmp = _mm_shuffle_epi32(state0, 0x1B); // FEBA
+	state1 = _mm_shuffle_epi32(state1, 0xB1); // DCHG
+	state0 = _mm_blend_epi16(tmp, state1, 0xF0); // DCBA
+	state1 = _mm_alignr_epi8(state1, tmp, 8); // HGFE
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(h.data()), state0);
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(h.data() + 4), state1);
+}
+
+
+void Compress(State &h, const aubyte *block) {
+	if(Enabled() & SHA_NI) CompressSHANI(h, block);
+	else CompressScalar(h, block);
+}
+
+
+void Compress(State *h, const aubyte *const *block, asizei count) {
+	const auint use = Enabled();
+	if(!(use & SHA_NI)) {
+		if(use & AVX2) {
+			for(; count >= 8; count -= 8, h += 8, block += 8) Compress8(h, block);
+		}
+		if(use & SSE2) {
+			for(; count >= 4; count -= 4, h += 4, block += 4) Compress4(h, block);
+		}
+	}
+	for(asizei i = 0; i < count; i++) Compress(h[i], block[i]);
+}
+
+
+}
+}
@@ -0,0 +1,84 @@
+/*
+ * AES-NI detection and selection, see sph_aesni.h.
+ *
+ * ==========================(LICENSE BEGIN)============================
+ *
+ * Copyright (c) 2007-2010  Projet RNRT SAPHIR
+ * Copyright (C) 2015 Massimo Del Zotto
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * ===========================(LICENSE END)=============================
+ */
+
+
+#include "sph_aesni.h"
+
+#if SPH_AESNI
+#if defined _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+/* -1 until CPUID is queried; the race to set it is harmless */
+static int aesni_available = -1;
+static int aesni_allowed = 1;
+
+/* see sph_aesni.h */
+int
+sph_aesni_available(void)
+{
+#if SPH_AESNI
+	if (aesni_available < 0) {
+#if defined _MSC_VER
+		int regs[4];
+
+		__cpuid(regs, 1);
+		aesni_available = (regs[2] >> 25) & 1;
+#else
+		unsigned eax, ebx, ecx, edx;
+
+		if (__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+			aesni_available = (ecx >> 25) & 1;
+		else
+			aesni_available = 0;
+#endif
+	}
+	return aesni_available;
+#else
+	return 0;
+#endif
+}
+
+/* see sph_aesni.h */
+void
+sph_aesni_enable(int enable)
+{
+	aesni_allowed = enable != 0;
+}
+
+/* see sph_aesni.h */
+int
+sph_aesni_enabled(void)
+{
+	return aesni_allowed && sph_aesni_available();
+}
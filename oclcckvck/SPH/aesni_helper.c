@@ -0,0 +1,56 @@
+/*
+ * AES-NI helpers. Like aes_helper.c, this file is not meant to be
+ * compiled by itself; it is included by the hash functions having an
+ * AES-NI version of their AES rounds. Those functions must be marked
+ * with SPH_AESNI_TARGET and only called when sph_aesni_enabled() says
+ * so, see sph_aesni.h.
+ *
+ * AESENC with an all-zero key is the same as AES_ROUND_NOKEY_LE() on
+ * the four little-endian words of the register; with key K0..K3 in
+ * the words it is AES_ROUND_LE().
+ *
+ * ==========================(LICENSE BEGIN)============================
+ *
+ * Copyright (c) 2007-2010  Projet RNRT SAPHIR
+ * Copyright (C) 2015 Massimo Del Zotto
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * ===========================(LICENSE END)=============================
+ */
+
+#include "sph_aesni.h"
+
+#if SPH_AESNI
+
+#include <emmintrin.h>
+#include <wmmintrin.h>
+
+/*
+ * GCC and clang enable AES-NI per function so the rest of the code
+ * still runs on older CPUs. MSVC always allows the intrinsics.
+ */
+#if (defined __GNUC__ || defined __clang__) && !defined __AES__
+#define SPH_AESNI_TARGET   __attribute__((target("aes,sse2")))
+#else
+#define SPH_AESNI_TARGET
+#endif
+
+#endif
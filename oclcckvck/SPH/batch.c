@@ -0,0 +1,364 @@
+/*
+ * Batched hashing, see sph_batch.h.
+ *
+ * ==========================(LICENSE BEGIN)============================
+ *
+ * Copyright (c) 2007-2010  Projet RNRT SAPHIR
+ * Copyright (C) 2015 Massimo Del Zotto
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * ===========================(LICENSE END)=============================
+ */
+
+#include <stddef.h>
+#include <string.h>
+
+#include "sph_batch.h"
+#include "sph_echo.h"
+#include "sph_simd.h"
+#include "sph_luffa.h"
+#include "sph_cubehash.h"
+#include "sph_shavite.h"
+#include "sph_groestl.h"
+
+#if SPH_BATCH_SSE2
+#include <emmintrin.h>
+#if defined _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+/* see luffa.c and simd.c */
+void sph_luffa512_4way(const sph_luffa512_context *initial,
+	const void *data, size_t len, void *dst);
+void sph_simd512_4way(const sph_simd512_context *initial,
+	const void *data, size_t len, void *dst);
+#if SPH_BATCH_AVX2
+void sph_luffa512_8way(const sph_luffa512_context *initial,
+	const void *data, size_t len, void *dst);
+void sph_simd512_8way(const sph_simd512_context *initial,
+	const void *data, size_t len, void *dst);
+#endif
+#endif
+
+/* 0 until CPUID is queried; the race to set it is harmless */
+static unsigned lanes_available = 0;
+static unsigned lanes_allowed = 8;
+
+#if SPH_BATCH_AVX2
+
+/*
+ * AVX2 also needs the OS to save the YMM registers.
+ */
+static int
+avx2_available(void)
+{
+#if defined _MSC_VER
+	int regs[4];
+
+	__cpuid(regs, 0);
+	if (regs[0] < 7)
+		return 0;
+	__cpuid(regs, 1);
+	if (!((regs[2] >> 27) & 1))
+		return 0;
+	__cpuidex(regs, 7, 0);
+	return ((regs[1] >> 5) & 1) && (_xgetbv(0) & 6) == 6;
+#else
+	unsigned eax, ebx, ecx, edx, xcr0;
+
+	if (__get_cpuid_max(0, 0) < 7)
+		return 0;
+	__cpuid(1, eax, ebx, ecx, edx);
+	if (!((ecx >> 27) & 1))
+		return 0;
+	__cpuid_count(7, 0, eax, ebx, ecx, edx);
+	__asm__ ("xgetbv" : "=a" (xcr0), "=d" (edx) : "c" (0));
+	return ((ebx >> 5) & 1) && (xcr0 & 6) == 6;
+#endif
+}
+
+#endif
+
+/* see sph_batch.h */
+unsigned
+sph_batch_lanes_available(void)
+{
+	if (lanes_available == 0) {
+#if SPH_BATCH_AVX2
+		lanes_available = avx2_available() ? 8 : 4;
+#elif SPH_BATCH_SSE2
+		lanes_available = 4;
+#else
+		lanes_available = 1;
+#endif
+	}
+	return lanes_available;
+}
+
+/* see sph_batch.h */
+void
+sph_batch_max_lanes(unsigned lanes)
+{
+	lanes_allowed = lanes;
+}
+
+/* see sph_batch.h */
+unsigned
+sph_batch_lanes(void)
+{
+	unsigned lanes = sph_batch_lanes_available();
+
+	if (lanes > lanes_allowed)
+		lanes = lanes_allowed >= 4 ? 4 : 1;
+	return lanes;
+}
+
+/*
+ * All the contexts can be cloned by copying them so the initial state,
+ * including the prefix, is computed once and copied for each message.
+ */
+#define BATCH_ONE_AT_A_TIME(name)   \
+static void \
+name ## _serial(const sph_ ## name ## _context *initial, \
+	const unsigned char *data, size_t len, size_t count, unsigned char *out) \
+{ \
+	sph_ ## name ## _context cc; \
+	for (; count > 0; count --, data += len, out += 64) { \
+		memcpy(&cc, initial, sizeof cc); \
+		sph_ ## name(&cc, data, len); \
+		sph_ ## name ## _close(&cc, out); \
+	} \
+}
+
+#define BATCH_API(name)   \
+void \
+sph_ ## name ## _batch(const void *prefix, size_t prefix_len, \
+	const void *data, size_t len, size_t count, void *dst) \
+{ \
+	sph_ ## name ## _context initial; \
+	sph_ ## name ## _init(&initial); \
+	if (prefix_len > 0) \
+		sph_ ## name(&initial, prefix, prefix_len); \
+	name ## _serial(&initial, data, len, count, dst); \
+}
+
+BATCH_ONE_AT_A_TIME(echo512)
+BATCH_ONE_AT_A_TIME(simd512)
+BATCH_ONE_AT_A_TIME(luffa512)
+BATCH_ONE_AT_A_TIME(cubehash512)
+BATCH_ONE_AT_A_TIME(shavite512)
+BATCH_ONE_AT_A_TIME(groestl512)
+
+BATCH_API(echo512)
+BATCH_API(shavite512)
+BATCH_API(groestl512)
+
+/*
+ * Luffa and SIMD take any prefix, the lanes start by copying the bytes
+ * the initial context has buffered.
+ */
+#define BATCH_LANES_API(name)   \
+void \
+sph_ ## name ## _batch(const void *prefix, size_t prefix_len, \
+	const void *data, size_t len, size_t count, void *dst) \
+{ \
+	sph_ ## name ## _context initial; \
+	const unsigned char *src = data; \
+	unsigned char *out = dst; \
+	unsigned lanes = sph_batch_lanes(); \
+	sph_ ## name ## _init(&initial); \
+	if (prefix_len > 0) \
+		sph_ ## name(&initial, prefix, prefix_len); \
+	BATCH_LANES_8(name, lanes); \
+	BATCH_LANES_4(name, lanes); \
+	name ## _serial(&initial, src, len, count, out); \
+}
+
+#if SPH_BATCH_AVX2
+#define BATCH_LANES_8(name, lanes)   do { \
+		if (lanes == 8) { \
+			for (; count >= 8; count -= 8, src += 8 * len, out += 8 * 64) \
+				sph_ ## name ## _8way(&initial, src, len, out); \
+		} \
+	} while (0)
+#else
+#define BATCH_LANES_8(name, lanes)   (void)0
+#endif
+
+#if SPH_BATCH_SSE2
+#define BATCH_LANES_4(name, lanes)   do { \
+		if (lanes >= 4) { \
+			for (; count >= 4; count -= 4, src += 4 * len, out += 4 * 64) \
+				sph_ ## name ## _4way(&initial, src, len, out); \
+		} \
+	} while (0)
+#else
+#define BATCH_LANES_4(name, lanes)   (void)0
+#endif
+
+BATCH_LANES_API(simd512)
+BATCH_LANES_API(luffa512)
+
+#if SPH_BATCH_SSE2
+
+/*
+ * CubeHash state is 32 words, here each __m128i holds the same word of
+ * 4 different messages. Rounds are written as in the specification,
+ * with explicit swaps; cubehash.c renames variables instead.
+ */
+#define ROTL4(v, n)   _mm_or_si128(_mm_slli_epi32(v, n), _mm_srli_epi32(v, 32 - (n)))
+#define SWAP4(a, b)   do { __m128i tmp = (a); (a) = (b); (b) = tmp; } while (0)
+
+/*
+ * Loops are unrolled by hand so swaps are on constant indices and the
+ * compiler can turn them into register renames.
+ */
+#define ADD_ROTL(j, n)   do { \
+		x[(j) + 16] = _mm_add_epi32(x[(j) + 16], x[j]); \
+		x[j] = ROTL4(x[j], n); \
+	} while (0)
+
+#define ADD_ROTL_ALL(n)   do { \
+		ADD_ROTL( 0, n); ADD_ROTL( 1, n); ADD_ROTL( 2, n); ADD_ROTL( 3, n); \
+		ADD_ROTL( 4, n); ADD_ROTL( 5, n); ADD_ROTL( 6, n); ADD_ROTL( 7, n); \
+		ADD_ROTL( 8, n); ADD_ROTL( 9, n); ADD_ROTL(10, n); ADD_ROTL(11, n); \
+		ADD_ROTL(12, n); ADD_ROTL(13, n); ADD_ROTL(14, n); ADD_ROTL(15, n); \
+	} while (0)
+
+#define XOR_HIGH(j)   x[j] = _mm_xor_si128(x[j], x[(j) + 16])
+
+#define XOR_HIGH_ALL   do { \
+		XOR_HIGH( 0); XOR_HIGH( 1); XOR_HIGH( 2); XOR_HIGH( 3); \
+		XOR_HIGH( 4); XOR_HIGH( 5); XOR_HIGH( 6); XOR_HIGH( 7); \
+		XOR_HIGH( 8); XOR_HIGH( 9); XOR_HIGH(10); XOR_HIGH(11); \
+		XOR_HIGH(12); XOR_HIGH(13); XOR_HIGH(14); XOR_HIGH(15); \
+	} while (0)
+
+static void
+cubehash_rounds_4way(__m128i *x, int rounds)
+{
+	int r;
+
+	for (r = 0; r < rounds; r ++) {
+		ADD_ROTL_ALL(7);
+		SWAP4(x[0], x[8]);   SWAP4(x[1], x[9]);
+		SWAP4(x[2], x[10]);  SWAP4(x[3], x[11]);
+		SWAP4(x[4], x[12]);  SWAP4(x[5], x[13]);
+		SWAP4(x[6], x[14]);  SWAP4(x[7], x[15]);
+		XOR_HIGH_ALL;
+		SWAP4(x[16], x[18]); SWAP4(x[17], x[19]);
+		SWAP4(x[20], x[22]); SWAP4(x[21], x[23]);
+		SWAP4(x[24], x[26]); SWAP4(x[25], x[27]);
+		SWAP4(x[28], x[30]); SWAP4(x[29], x[31]);
+		ADD_ROTL_ALL(11);
+		SWAP4(x[0], x[4]);   SWAP4(x[1], x[5]);
+		SWAP4(x[2], x[6]);   SWAP4(x[3], x[7]);
+		SWAP4(x[8], x[12]);  SWAP4(x[9], x[13]);
+		SWAP4(x[10], x[14]); SWAP4(x[11], x[15]);
+		XOR_HIGH_ALL;
+		SWAP4(x[16], x[17]); SWAP4(x[18], x[19]);
+		SWAP4(x[20], x[21]); SWAP4(x[22], x[23]);
+		SWAP4(x[24], x[25]); SWAP4(x[26], x[27]);
+		SWAP4(x[28], x[29]); SWAP4(x[30], x[31]);
+	}
+}
+
+/*
+ * Input 32 bytes from each of the 4 messages starting at msg, each
+ * message being stride bytes after the previous.
+ */
+static void
+cubehash_input_4way(__m128i *x, const unsigned char *msg, size_t stride)
+{
+	int w;
+
+	for (w = 0; w < 8; w ++) {
+		__m128i in = _mm_set_epi32(
+			(int)sph_dec32le(msg + 3 * stride + 4 * w),
+			(int)sph_dec32le(msg + 2 * stride + 4 * w),
+			(int)sph_dec32le(msg + 1 * stride + 4 * w),
+			(int)sph_dec32le(msg + 4 * w));
+		x[w] = _mm_xor_si128(x[w], in);
+	}
+}
+
+/*
+ * Hashes 4 messages of len bytes, starting from a state which has no
+ * buffered data.
+ */
+static void
+cubehash512_4way(const sph_cubehash512_context *initial,
+	const unsigned char *data, size_t len, unsigned char *out)
+{
+	__m128i x[32];
+	unsigned char last[4 * 32];
+	size_t blocks, tail;
+	size_t b;
+	int j, lane;
+
+	for (j = 0; j < 32; j ++)
+		x[j] = _mm_set1_epi32((int)initial->state[j]);
+	blocks = len / 32;
+	tail = len % 32;
+	for (b = 0; b < blocks; b ++) {
+		cubehash_input_4way(x, data + b * 32, len);
+		cubehash_rounds_4way(x, 16);
+	}
+	memset(last, 0, sizeof last);
+	for (lane = 0; lane < 4; lane ++) {
+		memcpy(last + lane * 32, data + lane * len + blocks * 32, tail);
+		last[lane * 32 + tail] = 0x80;
+	}
+	cubehash_input_4way(x, last, 32);
+	cubehash_rounds_4way(x, 16);
+	x[31] = _mm_xor_si128(x[31], _mm_set1_epi32(1));
+	cubehash_rounds_4way(x, 10 * 16);
+	for (j = 0; j < 16; j ++) {
+		sph_u32 word[4];
+		_mm_storeu_si128((__m128i *)word, x[j]);
+		for (lane = 0; lane < 4; lane ++)
+			sph_enc32le(out + lane * 64 + 4 * j, word[lane]);
+	}
+}
+
+#endif
+
+void
+sph_cubehash512_batch(const void *prefix, size_t prefix_len,
+	const void *data, size_t len, size_t count, void *dst)
+{
+	sph_cubehash512_context initial;
+	const unsigned char *src = data;
+	unsigned char *out = dst;
+
+	sph_cubehash512_init(&initial);
+	if (prefix_len > 0)
+		sph_cubehash512(&initial, prefix, prefix_len);
+#if SPH_BATCH_SSE2
+	if (initial.ptr == 0 && sph_batch_lanes() >= 4) {
+		for (; count >= 4; count -= 4, src += 4 * len, out += 4 * 64)
+			cubehash512_4way(&initial, src, len, out);
+	}
+#endif
+	cubehash512_serial(&initial, src, len, count, out);
+}
@@ -68,6 +68,7 @@
 
 #define AES_BIG_ENDIAN   0
 #include "aes_helper.c"
+#include "aesni_helper.c"
 
 #if SPH_ECHO_64
 
@@ -707,22 +708,100 @@ echo_big_init(sph_echo_big_context *sc, unsigned out_len)
 	sc->C0 = sc->C1 = sc->C2 = sc->C3 = 0;
 }
 
+#if SPH_AESNI
+static void echo_small_compress_aesni(sph_echo_small_context *sc);
+static void echo_big_compress_aesni(sph_echo_big_context *sc);
+#endif
+
 static void
 echo_small_compress(sph_echo_small_context *sc)
 {
 	DECL_STATE_SMALL
 
+#if SPH_AESNI
+	if (sph_aesni_enabled()) {
+		echo_small_compress_aesni(sc);
+		return;
+	}
+#endif
 	COMPRESS_SMALL(sc);
 }
 
 static void
 echo_big_compress(sph_echo_big_context *sc)
+{
+	DECL_STATE_BIG
+
+#if SPH_AESNI
+	if (sph_aesni_enabled()) {
+		echo_big_compress_aesni(sc);
+		return;
+	}
+#endif
+	COMPRESS_BIG(sc);
+}
+
+#if SPH_AESNI
+
+/*
+ * Both W layouts are 16 AES states of 16 bytes each, in memory order.
+ * Only the AES rounds change, shift rows and mix columns stay the same
+ * so the table code above is reused by redefining BIG_SUB_WORDS.
+ */
+static SPH_AESNI_TARGET void
+aesni_2rounds_all(void *W,
+	sph_u32 *pK0, sph_u32 *pK1, sph_u32 *pK2, sph_u32 *pK3)
+{
+	__m128i *X = (__m128i *)W;
+	__m128i zero = _mm_setzero_si128();
+	int n;
+	sph_u32 K0 = *pK0;
+	sph_u32 K1 = *pK1;
+	sph_u32 K2 = *pK2;
+	sph_u32 K3 = *pK3;
+
+	for (n = 0; n < 16; n ++) {
+		__m128i x = _mm_loadu_si128(X + n);
+		__m128i k = _mm_set_epi32((int)K3, (int)K2, (int)K1, (int)K0);
+
+		x = _mm_aesenc_si128(x, k);
+		x = _mm_aesenc_si128(x, zero);
+		_mm_storeu_si128(X + n, x);
+		if ((K0 = T32(K0 + 1)) == 0) {
+			if ((K1 = T32(K1 + 1)) == 0)
+				if ((K2 = T32(K2 + 1)) == 0)
+					K3 = T32(K3 + 1);
+		}
+	}
+	*pK0 = K0;
+	*pK1 = K1;
+	*pK2 = K2;
+	*pK3 = K3;
+}
+
+#undef BIG_SUB_WORDS
+#define BIG_SUB_WORDS   do { \
+		aesni_2rounds_all(W, &K0, &K1, &K2, &K3); \
+	} while (0)
+
+static SPH_AESNI_TARGET void
+echo_small_compress_aesni(sph_echo_small_context *sc)
+{
+	DECL_STATE_SMALL
+
+	COMPRESS_SMALL(sc);
+}
+
+static SPH_AESNI_TARGET void
+echo_big_compress_aesni(sph_echo_big_context *sc)
 {
 	DECL_STATE_BIG
 
 	COMPRESS_BIG(sc);
 }
 
+#endif
+
 static void
 echo_small_core(sph_echo_small_context *sc,
 	const unsigned char *data, size_t len)
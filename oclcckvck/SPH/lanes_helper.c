@@ -0,0 +1,157 @@
+/*
+ * Vector helpers for hashing several messages at once. Like md_helper.c,
+ * this file is not meant to be compiled by itself; it is included by the
+ * multi-message versions of the hash functions, once per vector width.
+ * Each vector holds the same 32-bit word of SPH_LANES messages:
+ *
+ *   SPH_LANES == 4   SSE2, functions named with LANES_FN() end in _4way
+ *   SPH_LANES == 8   AVX2, functions named with LANES_FN() end in _8way
+ *
+ * Functions using the vectors must be marked with LANES_TARGET. The AVX2
+ * ones must only be called when sph_batch_lanes() says so, see
+ * sph_batch.h.
+ *
+ * ==========================(LICENSE BEGIN)============================
+ *
+ * Copyright (c) 2007-2010  Projet RNRT SAPHIR
+ * Copyright (C) 2015 Massimo Del Zotto
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * ===========================(LICENSE END)=============================
+ */
+
+#undef LV
+#undef LANES_FN
+#undef LANES_TARGET
+#undef LV_SET1
+#undef LV_LOAD
+#undef LV_STORE
+#undef LV_XOR
+#undef LV_AND
+#undef LV_OR
+#undef LV_ADD
+#undef LV_SUB
+#undef LV_SHL
+#undef LV_SHR
+#undef LV_SAR
+#undef LV_GT
+#undef LV_SET16
+#undef LV_MUL16
+#undef LV_MULHU16
+
+#if SPH_LANES == 4
+
+#include <emmintrin.h>
+
+#define LV               __m128i
+#define LANES_FN(name)   name ## _4way
+#define LANES_TARGET
+#define LV_SET1(x)       _mm_set1_epi32((int)(x))
+#define LV_LOAD(p)       _mm_loadu_si128((const __m128i *)(p))
+#define LV_STORE(p, v)   _mm_storeu_si128((__m128i *)(p), v)
+#define LV_XOR(a, b)     _mm_xor_si128(a, b)
+#define LV_AND(a, b)     _mm_and_si128(a, b)
+#define LV_OR(a, b)      _mm_or_si128(a, b)
+#define LV_ADD(a, b)     _mm_add_epi32(a, b)
+#define LV_SUB(a, b)     _mm_sub_epi32(a, b)
+#define LV_SHL(v, n)     _mm_slli_epi32(v, n)
+#define LV_SHR(v, n)     _mm_srli_epi32(v, n)
+#define LV_SAR(v, n)     _mm_srai_epi32(v, n)
+#define LV_GT(a, b)      _mm_cmpgt_epi32(a, b)
+#define LV_SET16(x)      _mm_set1_epi16((short)(x))
+#define LV_MUL16(a, b)   _mm_mullo_epi16(a, b)
+#define LV_MULHU16(a, b) _mm_mulhi_epu16(a, b)
+
+#elif SPH_LANES == 8
+
+#include <immintrin.h>
+
+#define LV               __m256i
+#define LANES_FN(name)   name ## _8way
+
+/*
+ * As for AES-NI, GCC and clang enable AVX2 per function.
+ */
+#if (defined __GNUC__ || defined __clang__) && !defined __AVX2__
+#define LANES_TARGET     __attribute__((target("avx2")))
+#else
+#define LANES_TARGET
+#endif
+
+#define LV_SET1(x)       _mm256_set1_epi32((int)(x))
+#define LV_LOAD(p)       _mm256_loadu_si256((const __m256i *)(p))
+#define LV_STORE(p, v)   _mm256_storeu_si256((__m256i *)(p), v)
+#define LV_XOR(a, b)     _mm256_xor_si256(a, b)
+#define LV_AND(a, b)     _mm256_and_si256(a, b)
+#define LV_OR(a, b)      _mm256_or_si256(a, b)
+#define LV_ADD(a, b)     _mm256_add_epi32(a, b)
+#define LV_SUB(a, b)     _mm256_sub_epi32(a, b)
+#define LV_SHL(v, n)     _mm256_slli_epi32(v, n)
+#define LV_SHR(v, n)     _mm256_srli_epi32(v, n)
+#define LV_SAR(v, n)     _mm256_srai_epi32(v, n)
+#define LV_GT(a, b)      _mm256_cmpgt_epi32(a, b)
+#define LV_SET16(x)      _mm256_set1_epi16((short)(x))
+#define LV_MUL16(a, b)   _mm256_mullo_epi16(a, b)
+#define LV_MULHU16(a, b) _mm256_mulhi_epu16(a, b)
+
+#else
+#error SPH_LANES must be 4 or 8
+#endif
+
+#ifndef LANES_HELPER_COMMON__
+#define LANES_HELPER_COMMON__
+
+#define LV_NOT(v)       LV_XOR(v, LV_SET1(-1))
+#define LV_ROTL(v, n)   LV_OR(LV_SHL(v, n), LV_SHR(v, 32 - (n)))
+
+/*
+ * Copy bytes off to off + blen of the stream of each of the lanes lanes
+ * to blk, blen bytes per lane. The stream of lane i is the ptr bytes
+ * already buffered in the initial context followed by the len bytes at
+ * data + i * len; blk is zero past its end.
+ */
+static void
+lanes_block(unsigned char *blk, size_t blen, int lanes,
+	const unsigned char *buf, size_t ptr,
+	const unsigned char *data, size_t len, size_t off)
+{
+	int i;
+
+	for (i = 0; i < lanes; i ++, blk += blen, data += len) {
+		size_t u, n;
+
+		memset(blk, 0, blen);
+		u = 0;
+		if (off < ptr) {
+			n = ptr - off < blen ? ptr - off : blen;
+			memcpy(blk, buf + off, n);
+			u = n;
+		}
+		if (u < blen && off + u < ptr + len) {
+			size_t src = off + u - ptr;
+
+			n = len - src < blen - u ? len - src : blen - u;
+			memcpy(blk + u, data + src, n);
+		}
+	}
+}
+
+#endif
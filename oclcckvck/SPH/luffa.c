@@ -35,6 +35,7 @@
 #include <limits.h>
 
 #include "sph_luffa.h"
+#include "sph_batch.h"
 
 #if SPH_64_TRUE && !defined SPH_LUFFA_PARALLEL
 #define SPH_LUFFA_PARALLEL   1
@@ -1416,3 +1417,30 @@ sph_luffa512_addbits_and_close(void *cc, unsigned ub, unsigned n, void *dst)
 	luffa5_close(cc, ub, n, dst);
 	sph_luffa512_init(cc);
 }
+
+#if SPH_BATCH_SSE2
+
+/*
+ * sph_luffa512_4way() and sph_luffa512_8way() hash 4 or 8 messages of
+ * len bytes, the ones after the first being at data + len, data + 2 * len
+ * and so on, as if each was appended to a copy of the initial context and
+ * the context closed. The 64 bytes digests are written one after the
+ * other at dst. sph_batch.h tells which ones can run.
+ */
+
+static const sph_u32 *const RC_LANES[5][2] = {
+	{ RC00, RC04 }, { RC10, RC14 }, { RC20, RC24 },
+	{ RC30, RC34 }, { RC40, RC44 }
+};
+
+#define SPH_LANES   4
+#include "luffa_lanes.c"
+#undef SPH_LANES
+
+#if SPH_BATCH_AVX2
+#define SPH_LANES   8
+#include "luffa_lanes.c"
+#undef SPH_LANES
+#endif
+
+#endif
@@ -0,0 +1,204 @@
+/*
+ * Luffa-512 on SPH_LANES messages at once. Not meant to be compiled by
+ * itself: luffa.c includes it once per vector width, see lanes_helper.c.
+ * The code follows MI5 and P5, with the state words in arrays of vectors
+ * instead of variables.
+ *
+ * ==========================(LICENSE BEGIN)============================
+ *
+ * Copyright (c) 2007-2010  Projet RNRT SAPHIR
+ * Copyright (C) 2015 Massimo Del Zotto
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * ===========================(LICENSE END)=============================
+ */
+
+#include "lanes_helper.c"
+
+#ifndef LUFFA_LANES_COMMON__
+#define LUFFA_LANES_COMMON__
+
+#define LM2(d, s)   do { \
+		LV tmp = (s)[7]; \
+		(d)[7] = (s)[6]; \
+		(d)[6] = (s)[5]; \
+		(d)[5] = (s)[4]; \
+		(d)[4] = LV_XOR((s)[3], tmp); \
+		(d)[3] = LV_XOR((s)[2], tmp); \
+		(d)[2] = (s)[1]; \
+		(d)[1] = LV_XOR((s)[0], tmp); \
+		(d)[0] = tmp; \
+	} while (0)
+
+#define LXOR(d, s)   do { \
+		int k; \
+		for (k = 0; k < 8; k ++) \
+			(d)[k] = LV_XOR((d)[k], (s)[k]); \
+	} while (0)
+
+#define LSUB_CRUMB(a0, a1, a2, a3)   do { \
+		LV tmp; \
+		tmp = (a0); \
+		(a0) = LV_OR(a0, a1); \
+		(a2) = LV_XOR(a2, a3); \
+		(a1) = LV_NOT(a1); \
+		(a0) = LV_XOR(a0, a3); \
+		(a3) = LV_AND(a3, tmp); \
+		(a1) = LV_XOR(a1, a3); \
+		(a3) = LV_XOR(a3, a2); \
+		(a2) = LV_AND(a2, a0); \
+		(a0) = LV_NOT(a0); \
+		(a2) = LV_XOR(a2, a1); \
+		(a1) = LV_OR(a1, a3); \
+		tmp = LV_XOR(tmp, a1); \
+		(a3) = LV_XOR(a3, a2); \
+		(a2) = LV_AND(a2, a1); \
+		(a1) = LV_XOR(a1, a0); \
+		(a0) = tmp; \
+	} while (0)
+
+#define LMIX_WORD(u, v)   do { \
+		(v) = LV_XOR(v, u); \
+		(u) = LV_XOR(LV_ROTL(u, 2), v); \
+		(v) = LV_XOR(LV_ROTL(v, 14), u); \
+		(u) = LV_XOR(LV_ROTL(u, 10), v); \
+		(v) = LV_ROTL(v, 1); \
+	} while (0)
+
+#endif
+
+/*
+ * MI5 then P5 on one 32-byte block of each message, blk holding the
+ * blocks one after the other.
+ */
+static LANES_TARGET void
+LANES_FN(luffa5_block)(LV V[5][8], const unsigned char *blk)
+{
+	LV M[8], a[8], b[8];
+	int i, j, r;
+
+	for (j = 0; j < 8; j ++) {
+		sph_u32 w[SPH_LANES];
+
+		for (i = 0; i < SPH_LANES; i ++)
+			w[i] = sph_dec32be(blk + i * 32 + 4 * j);
+		M[j] = LV_LOAD(w);
+	}
+	for (j = 0; j < 8; j ++)
+		a[j] = LV_XOR(LV_XOR(LV_XOR(V[0][j], V[1][j]),
+			LV_XOR(V[2][j], V[3][j])), V[4][j]);
+	LM2(a, a);
+	for (i = 0; i < 5; i ++)
+		LXOR(V[i], a);
+	LM2(b, V[0]);
+	LXOR(b, V[1]);
+	LM2(V[1], V[1]);
+	LXOR(V[1], V[2]);
+	LM2(V[2], V[2]);
+	LXOR(V[2], V[3]);
+	LM2(V[3], V[3]);
+	LXOR(V[3], V[4]);
+	LM2(V[4], V[4]);
+	LXOR(V[4], V[0]);
+	LM2(V[0], b);
+	LXOR(V[0], V[4]);
+	LM2(V[4], V[4]);
+	LXOR(V[4], V[3]);
+	LM2(V[3], V[3]);
+	LXOR(V[3], V[2]);
+	LM2(V[2], V[2]);
+	LXOR(V[2], V[1]);
+	LM2(V[1], V[1]);
+	LXOR(V[1], b);
+	LXOR(V[0], M);
+	for (i = 1; i < 5; i ++) {
+		LM2(M, M);
+		LXOR(V[i], M);
+	}
+
+	for (i = 1; i < 5; i ++) {
+		for (j = 4; j < 8; j ++)
+			V[i][j] = LV_ROTL(V[i][j], i);
+	}
+	for (i = 0; i < 5; i ++) {
+		LV *v = V[i];
+
+		for (r = 0; r < 8; r ++) {
+			LSUB_CRUMB(v[0], v[1], v[2], v[3]);
+			LSUB_CRUMB(v[5], v[6], v[7], v[4]);
+			LMIX_WORD(v[0], v[4]);
+			LMIX_WORD(v[1], v[5]);
+			LMIX_WORD(v[2], v[6]);
+			LMIX_WORD(v[3], v[7]);
+			v[0] = LV_XOR(v[0], LV_SET1(RC_LANES[i][0][r]));
+			v[4] = LV_XOR(v[4], LV_SET1(RC_LANES[i][1][r]));
+		}
+	}
+}
+
+static LANES_TARGET void
+LANES_FN(luffa5_out)(LV V[5][8], unsigned char *out)
+{
+	int i, j;
+
+	for (j = 0; j < 8; j ++) {
+		sph_u32 w[SPH_LANES];
+
+		LV_STORE(w, LV_XOR(LV_XOR(LV_XOR(V[0][j], V[1][j]),
+			LV_XOR(V[2][j], V[3][j])), V[4][j]));
+		for (i = 0; i < SPH_LANES; i ++)
+			sph_enc32be(out + i * 64 + 4 * j, w[i]);
+	}
+}
+
+/* see luffa.c */
+LANES_TARGET void
+LANES_FN(sph_luffa512)(const sph_luffa512_context *initial,
+	const void *data, size_t len, void *dst)
+{
+	LV V[5][8];
+	unsigned char blk[SPH_LANES * 32];
+	unsigned char *out;
+	size_t total, off;
+	int i, j;
+
+	out = dst;
+	for (i = 0; i < 5; i ++) {
+		for (j = 0; j < 8; j ++)
+			V[i][j] = LV_SET1(initial->V[i][j]);
+	}
+	total = initial->ptr + len;
+	for (off = 0; off + 32 <= total; off += 32) {
+		lanes_block(blk, 32, SPH_LANES,
+			initial->buf, initial->ptr, data, len, off);
+		LANES_FN(luffa5_block)(V, blk);
+	}
+	lanes_block(blk, 32, SPH_LANES,
+		initial->buf, initial->ptr, data, len, off);
+	for (i = 0; i < SPH_LANES; i ++)
+		blk[i * 32 + total - off] = 0x80;
+	LANES_FN(luffa5_block)(V, blk);
+	memset(blk, 0, sizeof blk);
+	LANES_FN(luffa5_block)(V, blk);
+	LANES_FN(luffa5_out)(V, out);
+	LANES_FN(luffa5_block)(V, blk);
+	LANES_FN(luffa5_out)(V, out + 32);
+}
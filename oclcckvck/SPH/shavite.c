@@ -59,6 +59,7 @@
 
 #define AES_BIG_ENDIAN   0
 #include "aes_helper.c"
+#include "aesni_helper.c"
 
 static const sph_u32 IV224[] = {
 	C32(0x6774F31C), C32(0x990AE210), C32(0xC87D4274), C32(0xC9546371),
@@ -1471,6 +1472,161 @@ c512(sph_shavite_big_context *sc, const void *msg)
 
 #endif
 
+#if SPH_AESNI
+
+/*
+ * c512() with AES-NI. State and round keys are kept as vectors of four
+ * words: P0 is p0..p3, P1 is p4..p7 and so on, K0 is rk00..rk03 up to
+ * K7 being rk1C..rk1F.
+ *
+ * KEY_EXPAND_ELT() is an AES round on the words rotated by one.
+ * The "rkXY ^= rkZW" steps of the even rounds xor each key with the
+ * last three words of the key two before and the first word of the
+ * previous one, as already updated.
+ */
+#define AESNI_NOKEY(x)   _mm_aesenc_si128(x, zero)
+
+#define AESNI_KEY_EXPAND(k, prev)   do { \
+		k = _mm_xor_si128(AESNI_NOKEY(_mm_shuffle_epi32(k, 0x39)), prev); \
+	} while (0)
+
+#define AESNI_KEY_MIX(k, a, b)   do { \
+		k = _mm_xor_si128(k, _mm_or_si128( \
+			_mm_srli_si128(a, 4), _mm_slli_si128(b, 12))); \
+	} while (0)
+
+/*
+ * Four AES rounds starting from state "in", result xored into "out".
+ */
+#define AESNI_4ROUNDS(in, out, k0, k1, k2, k3)   do { \
+		__m128i x = AESNI_NOKEY(_mm_xor_si128(in, k0)); \
+		x = AESNI_NOKEY(_mm_xor_si128(x, k1)); \
+		x = AESNI_NOKEY(_mm_xor_si128(x, k2)); \
+		x = AESNI_NOKEY(_mm_xor_si128(x, k3)); \
+		out = _mm_xor_si128(out, x); \
+	} while (0)
+
+#define AESNI_EXPAND_ODD(cnt0, cnt1, cnt3)   do { \
+		AESNI_KEY_EXPAND(K0, K7); \
+		cnt0; \
+		AESNI_KEY_EXPAND(K1, K0); \
+		cnt1; \
+		AESNI_KEY_EXPAND(K2, K1); \
+		AESNI_KEY_EXPAND(K3, K2); \
+		AESNI_KEY_EXPAND(K4, K3); \
+		AESNI_KEY_EXPAND(K5, K4); \
+		AESNI_KEY_EXPAND(K6, K5); \
+		AESNI_KEY_EXPAND(K7, K6); \
+		cnt3; \
+	} while (0)
+
+#define AESNI_MIX_EVEN   do { \
+		AESNI_KEY_MIX(K0, K6, K7); \
+		AESNI_KEY_MIX(K1, K7, K0); \
+		AESNI_KEY_MIX(K2, K0, K1); \
+		AESNI_KEY_MIX(K3, K1, K2); \
+		AESNI_KEY_MIX(K4, K2, K3); \
+		AESNI_KEY_MIX(K5, K3, K4); \
+		AESNI_KEY_MIX(K6, K4, K5); \
+		AESNI_KEY_MIX(K7, K5, K6); \
+	} while (0)
+
+#define AESNI_NOP   (void)0
+
+static SPH_AESNI_TARGET void
+c512_aesni(sph_shavite_big_context *sc, const void *msg)
+{
+	const __m128i *m = (const __m128i *)msg;
+	__m128i *h = (__m128i *)sc->h;
+	__m128i zero = _mm_setzero_si128();
+	__m128i P0, P1, P2, P3;
+	__m128i K0, K1, K2, K3, K4, K5, K6, K7;
+	__m128i cnt;
+	int r;
+
+	P0 = _mm_loadu_si128(h + 0);
+	P1 = _mm_loadu_si128(h + 1);
+	P2 = _mm_loadu_si128(h + 2);
+	P3 = _mm_loadu_si128(h + 3);
+	K0 = _mm_loadu_si128(m + 0);
+	K1 = _mm_loadu_si128(m + 1);
+	K2 = _mm_loadu_si128(m + 2);
+	K3 = _mm_loadu_si128(m + 3);
+	K4 = _mm_loadu_si128(m + 4);
+	K5 = _mm_loadu_si128(m + 5);
+	K6 = _mm_loadu_si128(m + 6);
+	K7 = _mm_loadu_si128(m + 7);
+	/* round 0 */
+	AESNI_4ROUNDS(P1, P0, K0, K1, K2, K3);
+	AESNI_4ROUNDS(P3, P2, K4, K5, K6, K7);
+
+	for (r = 0; r < 3; r ++) {
+		/* round 1, 5, 9 */
+		if (r == 0) {
+			cnt = _mm_set_epi32((int)SPH_T32(~sc->count3),
+				(int)sc->count2, (int)sc->count1, (int)sc->count0);
+			AESNI_EXPAND_ODD(K0 = _mm_xor_si128(K0, cnt),
+				AESNI_NOP, AESNI_NOP);
+		} else if (r == 1) {
+			cnt = _mm_set_epi32((int)SPH_T32(~sc->count0),
+				(int)sc->count1, (int)sc->count2, (int)sc->count3);
+			AESNI_EXPAND_ODD(AESNI_NOP,
+				K1 = _mm_xor_si128(K1, cnt), AESNI_NOP);
+		} else {
+			cnt = _mm_set_epi32((int)SPH_T32(~sc->count1),
+				(int)sc->count0, (int)sc->count3, (int)sc->count2);
+			AESNI_EXPAND_ODD(AESNI_NOP, AESNI_NOP,
+				K7 = _mm_xor_si128(K7, cnt));
+		}
+		AESNI_4ROUNDS(P0, P3, K0, K1, K2, K3);
+		AESNI_4ROUNDS(P2, P1, K4, K5, K6, K7);
+		/* round 2, 6, 10 */
+		AESNI_MIX_EVEN;
+		AESNI_4ROUNDS(P3, P2, K0, K1, K2, K3);
+		AESNI_4ROUNDS(P1, P0, K4, K5, K6, K7);
+		/* round 3, 7, 11 */
+		AESNI_EXPAND_ODD(AESNI_NOP, AESNI_NOP, AESNI_NOP);
+		AESNI_4ROUNDS(P2, P1, K0, K1, K2, K3);
+		AESNI_4ROUNDS(P0, P3, K4, K5, K6, K7);
+		/* round 4, 8, 12 */
+		AESNI_MIX_EVEN;
+		AESNI_4ROUNDS(P1, P0, K0, K1, K2, K3);
+		AESNI_4ROUNDS(P3, P2, K4, K5, K6, K7);
+	}
+	/* round 13 */
+	cnt = _mm_set_epi32((int)SPH_T32(~sc->count2),
+		(int)sc->count3, (int)sc->count0, (int)sc->count1);
+	AESNI_KEY_EXPAND(K0, K7);
+	AESNI_KEY_EXPAND(K1, K0);
+	AESNI_KEY_EXPAND(K2, K1);
+	AESNI_KEY_EXPAND(K3, K2);
+	AESNI_KEY_EXPAND(K4, K3);
+	AESNI_KEY_EXPAND(K5, K4);
+	AESNI_KEY_EXPAND(K6, K5);
+	K6 = _mm_xor_si128(K6, cnt);
+	AESNI_KEY_EXPAND(K7, K6);
+	AESNI_4ROUNDS(P0, P3, K0, K1, K2, K3);
+	AESNI_4ROUNDS(P2, P1, K4, K5, K6, K7);
+	_mm_storeu_si128(h + 0, _mm_xor_si128(_mm_loadu_si128(h + 0), P2));
+	_mm_storeu_si128(h + 1, _mm_xor_si128(_mm_loadu_si128(h + 1), P3));
+	_mm_storeu_si128(h + 2, _mm_xor_si128(_mm_loadu_si128(h + 2), P0));
+	_mm_storeu_si128(h + 3, _mm_xor_si128(_mm_loadu_si128(h + 3), P1));
+}
+
+#endif
+
+static void
+shavite_big_compress(sph_shavite_big_context *sc, const void *msg)
+{
+#if SPH_AESNI
+	if (sph_aesni_enabled()) {
+		c512_aesni(sc, msg);
+		return;
+	}
+#endif
+	c512(sc, msg);
+}
+
 static void
 shavite_small_init(sph_shavite_small_context *sc, const sph_u32 *iv)
 {
@@ -1586,7 +1742,7 @@ shavite_big_core(sph_shavite_big_context *sc, const void *data, size_t len)
 					}
 				}
 			}
-			c512(sc, buf);
+			shavite_big_compress(sc, buf);
 			ptr = 0;
 		}
 	}
@@ -1620,7 +1776,7 @@ shavite_big_close(sph_shavite_big_context *sc,
 	} else {
 		buf[ptr ++] = z;
 		memset(buf + ptr, 0, 128 - ptr);
-		c512(sc, buf);
+		shavite_big_compress(sc, buf);
 		memset(buf, 0, 110);
 		sc->count0 = sc->count1 = sc->count2 = sc->count3 = 0;
 	}
@@ -1630,7 +1786,7 @@ shavite_big_close(sph_shavite_big_context *sc,
 	sph_enc32le(buf + 122, count3);
 	buf[126] = out_size_w32 << 5;
 	buf[127] = out_size_w32 >> 3;
-	c512(sc, buf);
+	shavite_big_compress(sc, buf);
 	for (u = 0; u < out_size_w32; u ++)
 		sph_enc32le((unsigned char *)dst + (u << 2), sc->h[u]);
 }
@@ -35,6 +35,7 @@
 #include <limits.h>
 
 #include "sph_simd.h"
+#include "sph_batch.h"
 
 #if SPH_SMALL_FOOTPRINT && !defined SPH_SMALL_FOOTPRINT_SIMD
 #define SPH_SMALL_FOOTPRINT_SIMD   1
@@ -1790,3 +1791,22 @@ sph_simd512_addbits_and_close(void *cc, unsigned ub, unsigned n, void *dst)
 	finalize_big(cc, ub, n, dst, 16);
 	sph_simd512_init(cc);
 }
+
+#if SPH_BATCH_SSE2
+
+/*
+ * sph_simd512_4way() and sph_simd512_8way() hash 4 or 8 messages the
+ * same way sph_luffa512_4way() and sph_luffa512_8way() do, see luffa.c.
+ */
+
+#define SPH_LANES   4
+#include "simd_lanes.c"
+#undef SPH_LANES
+
+#if SPH_BATCH_AVX2
+#define SPH_LANES   8
+#include "simd_lanes.c"
+#undef SPH_LANES
+#endif
+
+#endif
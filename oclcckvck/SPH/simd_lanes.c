@@ -0,0 +1,297 @@
+/*
+ * SIMD-512 on SPH_LANES messages at once. Not meant to be compiled by
+ * itself: simd.c includes it once per vector width, see lanes_helper.c.
+ * The code follows the SPH_SMALL_FOOTPRINT_SIMD version of compress_big(),
+ * with the FFT split into functions instead of macros.
+ *
+ * ==========================(LICENSE BEGIN)============================
+ *
+ * Copyright (c) 2007-2010  Projet RNRT SAPHIR
+ * Copyright (C) 2015 Massimo Del Zotto
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * ===========================(LICENSE END)=============================
+ */
+
+#include "lanes_helper.c"
+
+#ifndef SIMD_LANES_COMMON__
+#define SIMD_LANES_COMMON__
+
+/*
+ * INNER() only needs the low 16 bits of each product, which is what a
+ * 16-bit multiply gives on the low half of each word. The high halves
+ * are multiplied by 0.
+ */
+#define LINNER(l, h, mm)   LV_ADD(LV_MUL16(l, LV_SET1(mm)), \
+	LV_SHL(LV_MUL16(h, LV_SET1(mm)), 16))
+
+/*
+ * Low 32 bits of v * m, m being at most 65535, without the 32-bit multiply
+ * SSE2 lacks. With v = vh * 65536 + vl the 16-bit multiplies give the low
+ * 16 bits of vl * m and, in the high half, of vh * m; the high 16 bits of
+ * vl * m are added on top.
+ */
+#define LMUL(v, m)   LV_ADD(LV_MUL16(v, LV_SET16(m)), \
+	LV_SHL(LV_MULHU16(v, LV_SET16(m)), 16))
+
+#define LIF(x, y, z)    LV_XOR(LV_AND(LV_XOR(y, z), x), z)
+#define LMAJ(x, y, z)   LV_OR(LV_AND(x, y), LV_AND(LV_OR(x, y), z))
+
+static const int wbp_lanes[32] = {
+	 4 << 4,  6 << 4,  0 << 4,  2 << 4,
+	 7 << 4,  5 << 4,  3 << 4,  1 << 4,
+	15 << 4, 11 << 4, 12 << 4,  8 << 4,
+	 9 << 4, 13 << 4, 10 << 4, 14 << 4,
+	17 << 4, 18 << 4, 23 << 4, 20 << 4,
+	22 << 4, 21 << 4, 16 << 4, 19 << 4,
+	30 << 4, 24 << 4, 25 << 4, 31 << 4,
+	27 << 4, 29 << 4, 28 << 4, 26 << 4
+};
+
+static const int pp8k_lanes[] = { 1, 6, 2, 3, 5, 7, 4, 1, 6, 2, 3 };
+
+/*
+ * STEP2_BIG() and one_round_big(), s holding A0..A7, B0..B7, C0..C7 then
+ * D0..D7. Rotations are macro parameters so they stay immediates.
+ */
+#define LSTEP(w, fun, r, sh, ppb)   do { \
+		LV tA[8]; \
+		int n; \
+		for (n = 0; n < 8; n ++) \
+			tA[n] = LV_ROTL(s[n], r); \
+		for (n = 0; n < 8; n ++) { \
+			LV tt = LV_ADD(LV_ADD(s[n + 24], (w)[n]), \
+				fun(s[n], s[n + 8], s[n + 16])); \
+			s[n] = LV_ADD(LV_ROTL(tt, sh), tA[(ppb) ^ n]); \
+			s[n + 24] = s[n + 16]; \
+			s[n + 16] = s[n + 8]; \
+			s[n + 8] = tA[n]; \
+		} \
+	} while (0)
+
+#define LROUND(isp, p0, p1, p2, p3)   do { \
+		LSTEP(w +  0, LIF,  p0, p1, pp8k_lanes[(isp) + 0]); \
+		LSTEP(w +  8, LIF,  p1, p2, pp8k_lanes[(isp) + 1]); \
+		LSTEP(w + 16, LIF,  p2, p3, pp8k_lanes[(isp) + 2]); \
+		LSTEP(w + 24, LIF,  p3, p0, pp8k_lanes[(isp) + 3]); \
+		LSTEP(w + 32, LMAJ, p0, p1, pp8k_lanes[(isp) + 4]); \
+		LSTEP(w + 40, LMAJ, p1, p2, pp8k_lanes[(isp) + 5]); \
+		LSTEP(w + 48, LMAJ, p2, p3, pp8k_lanes[(isp) + 6]); \
+		LSTEP(w + 56, LMAJ, p3, p0, pp8k_lanes[(isp) + 7]); \
+	} while (0)
+
+#define LWBREAD(sb, o1, o2, mm)   do { \
+		int u, v; \
+		for (u = 0; u < 64; u += 8) { \
+			v = wbp_lanes[(u >> 3) + (sb)]; \
+			for (i = 0; i < 8; i ++) \
+				w[u + i] = LINNER(q[v + 2 * i + (o1)], \
+					q[v + 2 * i + (o2)], mm); \
+		} \
+	} while (0)
+
+#endif
+
+static LANES_TARGET void
+LANES_FN(simd_fft_loop)(LV *q, size_t hk, size_t as)
+{
+	LV m, n, t;
+	size_t u;
+
+	m = q[0];
+	n = q[hk];
+	q[0] = LV_ADD(m, n);
+	q[hk] = LV_SUB(m, n);
+	for (u = 1; u < hk; u ++) {
+		m = q[u];
+		n = q[u + hk];
+		t = LMUL(n, alpha_tab[u * as]);
+		t = LV_ADD(LV_AND(t, LV_SET1(0xFFFF)), LV_SAR(t, 16));
+		q[u] = LV_ADD(m, t);
+		q[u + hk] = LV_SUB(m, t);
+	}
+}
+
+/*
+ * FFT16(), the two FFT8() being the iterations of the first loop.
+ */
+static LANES_TARGET void
+LANES_FN(simd_fft16)(const LV *x, size_t xs, LV *q)
+{
+	LV d[2][8];
+	int i, k;
+
+	for (i = 0; i < 2; i ++) {
+		const LV *xb = x + i * xs;
+		size_t s = xs << 1;
+		LV x0 = xb[0], x1 = xb[s], x2 = xb[2 * s], x3 = xb[3 * s];
+		LV a0, a1, a2, a3, b0, b1, b2, b3;
+
+		a0 = LV_ADD(x0, x2);
+		a1 = LV_ADD(x0, LV_SHL(x2, 4));
+		a2 = LV_SUB(x0, x2);
+		a3 = LV_SUB(x0, LV_SHL(x2, 4));
+		b0 = LV_ADD(x1, x3);
+		b1 = LV_ADD(LV_SHL(x1, 2), LV_SHL(x3, 6));
+		b1 = LV_SUB(LV_AND(b1, LV_SET1(0xFF)), LV_SAR(b1, 8));
+		b2 = LV_SUB(LV_SHL(x1, 4), LV_SHL(x3, 4));
+		b3 = LV_ADD(LV_SHL(x1, 6), LV_SHL(x3, 2));
+		b3 = LV_SUB(LV_AND(b3, LV_SET1(0xFF)), LV_SAR(b3, 8));
+		d[i][0] = LV_ADD(a0, b0);
+		d[i][1] = LV_ADD(a1, b1);
+		d[i][2] = LV_ADD(a2, b2);
+		d[i][3] = LV_ADD(a3, b3);
+		d[i][4] = LV_SUB(a0, b0);
+		d[i][5] = LV_SUB(a1, b1);
+		d[i][6] = LV_SUB(a2, b2);
+		d[i][7] = LV_SUB(a3, b3);
+	}
+	q[0] = LV_ADD(d[0][0], d[1][0]);
+	q[8] = LV_SUB(d[0][0], d[1][0]);
+	for (k = 1; k < 8; k ++) {
+		LV t = LV_SHL(d[1][k], k);
+
+		q[k] = LV_ADD(d[0][k], t);
+		q[k + 8] = LV_SUB(d[0][k], t);
+	}
+}
+
+static LANES_TARGET void
+LANES_FN(simd_fft32)(const LV *x, size_t xs, LV *q)
+{
+	LANES_FN(simd_fft16)(x, xs << 1, q);
+	LANES_FN(simd_fft16)(x + xs, xs << 1, q + 16);
+	LANES_FN(simd_fft_loop)(q, 16, 8);
+}
+
+static LANES_TARGET void
+LANES_FN(simd_fft64)(const LV *x, size_t xs, LV *q)
+{
+	LANES_FN(simd_fft32)(x, xs << 1, q);
+	LANES_FN(simd_fft32)(x + xs, xs << 1, q + 32);
+	LANES_FN(simd_fft_loop)(q, 32, 4);
+}
+
+/*
+ * compress_big() on one 128-byte block of each message, blk holding the
+ * blocks one after the other.
+ */
+static LANES_TARGET void
+LANES_FN(simd_compress)(LV st[32], const unsigned char *blk, int last)
+{
+	LV x[128], q[256], w[64], s[32];
+	const unsigned short *yoff;
+	int i, j;
+
+	for (j = 0; j < 128; j ++) {
+		sph_u32 b[SPH_LANES];
+
+		for (i = 0; i < SPH_LANES; i ++)
+			b[i] = blk[i * 128 + j];
+		x[j] = LV_LOAD(b);
+	}
+	LANES_FN(simd_fft64)(x + 0, 4, q +   0);
+	LANES_FN(simd_fft64)(x + 2, 4, q +  64);
+	LANES_FN(simd_fft_loop)(q, 64, 2);
+	LANES_FN(simd_fft64)(x + 1, 4, q + 128);
+	LANES_FN(simd_fft64)(x + 3, 4, q + 192);
+	LANES_FN(simd_fft_loop)(q + 128, 64, 2);
+	LANES_FN(simd_fft_loop)(q, 128, 1);
+
+	yoff = last ? yoff_b_f : yoff_b_n;
+	for (i = 0; i < 256; i ++) {
+		LV tq;
+
+		tq = LV_ADD(q[i], LV_SET1(yoff[i]));
+		tq = LV_ADD(LV_AND(tq, LV_SET1(0xFFFF)), LV_SAR(tq, 16));
+		tq = LV_SUB(LV_AND(tq, LV_SET1(0xFF)), LV_SAR(tq, 8));
+		tq = LV_SUB(LV_AND(tq, LV_SET1(0xFF)), LV_SAR(tq, 8));
+		q[i] = LV_SUB(tq, LV_AND(LV_GT(tq, LV_SET1(128)), LV_SET1(257)));
+	}
+
+	for (j = 0; j < 32; j ++) {
+		sph_u32 m[SPH_LANES];
+
+		for (i = 0; i < SPH_LANES; i ++)
+			m[i] = sph_dec32le(blk + i * 128 + 4 * j);
+		s[j] = LV_XOR(st[j], LV_LOAD(m));
+	}
+
+	LWBREAD( 0,    0,    1, 185);
+	LROUND(0,  3, 23, 17, 27);
+	LWBREAD( 8,    0,    1, 185);
+	LROUND(1, 28, 19, 22,  7);
+	LWBREAD(16, -256, -128, 233);
+	LROUND(2, 29,  9, 15,  5);
+	LWBREAD(24, -383, -255, 233);
+	LROUND(3,  4, 13, 10, 25);
+
+	LSTEP(st +  0, LIF,  4, 13, pp8k_lanes[4]);
+	LSTEP(st +  8, LIF, 13, 10, pp8k_lanes[5]);
+	LSTEP(st + 16, LIF, 10, 25, pp8k_lanes[6]);
+	LSTEP(st + 24, LIF, 25,  4, pp8k_lanes[0]);
+	memcpy(st, s, sizeof s);
+}
+
+/* see simd.c */
+LANES_TARGET void
+LANES_FN(sph_simd512)(const sph_simd512_context *initial,
+	const void *data, size_t len, void *dst)
+{
+	LV st[32];
+	unsigned char blk[SPH_LANES * 128];
+	unsigned char *out;
+	size_t total, off;
+	u32 low, high;
+	int i, j;
+
+	out = dst;
+	for (j = 0; j < 32; j ++)
+		st[j] = LV_SET1(initial->state[j]);
+	low = initial->count_low;
+	high = initial->count_high;
+	total = initial->ptr + len;
+	for (off = 0; off + 128 <= total; off += 128) {
+		lanes_block(blk, 128, SPH_LANES,
+			initial->buf, initial->ptr, data, len, off);
+		LANES_FN(simd_compress)(st, blk, 0);
+		low = T32(low + 1);
+		if (low == 0)
+			high ++;
+	}
+	if (total > off) {
+		lanes_block(blk, 128, SPH_LANES,
+			initial->buf, initial->ptr, data, len, off);
+		LANES_FN(simd_compress)(st, blk, 0);
+	}
+	memset(blk, 0, sizeof blk);
+	for (i = 0; i < SPH_LANES; i ++)
+		encode_count_big(blk + i * 128, low, high, total - off, 0);
+	LANES_FN(simd_compress)(st, blk, 1);
+	for (j = 0; j < 16; j ++) {
+		sph_u32 h[SPH_LANES];
+
+		LV_STORE(h, st[j]);
+		for (i = 0; i < SPH_LANES; i ++)
+			sph_enc32le(out + i * 64 + 4 * j, h[i]);
+	}
+}
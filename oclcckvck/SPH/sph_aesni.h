@@ -0,0 +1,76 @@
+/**
+ * Runtime selection of AES-NI for the AES rounds in ECHO and SHAvite-3.
+ *
+ * Not part of sphlib 3.0. On x86 and x64 builds, echo.c and shavite.c carry
+ * a second version of their AES rounds using the AES-NI instructions.
+ * Which one runs is decided at each compression function call: AES-NI is
+ * used if the CPU supports it (CPUID leaf 1, ECX bit 25) and it has not
+ * been disabled with <code>sph_aesni_enable()</code>. Otherwise the usual
+ * table driven code from aes_helper.c runs. Results are the same.
+ *
+ * Define <code>SPH_AESNI</code> to 0 to build the table code only.
+ *
+ * ==========================(LICENSE BEGIN)============================
+ *
+ * Copyright (c) 2007-2010  Projet RNRT SAPHIR
+ * Copyright (C) 2015 Massimo Del Zotto
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * ===========================(LICENSE END)=============================
+ *
+ * @file     sph_aesni.h
+ */
+
+#ifndef SPH_AESNI_H__
+#define SPH_AESNI_H__
+
+#if !defined SPH_AESNI
+#if defined __x86_64__ || defined __i386__ || defined _M_X64 || defined _M_IX86
+#define SPH_AESNI   1
+#else
+#define SPH_AESNI   0
+#endif
+#endif
+
+/**
+ * Check if the CPU supports the AES-NI instructions. The result is
+ * computed once. Always 0 when <code>SPH_AESNI</code> is 0.
+ *
+ * @return   non-zero if AES-NI is available
+ */
+int sph_aesni_available(void);
+
+/**
+ * Allow (non-zero) or forbid (zero) the AES-NI code paths. They are
+ * allowed by default; forbidding them is mostly useful to compare the
+ * two versions. Not synchronized: do not call while hashing.
+ *
+ * @param enable   non-zero to use AES-NI when available
+ */
+void sph_aesni_enable(int enable);
+
+/**
+ * @return   non-zero if ECHO and SHAvite-3 are going to use AES-NI, that
+ *           is, it is both available and enabled
+ */
+int sph_aesni_enabled(void);
+
+#endif
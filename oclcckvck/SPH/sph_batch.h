@@ -0,0 +1,149 @@
+/**
+ * Batched interface to the 512-bit hash functions used by the validators.
+ *
+ * Not part of sphlib 3.0. Each function hashes <code>count</code> messages
+ * of the same length in a single call. Message i is the optional
+ * <code>prefix</code> followed by the <code>len</code> bytes at
+ * <code>data + i * len</code>; its 64 bytes digest is written at
+ * <code>dst + i * 64</code>. Results are the same as running the usual
+ * init/update/close sequence for each message.
+ *
+ * The prefix is absorbed only once, so hashing 80-byte block headers which
+ * only differ in the nonce is best done by passing the first 64 bytes as
+ * prefix. The initial state is also computed only once.
+ *
+ * Luffa, SIMD and CubeHash are made of 32-bit operations so they hash
+ * several messages at once, each vector register holding the same word of
+ * different messages: Luffa and SIMD hash 8 messages at once with AVX2 or 4
+ * with SSE2, CubeHash 4 with SSE2 (see <code>sph_batch_lanes()</code>).
+ * ECHO, SHAvite-3 and Groestl run one message at a time.
+ *
+ * ==========================(LICENSE BEGIN)============================
+ *
+ * Copyright (c) 2007-2010  Projet RNRT SAPHIR
+ * Copyright (C) 2015 Massimo Del Zotto
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * ===========================(LICENSE END)=============================
+ *
+ * @file     sph_batch.h
+ */
+
+#ifndef SPH_BATCH_H__
+#define SPH_BATCH_H__
+
+#include <stddef.h>
+#include "sph_types.h"
+
+/*
+ * SSE2 is always there on x64 and MSVC tells us when it is enabled on x86,
+ * AVX2 is checked at runtime. Define SPH_BATCH_SSE2 to 0 to always use the
+ * one message at a time path, SPH_BATCH_AVX2 to 0 to leave out the AVX2
+ * code for compilers not knowing about it.
+ */
+#if !defined SPH_BATCH_SSE2
+#if defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+#define SPH_BATCH_SSE2   1
+#else
+#define SPH_BATCH_SSE2   0
+#endif
+#endif
+
+#if !defined SPH_BATCH_AVX2
+#define SPH_BATCH_AVX2   SPH_BATCH_SSE2
+#endif
+
+/**
+ * Check how many messages the CPU allows to hash at once. The result is
+ * computed once.
+ *
+ * @return   8 with AVX2, 4 with SSE2, 1 otherwise
+ */
+unsigned sph_batch_lanes_available(void);
+
+/**
+ * Hash at most <code>lanes</code> messages at once, 1 meaning one message
+ * at a time. There is no limit by default; limiting is mostly useful to
+ * compare the versions. Not synchronized: do not call while hashing.
+ *
+ * @param lanes   1, 4 or 8
+ */
+void sph_batch_max_lanes(unsigned lanes);
+
+/**
+ * @return   how many messages Luffa and SIMD are going to hash at once,
+ *           that is, the available lanes within the allowed maximum
+ */
+unsigned sph_batch_lanes(void);
+
+/**
+ * Hash <code>count</code> messages with ECHO-512.
+ *
+ * @param prefix       bytes common to all messages, can be NULL
+ * @param prefix_len   prefix length in bytes, must be 0 if prefix is NULL
+ * @param data         the variable part of the messages, one after the other
+ * @param len          length of the variable part of each message
+ * @param count        number of messages
+ * @param dst          count * 64 bytes of output
+ */
+void sph_echo512_batch(const void *prefix, size_t prefix_len,
+	const void *data, size_t len, size_t count, void *dst);
+
+/**
+ * Hash <code>count</code> messages with SIMD-512, as many at once as
+ * <code>sph_batch_lanes()</code>.
+ * See <code>sph_echo512_batch()</code> for the parameters.
+ */
+void sph_simd512_batch(const void *prefix, size_t prefix_len,
+	const void *data, size_t len, size_t count, void *dst);
+
+/**
+ * Hash <code>count</code> messages with Luffa-512, as many at once as
+ * <code>sph_batch_lanes()</code>.
+ * See <code>sph_echo512_batch()</code> for the parameters.
+ */
+void sph_luffa512_batch(const void *prefix, size_t prefix_len,
+	const void *data, size_t len, size_t count, void *dst);
+
+/**
+ * Hash <code>count</code> messages with CubeHash-512, 4 at a time when
+ * <code>sph_batch_lanes()</code> is at least 4 and the prefix is a multiple
+ * of 32 bytes.
+ * See <code>sph_echo512_batch()</code> for the parameters.
+ */
+void sph_cubehash512_batch(const void *prefix, size_t prefix_len,
+	const void *data, size_t len, size_t count, void *dst);
+
+/**
+ * Hash <code>count</code> messages with SHAvite-512.
+ * See <code>sph_echo512_batch()</code> for the parameters.
+ */
+void sph_shavite512_batch(const void *prefix, size_t prefix_len,
+	const void *data, size_t len, size_t count, void *dst);
+
+/**
+ * Hash <code>count</code> messages with Groestl-512.
+ * See <code>sph_echo512_batch()</code> for the parameters.
+ */
+void sph_groestl512_batch(const void *prefix, size_t prefix_len,
+	const void *data, size_t len, size_t count, void *dst);
+
+#endif
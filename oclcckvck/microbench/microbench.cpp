@@ -0,0 +1,286 @@
+/*
+ * Copyright (C) 2015 Massimo Del Zotto
+ * This code is released under the MIT license.
+ * For conditions of distribution and use, see the LICENSE or hit the web.
+ */
+#include "../Common/AREN/ArenDataTypes.h"
+#include "../Common/hashing.h"
+#include "../Common/aes.h"
+#include "../oclcckvck/TestData/NeoscryptKDF.h"
+#include "../oclcckvck/TestData/NeoscryptCoreLoops.h"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <functional>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <intrin.h>
+
+extern "C" {
+#include "../SPH/sph_blake.h"
+#include "../SPH/sph_groestl.h"
+#include "../SPH/sph_luffa.h"
+#include "../SPH/sph_cubehash.h"
+#include "../SPH/sph_shavite.h"
+#include "../SPH/sph_simd.h"
+#include "../SPH/sph_echo.h"
+#include "../SPH/sph_aesni.h"
+#include "../SPH/sph_batch.h"
+}
+
+/*! Host primitives bounding how fast results can be validated, timed one call at a time on a single thread so hashes/s are per core.
+Nothing here touches OpenCL: the NS helpers come with the step tests, OpenCL.dll is delay loaded and never called.
+Each primitive is calibrated to a loop taking at least opt_sampleMs, then the loop is timed opt_samples times. The median is reported
+with the spread of the samples, as median absolute deviation over median, so noisy results stand out.
+Cycles are TSC ticks, which run at nominal frequency on most CPUs so only compare them on the same machine. */
+asizei opt_samples = 21;
+double opt_sampleMs = 2.0;
+
+
+struct Primitive {
+    std::string name;
+    asizei bytes; //!< input consumed by each call, for cycles/byte
+    asizei hashes; //!< produced by each call, for hashes/s
+    std::function<void()> call;
+    Primitive(const std::string &what, asizei bytesPerCall, std::function<void()> func, asizei hashesPerCall = 1)
+        : name(what), bytes(bytesPerCall), hashes(hashesPerCall), call(func) { }
+};
+
+
+struct Measured {
+    double ticksPerCall;
+    double callsPerSecond;
+    double spread; //!< MAD / median of the per call ticks
+};
+
+
+static Measured Time(const Primitive &prim) {
+    using namespace std::chrono;
+    auto seconds = [](high_resolution_clock::time_point start) {
+        return duration<double>(high_resolution_clock::now() - start).count();
+    };
+    asizei calls = 1;
+    while(true) {
+        const auto start(high_resolution_clock::now());
+        for(asizei loop = 0; loop < calls; loop++) prim.call();
+        if(seconds(start) * 1000 >= opt_sampleMs) break;
+        calls *= 2;
+    }
+    std::vector<double> ticks(opt_samples), wall(opt_samples);
+    for(asizei sample = 0; sample < opt_samples; sample++) {
+        const auto start(high_resolution_clock::now());
+        const aulong tsc = __rdtsc();
+        for(asizei loop = 0; loop < calls; loop++) prim.call();
+        ticks[sample] = double(__rdtsc() - tsc) / calls;
+        wall[sample] = seconds(start) / calls;
+    }
+    auto median = [](std::vector<double> values) {
+        std::sort(values.begin(), values.end());
+        const asizei mid = values.size() / 2;
+        return values.size() % 2? values[mid] : (values[mid - 1] + values[mid]) / 2;
+    };
+    Measured ret;
+    ret.ticksPerCall = median(ticks);
+    ret.callsPerSecond = 1.0 / median(wall);
+    std::vector<double> deviation(ticks.size());
+    for(asizei i = 0; i < ticks.size(); i++) deviation[i] = std::fabs(ticks[i] - ret.ticksPerCall);
+    ret.spread = median(deviation) / ret.ticksPerCall;
+    return ret;
+}
+
+
+//! Outputs go there so calls are not optimized away.
+static volatile aubyte sink;
+
+
+/*! Init, update and close of a SPH 512 bit hash on a fixed message, each call being a complete hash. */
+template<typename Context>
+Primitive SPH(const char *name, void (*init)(void*), void (*update)(void*, const void*, size_t), void (*close)(void*, void*), const std::vector<aubyte> &message) {
+    const aubyte *data = message.data();
+    const asizei len = message.size();
+    return Primitive(std::string(name) + ", " + std::to_string(len) + " bytes", len, [init, update, close, data, len]() {
+        Context cc;
+        aubyte digest[64];
+        init(&cc);
+        update(&cc, data, len);
+        close(&cc, digest);
+        sink ^= digest[0];
+    });
+}
+
+
+/*! Batched SPH 512 bit hash of 64 copies of a message, as the step validators do. Hashes/s compare with the one at a time rows. */
+Primitive SPHBatch(const char *name, void (*batch)(const void*, size_t, const void*, size_t, size_t, void*), const std::vector<aubyte> &message) {
+    const asizei count = 64, len = message.size();
+    std::shared_ptr<std::vector<aubyte>> data(new std::vector<aubyte>(count * len)), out(new std::vector<aubyte>(count * 64));
+    for(asizei i = 0; i < count; i++) std::copy(message.cbegin(), message.cend(), data->begin() + i * len);
+    return Primitive(std::string(name) + " batch, " + std::to_string(count) + " x " + std::to_string(len) + " bytes", count * len, [batch, data, out, count, len]() {
+        batch(nullptr, 0, data->data(), len, count, out->data());
+        sink ^= (*out)[0];
+    }, count);
+}
+
+
+static std::vector<Primitive> Primitives(const std::vector<aubyte> &msg64, const std::vector<aubyte> &msg80) {
+    std::vector<Primitive> list;
+    const std::vector<aubyte> *messages[] = { &msg64, &msg80 };
+    for(auto msg : messages) {
+        list.push_back(SPH<sph_blake512_context>("sph BLAKE-512", sph_blake512_init, sph_blake512, sph_blake512_close, *msg));
+        list.push_back(SPH<sph_groestl512_context>("sph Groestl-512", sph_groestl512_init, sph_groestl512, sph_groestl512_close, *msg));
+        list.push_back(SPH<sph_luffa512_context>("sph Luffa-512", sph_luffa512_init, sph_luffa512, sph_luffa512_close, *msg));
+        list.push_back(SPH<sph_cubehash512_context>("sph CubeHash-512", sph_cubehash512_init, sph_cubehash512, sph_cubehash512_close, *msg));
+        list.push_back(SPH<sph_shavite512_context>("sph SHAvite-512", sph_shavite512_init, sph_shavite512, sph_shavite512_close, *msg));
+        list.push_back(SPH<sph_simd512_context>("sph SIMD-512", sph_simd512_init, sph_simd512, sph_simd512_close, *msg));
+        list.push_back(SPH<sph_echo512_context>("sph ECHO-512", sph_echo512_init, sph_echo512, sph_echo512_close, *msg));
+    }
+    list.push_back(SPHBatch("sph Groestl-512", sph_groestl512_batch, msg64));
+    list.push_back(SPHBatch("sph Luffa-512", sph_luffa512_batch, msg64));
+    list.push_back(SPHBatch("sph CubeHash-512", sph_cubehash512_batch, msg64));
+    list.push_back(SPHBatch("sph SHAvite-512", sph_shavite512_batch, msg64));
+    list.push_back(SPHBatch("sph SIMD-512", sph_simd512_batch, msg64));
+    list.push_back(SPHBatch("sph ECHO-512", sph_echo512_batch, msg64));
+
+    const aubyte *block = msg64.data(), *block80 = msg80.data();
+    std::array<auint, 20> header;
+    memcpy_s(header.data(), sizeof(header), msg80.data(), 80);
+    {
+        Primitive prim("sha256::Compress, 64 bytes", 64, [block]() {
+            hashing::sha256::State h(hashing::sha256::IV());
+            hashing::sha256::Compress(h, block);
+            sink ^= aubyte(h[0]);
+        });
+        list.push_back(prim);
+    }
+    for(auto msg : messages) {
+        const aubyte *data = msg->data();
+        const asizei len = msg->size();
+        Primitive prim("SHA256, " + std::to_string(len) + " bytes", len, [data, len]() {
+            hashing::SHA256 hasher(data, len);
+            hashing::SHA256::Digest digest;
+            hasher.GetHash(digest);
+            sink ^= digest[0];
+        });
+        list.push_back(prim);
+    }
+    {
+        Primitive prim("PBKDF2_SHA256_80_128, 80 bytes", 80, [header]() {
+            std::array<auint, 32> out;
+            hashing::PBKDF2<hashing::SHA256>(out, header);
+            sink ^= aubyte(out[0]);
+        });
+        list.push_back(prim);
+    }
+    {
+        std::shared_ptr<std::array<auint, 4 * 8 * 1024>> pad(new std::array<auint, 4 * 8 * 1024>);
+        Primitive prim("Scrypt(1024), 80 bytes", 80, [header, pad]() {
+            std::array<aubyte, 32> out;
+            hashing::Scrypt<1024>(out, header, *pad);
+            sink ^= out[0];
+        });
+        list.push_back(prim);
+    }
+    {
+        // 8 headers for each call, hashes/s compare with the one above.
+        std::shared_ptr<std::vector<std::array<auint, 20>>> headers(new std::vector<std::array<auint, 20>>(8, header));
+        for(asizei i = 0; i < headers->size(); i++) (*headers)[i][19] = auint(i);
+        Primitive prim("Scrypt(1024) runtime N, 8 x 80 bytes", 8 * 80, [headers]() {
+            std::array<aubyte, 32> out[8];
+            hashing::Scrypt(out, headers->data(), headers->size(), 1024);
+            sink ^= out[0][0];
+        }, 8);
+        list.push_back(prim);
+    }
+
+    {
+        Primitive prim("NS FirstKDF, 80 bytes", 80, [block80]() {
+            stepTest::NS_KDFHelper helper;
+            std::array<auint, (256 + 64) / 4> buff_a;
+            std::array<auint, (256 + 32) / 4> buff_b;
+            auto state(helper.FirstKDF(block80, reinterpret_cast<aubyte*>(buff_a.data()), reinterpret_cast<aubyte*>(buff_b.data())));
+            sink ^= aubyte(state[0]);
+        });
+        list.push_back(prim);
+    }
+    {
+        // LastKDF needs the buffers FirstKDF leaves, computed once. Its input is the 256 bytes mixed state.
+        struct Buffers {
+            std::array<auint, (256 + 64) / 4> buff_a;
+            std::array<auint, (256 + 32) / 4> buff_b;
+            std::array<auint, 64> state;
+        };
+        std::shared_ptr<Buffers> buffers(new Buffers);
+        stepTest::NS_KDFHelper helper;
+        buffers->state = helper.FirstKDF(block80, reinterpret_cast<aubyte*>(buffers->buff_a.data()), reinterpret_cast<aubyte*>(buffers->buff_b.data()));
+        Primitive prim("NS LastKDF, 256 bytes", 256, [buffers]() {
+            stepTest::NS_KDFHelper helper;
+            std::array<auint, (256 + 32) / 4> buff_b(buffers->buff_b);
+            auto digest(helper.LastKDF(buffers->state, reinterpret_cast<const aubyte*>(buffers->buff_a.data()), reinterpret_cast<aubyte*>(buff_b.data())));
+            sink ^= digest[0];
+        });
+        list.push_back(prim);
+    }
+    {
+        std::shared_ptr<std::array<auint, 16>> state(new std::array<auint, 16>);
+        memcpy_s(state->data(), sizeof(*state), block, 64);
+        Primitive salsa("nsHelp Salsa, 64 bytes", 64, [state]() {
+            stepTest::nsHelp::Salsa()(state->data());
+            sink ^= aubyte((*state)[0]);
+        });
+        Primitive chacha("nsHelp Chacha, 64 bytes", 64, [state]() {
+            stepTest::nsHelp::Chacha()(state->data());
+            sink ^= aubyte((*state)[0]);
+        });
+        list.push_back(salsa);
+        list.push_back(chacha);
+    }
+    {
+        // Table generation, bytes being the table produced rather than consumed.
+        Primitive inverses("aes::StoreMultiplicativeInverses, 256 bytes", 256, []() {
+            aubyte inv[256];
+            aes::StoreMultiplicativeInverses(inv);
+            sink ^= inv[1];
+        });
+        Primitive table("aes::RoundTableRowZero, 1024 bytes", 1024, []() {
+            auint lut[256];
+            aes::RoundTableRowZero(lut);
+            sink ^= aubyte(lut[1]);
+        });
+        list.push_back(inverses);
+        list.push_back(table);
+    }
+    return list;
+}
+
+
+/*! Usage: microbench [--samples N] [NAME or PREFIX* ...]
+Without names, times everything. Names are matched against the start of the primitive names, case sensitive. */
+int main(int argc, char *argv[]) {
+    std::vector<std::string> select;
+    for(int arg = 1; arg < argc; arg++) {
+        const std::string opt(argv[arg]);
+        if(opt == "--samples" && arg + 1 < argc) opt_samples = std::max(asizei(1), asizei(std::stoul(argv[++arg])));
+        else select.push_back(opt.length() && opt.back() == '*'? opt.substr(0, opt.length() - 1) : opt);
+    }
+    std::vector<aubyte> msg64(64), msg80(80);
+    for(asizei i = 0; i < msg80.size(); i++) msg80[i] = aubyte(i * 7 + 3);
+    std::copy(msg80.cbegin(), msg80.cbegin() + 64, msg64.begin());
+
+    std::cout<<"AES-NI "<<(sph_aesni_available()? "enabled" : "not available")<<", SHA-256 features "<<hashing::sha256::Enabled()<<", SPH batch lanes "<<sph_batch_lanes()<<std::endl;
+    std::cout<<opt_samples<<" samples of at least "<<opt_sampleMs<<" ms each, single thread"<<std::endl;
+    std::cout<<std::left<<std::setw(46)<<"primitive"<<std::right<<std::setw(14)<<"cycles/call"<<std::setw(12)<<"cycles/byte"<<std::setw(14)<<"hashes/s"<<std::setw(9)<<"spread"<<std::endl;
+    const auto list(Primitives(msg64, msg80));
+    for(const auto &prim : list) {
+        if(select.size() && std::none_of(select.cbegin(), select.cend(), [&prim](const std::string &name) { return prim.name.compare(0, name.length(), name) == 0; })) continue;
+        const Measured took(Time(prim));
+        std::cout<<std::left<<std::setw(46)<<prim.name<<std::right<<std::fixed;
+        std::cout<<std::setprecision(0)<<std::setw(14)<<took.ticksPerCall;
+        std::cout<<std::setprecision(2)<<std::setw(12)<<took.ticksPerCall / prim.bytes;
+        std::cout<<std::setprecision(0)<<std::setw(14)<<took.callsPerSecond * prim.hashes;
+        std::cout<<std::setprecision(1)<<std::setw(8)<<took.spread * 100<<'%'<<std::endl;
+    }
+    hashing::ScratchArena::ReleaseThisThread();
+    return 0;
+}
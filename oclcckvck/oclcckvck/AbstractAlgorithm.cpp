@@ -29,8 +29,20 @@ std::vector<std::string> AbstractAlgorithm::DescribeResources(ConfigDesc &desc,
 }
 
 
+aulong AbstractAlgorithm::PeekVersioningHash(const std::string &loadPathPrefix) {
+    struct NoSpecials : AbstractSpecialValuesProvider {
+        void Push(LateBinding &slot, asizei valueIndex) { }
+    } none;
+    peeking = true;
+    ScopedFuncCall restore([this]() { peeking = false;    aiSignature = 0; });
+    if(Init(nullptr, none, loadPathPrefix).size()) return 0;
+    return aiSignature;
+}
+
+
 std::vector<std::string> AbstractAlgorithm::PrepareResources(ResourceRequest *resources, asizei numResources, const AbstractSpecialValuesProvider &prov) {
     std::vector<std::string> errors;
+    if(peeking) return errors;
     for(auto res = resources; res != resources + numResources; res++) {
         if(resHandles.find(res->name) != resHandles.cend()) throw std::string("Duplicated resource name \"" + res->name + '"');
         if(prov.SpecialValue(res->name)) {
@@ -44,8 +56,13 @@ std::vector<std::string> AbstractAlgorithm::PrepareResources(ResourceRequest *re
         ScopedFuncCall relMem([&build]() { if(build) clReleaseMemObject(build); });
         cl_int err = 0;
         asizei count = errors.size();
+        cl_uint extraFlags = 0;
+        if(res->initialData) {
+            if(res->useProvidedBuffer) extraFlags |= CL_MEM_USE_HOST_PTR;
+            else extraFlags |= CL_MEM_COPY_HOST_PTR;
+        }
         if(res->imageDesc.image_width) {
-            build = clCreateImage(context, res->memFlags, &res->channels, &res->imageDesc, &res->initialData, &err);
+            build = clCreateImage(context, res->memFlags | extraFlags, &res->channels, &res->imageDesc, const_cast<aubyte*>(res->initialData), &err);
             if(err == CL_INVALID_VALUE) errors.push_back("Invalid flags specified for \"" + res->name + '"');
             else if(err == CL_INVALID_IMAGE_FORMAT_DESCRIPTOR)  errors.push_back("Invalid image format descriptor for \"" + res->name + '"');
             else if(err == CL_INVALID_IMAGE_DESCRIPTOR) errors.push_back("Invalid image descriptor for \"" + res->name + '"');
@@ -56,11 +73,6 @@ std::vector<std::string> AbstractAlgorithm::PrepareResources(ResourceRequest *re
             if(errors.size() != count) continue;
         }
         else {
-            cl_uint extraFlags = 0;
-            if(res->initialData) {
-                if(res->useProvidedBuffer) extraFlags |= CL_MEM_USE_HOST_PTR;
-                else extraFlags |= CL_MEM_COPY_HOST_PTR;
-            }
             build = clCreateBuffer(context, res->memFlags | extraFlags, res->bytes, const_cast<aubyte*>(res->initialData), &err);
             if(err == CL_INVALID_VALUE) errors.push_back("Invalid flags specified for \"" + res->name + '"');
             else if(err == CL_INVALID_BUFFER_SIZE) errors.push_back("Invalid buffer size for \"" + res->name + "\": " + std::to_string(res->bytes));
@@ -76,6 +88,48 @@ std::vector<std::string> AbstractAlgorithm::PrepareResources(ResourceRequest *re
 }
 
 
+std::vector<std::pair<cl_mem, asizei>> AbstractAlgorithm::HostReadableBuffers() const {
+    std::vector<std::pair<cl_mem, asizei>> ret;
+    for(const auto &res : resRequests) {
+        if(res.immediate || res.imageDesc.image_width || (res.memFlags & CL_MEM_HOST_READ_ONLY) == 0) continue;
+        auto handle = resHandles.find(res.name);
+        if(handle != resHandles.cend()) ret.push_back(std::make_pair(handle->second, res.bytes));
+    }
+    return ret;
+}
+
+
+std::vector<asizei> AbstractAlgorithm::HashesPerWorkGroup() const {
+    std::vector<asizei> ret;
+    for(const auto &kern : kernels) ret.push_back(kern.wgs[kern.dimensionality - 1]);
+    return ret;
+}
+
+
+std::vector<std::string> AbstractAlgorithm::KernelNames() const {
+    std::vector<std::string> ret;
+    for(const auto &kern : kernels) ret.push_back(kern.name);
+    return ret;
+}
+
+
+std::vector<AbstractAlgorithm::KernelDesc> AbstractAlgorithm::DescribeKernels() const {
+    std::vector<KernelDesc> ret;
+    for(const auto &kern : kernels) {
+        KernelDesc desc;
+        desc.name = kern.name;
+        desc.dimensionality = kern.dimensionality;
+        for(asizei cp = 0; cp < 3; cp++) desc.wgs[cp] = kern.wgs[cp];
+        clGetKernelWorkGroupInfo(kern.clk, device, CL_KERNEL_LOCAL_MEM_SIZE, sizeof(desc.localBytes), &desc.localBytes, NULL);
+        clGetKernelWorkGroupInfo(kern.clk, device, CL_KERNEL_PRIVATE_MEM_SIZE, sizeof(desc.privateBytes), &desc.privateBytes, NULL);
+        clGetKernelWorkGroupInfo(kern.clk, device, CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE, sizeof(desc.preferredMultiple), &desc.preferredMultiple, NULL);
+        clGetKernelWorkGroupInfo(kern.clk, device, CL_KERNEL_WORK_GROUP_SIZE, sizeof(desc.maxWorkGroupSize), &desc.maxWorkGroupSize, NULL);
+        ret.push_back(desc);
+    }
+    return ret;
+}
+
+
 std::vector<std::string> AbstractAlgorithm::PrepareKernels(KernelRequest *kernels, asizei numKernels, AbstractSpecialValuesProvider &special, const std::string &loadPath) {
     // First of all, let's build a set of unique file names. Some algorithms load up the same file more than once.
     // Those are usually very few entries so it's probably faster using an array but set is easier.
@@ -106,6 +160,7 @@ std::vector<std::string> AbstractAlgorithm::PrepareKernels(KernelRequest *kernel
     }
     if(errors.size()) return errors;
     aiSignature = ComputeVersionedHash(kernels, numKernels, load);
+    if(peeking) return errors;
     // Run all the compile calls. One program must be built for each requested kernel as it will go with different compile options but they have the same source.
     // OpenCL is reference counted (bleargh) so programs can go at the end of this function.
     // I wanted to do this asyncronously but BuildProgram goes with notification functions instead of events (?) so I would have to do that multithreaded.
@@ -163,7 +218,7 @@ std::vector<std::string> AbstractAlgorithm::PrepareKernels(KernelRequest *kernel
             errors.push_back(std::string("Could not create kernel \"") + kernels[loop].fileName + ':' + kernels[loop].entryPoint + "\", error " + std::to_string(err));
             continue;
         }
-        this->kernels.push_back(KernelDriver(kernels[loop].groupSize, kern));
+        this->kernels.push_back(KernelDriver(kernels[loop].groupSize, kern, kernels[loop].fileName + ':' + kernels[loop].entryPoint));
     }
     if(errors.size()) return errors;
     for(asizei loop = 0; loop < numKernels; loop++) BindParameters(this->kernels[loop], kernels[loop], special);
@@ -229,7 +284,7 @@ void AbstractAlgorithm::BindParameters(KernelDriver &kdesc, const KernelRequest
 }
 
 
-void AbstractAlgorithm::RunAlgorithm(cl_command_queue q, asizei amount) {
+void AbstractAlgorithm::RunAlgorithm(cl_command_queue q, asizei amount, std::vector<cl_event> *kernelEvents) {
     for(asizei loop = 0; loop < kernels.size(); loop++) {
         const auto &kern(kernels[loop]);
         for(auto param : kern.dtBindings) clSetKernelArg(kern.clk, param.first, sizeof(param.second.buff), &param.second.buff);
@@ -246,7 +301,9 @@ void AbstractAlgorithm::RunAlgorithm(cl_command_queue q, asizei amount) {
         for(auto cp = 0u; cp < kern.dimensionality - 1; cp++) wsize[cp] = kern.wgs[cp];
         wsize[kern.dimensionality - 1] = amount;
 
-        cl_int error = clEnqueueNDRangeKernel(q, kernels[loop].clk, kernels[loop].dimensionality, woff, wsize, kernels[loop].wgs, 0, NULL, NULL);
+        cl_event done = 0;
+        cl_int error = clEnqueueNDRangeKernel(q, kernels[loop].clk, kernels[loop].dimensionality, woff, wsize, kernels[loop].wgs, 0, NULL, kernelEvents? &done : NULL);
+        if(error == CL_SUCCESS && kernelEvents) kernelEvents->push_back(done);
         if(error != CL_SUCCESS) {
             std::string ret("OpenCL error " + std::to_string(error) + " returned by clEnqueueNDRangeKernel(");
             ret += identifier.algorithm + '.' + identifier.implementation;
@@ -88,6 +88,35 @@ public:
     Represents the specific algorithm-implementation and version. Computed as a side effect of PrepareKernels, which is supposed to be called by Init(). */
     aulong GetVersioningHash() const { return aiSignature; }
 
+    /*! What GetVersioningHash would return after Init, without allocating resources nor building kernels: the sources are only
+    loaded and hashed. Returns 0 if they cannot be loaded. Object is left as constructed so Init can be called as usual. */
+    aulong PeekVersioningHash(const std::string &loadPathPrefix);
+
+    /*! Buffers created with CL_MEM_HOST_READ_ONLY with their size in bytes, in the order they have been requested.
+    By convention those are the results of the algorithm: what the host maps to check them. Images are not included. */
+    std::vector<std::pair<cl_mem, asizei>> HostReadableBuffers() const;
+
+    //! For each kernel run by RunAlgorithm, how many hashes each of its work groups computes. Only valid after Init.
+    std::vector<asizei> HashesPerWorkGroup() const;
+
+    //! For each kernel run by RunAlgorithm, its "fileName:entryPoint" as declared in its KernelRequest. Only valid after Init.
+    std::vector<std::string> KernelNames() const;
+
+    //! What the driver says about a built kernel, see clGetKernelWorkGroupInfo. Sizes are in bytes.
+    struct KernelDesc {
+        std::string name; //!< same as KernelNames()
+        auint dimensionality;
+        asizei wgs[3]; //!< work group size declared in KernelRequest, should match reqd_work_group_size
+        cl_ulong localBytes; //!< CL_KERNEL_LOCAL_MEM_SIZE
+        cl_ulong privateBytes; //!< CL_KERNEL_PRIVATE_MEM_SIZE, per work item
+        asizei preferredMultiple; //!< CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE, usually wavefront or warp size
+        asizei maxWorkGroupSize; //!< CL_KERNEL_WORK_GROUP_SIZE, goes down when registers are tight
+        explicit KernelDesc() : dimensionality(0), localBytes(0), privateBytes(0), preferredMultiple(0), maxWorkGroupSize(0) { wgs[0] = wgs[1] = wgs[2] = 0; }
+        asizei WorkItems() const { return wgs[0] * (dimensionality > 1? wgs[1] : 1) * (dimensionality > 2? wgs[2] : 1); }
+    };
+    //! For each kernel run by RunAlgorithm, in order. Only valid after Init. Values the driver fails to provide are left 0.
+    std::vector<KernelDesc> DescribeKernels() const;
+
 
     /*! When initialized, algorithms can optionally provide information about what they're initializing so the user can understand what's going on.
     In that case, Init() will allocate nothing and exit early. */
@@ -126,9 +155,11 @@ public:
     /*! Using the provided command-queue/device assume all input buffers have been correctly setup and run a whole algorithm iteration (all involved steps).
     Compute exactly <i>amount</i> hashes, starting from hash=nonceBase.
     It is assumed count <= this->hashCount.
+    If kernelEvents is not null, an event for each kernel enqueued is appended to it in KernelNames() order, caller gets to release them.
+    They are meant to be profiled so the queue is better created with CL_QUEUE_PROFILING_ENABLE.
     \note Some kernels have requirements on workgroup size and thus put a requirement on amount being a multiple of WG size.
     Of course this base class does not care; derived classes must be careful with setup, including rebinding special resources. */
-    void RunAlgorithm(cl_command_queue q, asizei amount);
+    void RunAlgorithm(cl_command_queue q, asizei amount, std::vector<cl_event> *kernelEvents = nullptr);
 
     void Restart(asizei nonceStart = 0) { nonceBase = nonceStart; }
 
@@ -231,8 +262,10 @@ protected:
         std::vector< std::pair<cl_uint, LateBinding> > dtBindings; /*!< dispatch time bindings. For each element,
                                                                    .first is algorithm parameter index,
                                                                    .second is *persistent* buffer where AbstractSpecialValuesProvider will push! */
+        std::string name; //!< fileName:entryPoint of the originating KernelRequest
         explicit KernelDriver() = default;
-        KernelDriver(const WorkGroupDimensionality &wgd, cl_kernel k) : WorkGroupDimensionality(wgd) { clk = k; }
+        KernelDriver(const WorkGroupDimensionality &wgd, cl_kernel k, const std::string &presentation)
+            : WorkGroupDimensionality(wgd), name(presentation) { clk = k; }
     };
 
     std::vector<KernelDriver> kernels;
@@ -245,6 +278,7 @@ protected:
 
 private:
     aulong aiSignature = 0; //!< \sa GetVersioningHash()
+    bool peeking = false; //!< PrepareResources and PrepareKernels stop short, see PeekVersioningHash
     asizei nonceBase = 0;
 
     //! Called at the end of PrepareKernels. Given a cl_kernel and its originating KernelRequest object, generates a stream of clSetKernelArg according
@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2015 Massimo Del Zotto
+ * This code is released under the MIT license.
+ * For conditions of distribution and use, see the LICENSE or hit the web.
+ */
+#pragma once
+#include <string>
+#include <CL/cl.h>
+
+namespace algoImplementations {
+
+/*! Where SHAvite3_1W.cl and Echo_8W.cl pull AES T tables from. Fastest depends on device cache and LDS, there is no universal best. */
+enum class AESTablesSource {
+    lds, //!< copied to local memory at kernel start, the original way
+    global, //!< read straight from the global buffer, relying on caches
+    image //!< 1D image of 4*256 uints, goes through the texture cache
+};
+
+
+inline const char* GetName(AESTablesSource source) {
+    switch(source) {
+    case AESTablesSource::lds: return "LDS";
+    case AESTablesSource::global: return "global";
+    case AESTablesSource::image: return "image";
+    }
+    return "<unknown>";
+}
+
+
+//! To be appended to kernel compile flags. Nothing is added for AESTablesSource::lds, so kernels are built as they always have been.
+inline std::string GetCompileFlags(AESTablesSource source) {
+    switch(source) {
+    case AESTablesSource::global: return " -D AES_TABLES_GLOBAL";
+    case AESTablesSource::image: return " -D AES_TABLES_IMAGE";
+    }
+    return std::string();
+}
+
+
+//! Turns a resource request into the image expected by AES_TABLES_IMAGE kernels. Bytes and initial data are left untouched.
+inline void MakeAESTablesImage(cl_image_format &channels, cl_image_desc &imageDesc, size_t bytes) {
+    channels.image_channel_order = CL_R;
+    channels.image_channel_data_type = CL_UNSIGNED_INT32;
+    imageDesc.image_type = CL_MEM_OBJECT_IMAGE1D;
+    imageDesc.image_width = bytes / sizeof(cl_uint);
+}
+
+}
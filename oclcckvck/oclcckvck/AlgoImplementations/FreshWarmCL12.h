@@ -5,13 +5,17 @@
  */
 #pragma once
 #include "../AbstractAlgorithm.h"
+#include "AESTables.h"
 
 namespace algoImplementations {
 
 class FreshWarmCL12 : public AbstractAlgorithm {
 public:
-    FreshWarmCL12(cl_context ctx, cl_device_id dev, asizei concurrency)
-        : AbstractAlgorithm(concurrency, ctx, dev, "Fresh", "warm", "v1", 16) { }
+    //! AES T tables used by SHAvite3 and Echo can be read from different memories, see AESTablesSource.
+    const AESTablesSource aesTables;
+
+    FreshWarmCL12(cl_context ctx, cl_device_id dev, asizei concurrency, AESTablesSource aes = AESTablesSource::lds)
+        : AbstractAlgorithm(concurrency, ctx, dev, "Fresh", "warm", "v1", 16), aesTables(aes) { }
 
     std::vector<std::string> Init(ConfigDesc *desc, AbstractSpecialValuesProvider &specials, const std::string &loadPathPrefix) {
         const asizei passingBytes = hashCount * 16 * sizeof(cl_uint);
@@ -30,6 +34,7 @@ public:
         resources[0].presentationName = "I/O buffer [0]";
         resources[1].presentationName = "I/O buffer [1]";
         resources[2].presentationName = "AES round T tables";
+        if(aesTables == AESTablesSource::image) MakeAESTablesImage(resources[2].channels, resources[2].imageDesc, resources[2].bytes);
 
         resources[4].presentationName = "SIMD &alpha; table";
         resources[5].presentationName = "SIMD &beta; table";
@@ -40,7 +45,7 @@ public:
         typedef WorkGroupDimensionality WGD;
         KernelRequest kernels[] = {
             {
-                "SHAvite3_1W.cl", "SHAvite3_1way", "-D HEAD_OF_CHAINED_HASHING",
+                "SHAvite3_1W.cl", "SHAvite3_1way", "-D HEAD_OF_CHAINED_HASHING" + GetCompileFlags(aesTables),
                 WGD(64),
                 "$wuData, io0, AES_T_TABLES, sh3_roundCount"
             },
@@ -60,7 +65,7 @@ public:
                 "io0, io1, io0, SIMD_ALPHA, SIMD_BETA"
             },
             {
-                "Echo_8W.cl", "Echo_8way", "-D AES_TABLE_ROW_1 -D AES_TABLE_ROW_2 -D AES_TABLE_ROW_3 -D ECHO_IS_LAST",
+                "Echo_8W.cl", "Echo_8way", "-D AES_TABLE_ROW_1 -D AES_TABLE_ROW_2 -D AES_TABLE_ROW_3 -D ECHO_IS_LAST" + GetCompileFlags(aesTables),
                 WGD(8, 8),
                 "io1, $candidates, $dispatchData, AES_T_TABLES"
             }
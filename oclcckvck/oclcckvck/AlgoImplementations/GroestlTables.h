@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2015 Massimo Del Zotto
+ * This code is released under the MIT license.
+ * For conditions of distribution and use, see the LICENSE or hit the web.
+ */
+#pragma once
+#include "../../Common/AREN/ArenDataTypes.h"
+#include <string>
+
+namespace algoImplementations {
+
+/*! Amount of Groestl T tables grsmyr_monolithic.cl copies to LDS, see GROESTL_LDS_TABLES there. Tables not in LDS are obtained by rotating
+the others. Fewer tables means less LDS per workgroup and thus more workgroups in flight but also more ALU work for each lookup. */
+enum class GroestlTables {
+    six, //!< T0..T5 in LDS, T6 and T7 from constant memory, the original
+    two, //!< T0 and T4 in LDS
+    one //!< T0 only
+};
+
+
+inline const char* GetName(GroestlTables tables) {
+    switch(tables) {
+    case GroestlTables::six: return "six LDS tables";
+    case GroestlTables::two: return "two LDS tables + rotate";
+    case GroestlTables::one: return "one LDS table + rotate";
+    }
+    return "<unknown>";
+}
+
+
+inline auint GetLDSTableCount(GroestlTables tables) {
+    switch(tables) {
+    case GroestlTables::two: return 2;
+    case GroestlTables::one: return 1;
+    }
+    return 6;
+}
+
+
+//! Compile flags to be passed to grsmyr_monolithic.cl. The original layout produces no flags.
+inline std::string GetCompileFlags(GroestlTables tables) {
+    if(tables == GroestlTables::six) return std::string();
+    return " -D GROESTL_LDS_TABLES=" + std::to_string(GetLDSTableCount(tables));
+}
+
+}
@@ -5,13 +5,17 @@
  */
 #pragma once
 #include "../AbstractAlgorithm.h"
+#include "GroestlTables.h"
 
 namespace algoImplementations {
 
 class MYRGRSMonolithicCL12 : public AbstractAlgorithm {
 public:
-    MYRGRSMonolithicCL12(cl_context ctx, cl_device_id dev, asizei concurrency)
-        : AbstractAlgorithm(concurrency, ctx, dev, "GRSMYR", "monolithic", "v1", 8) { }
+    //! How many Groestl T tables go to LDS, the rest is rotated. LDS usage is the main limit to occupancy for this kernel.
+    const GroestlTables groestlTables;
+
+    MYRGRSMonolithicCL12(cl_context ctx, cl_device_id dev, asizei concurrency, GroestlTables tables = GroestlTables::six)
+        : AbstractAlgorithm(concurrency, ctx, dev, "GRSMYR", "monolithic", "v1", 8), groestlTables(tables) { }
 
     std::vector<std::string> Init(ConfigDesc *desc, AbstractSpecialValuesProvider &specials, const std::string &loadPathPrefix) {
         auint roundCount[5] = {
@@ -29,7 +33,7 @@ public:
         typedef WorkGroupDimensionality WGD;
         KernelRequest kernels[] = {
             {
-                "grsmyr_monolithic.cl", "grsmyr_monolithic", "",
+                "grsmyr_monolithic.cl", "grsmyr_monolithic", GetCompileFlags(groestlTables),
                 WGD(256),
                 "$candidates, $wuData, $dispatchData, roundCount"
             }
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2015 Massimo Del Zotto
+ * This code is released under the MIT license.
+ * For conditions of distribution and use, see the LICENSE or hit the web.
+ */
+#pragma once
+#include "../AbstractAlgorithm.h"
+#include "NeoscryptPadLayout.h"
+
+namespace algoImplementations {
+
+/*! Same as NeoscryptSmoothCL12 but the Salsa and ChaCha loops are not serialized anymore. They only depend on the first KDF
+so they are dispatched together using the ns_coreLoop_1W.cl _dual kernels, each chain going to its own pad.
+This makes twice the wavefronts available at once, which helps cards which cannot be filled by the hashCount it is possible to
+allocate. The price is an additional pad, at lookup gap 1 this is 32 KiB per hash so memory goes from 34144 to 66912 bytes per hash.
+Lookup gap can be used to get some memory back. */
+class NeoscryptDualChainCL12 : public AbstractAlgorithm {
+public:
+    //! See NeoscryptSmoothCL12::lookupGap, applies to both pads.
+    const auint lookupGap;
+    const NeoscryptPadLayout padLayout;
+
+    NeoscryptDualChainCL12(cl_context ctx, cl_device_id dev, asizei concurrency, auint gap = 1, NeoscryptPadLayout layout = NeoscryptPadLayout::sliceInterleaved)
+        : AbstractAlgorithm(concurrency, ctx, dev, "Neoscrypt", "dualChain", "v1", 8), lookupGap(gap), padLayout(layout) { }
+
+    std::vector<std::string> Init(ConfigDesc *desc, AbstractSpecialValuesProvider &specials, const std::string &loadPathPrefix) {
+        if(lookupGap < 1 || lookupGap > 128) return std::vector<std::string>(1, "Neoscrypt lookup gap must be in [1..128], " + std::to_string(lookupGap) + " given.");
+        const asizei padEntries = (128 + lookupGap - 1) / lookupGap;
+        ResourceRequest resources[] = {
+            ResourceRequest("buffA", CL_MEM_HOST_NO_ACCESS, (256 + 64) * hashCount),
+            ResourceRequest("buffB", CL_MEM_HOST_NO_ACCESS, (256 + 32) * hashCount),
+            ResourceRequest("kdfResult", CL_MEM_HOST_NO_ACCESS, 256 * hashCount),
+            ResourceRequest("padSalsa", CL_MEM_HOST_NO_ACCESS, padEntries * 256 * hashCount),
+            ResourceRequest("padChacha", CL_MEM_HOST_NO_ACCESS, padEntries * 256 * hashCount),
+            ResourceRequest("xo", CL_MEM_HOST_NO_ACCESS, 256 * hashCount),
+            ResourceRequest("xi", CL_MEM_HOST_NO_ACCESS, 256 * hashCount),
+            Immediate<cl_uint>("LOOP_ITERATIONS", 128),
+            Immediate<cl_uint>("KDF_CONST_N", 32),
+            Immediate<cl_uint>("STATE_SLICES", 4),
+            Immediate<cl_uint>("MIX_ROUNDS", 10),
+            Immediate<cl_uint>("KDF_SIZE", 256)
+        };
+        resources[0].presentationName = "buff<sub>a</sub>";
+        resources[1].presentationName = "buff<sub>b</sub>";
+        resources[2].presentationName = "KDF result";
+        resources[3].presentationName = "Salsa X values buffer";
+        resources[4].presentationName = "Chacha X values buffer";
+        resources[5].presentationName = "Salsa results";
+        resources[6].presentationName = "Chacha results";
+        if(desc) return DescribeResources(*desc, resources, sizeof(resources) / sizeof(resources[0]), specials);
+        auto errors(PrepareResources(resources, sizeof(resources) / sizeof(resources[0]), specials));
+        if(errors.size()) return errors;
+
+        typedef WorkGroupDimensionality WGD;
+        const std::string dual("-D BLOCKMIX_DUAL" + (lookupGap > 1? " -D LOOKUP_GAP=" + std::to_string(lookupGap) : std::string()) + GetCompileFlags(padLayout));
+        KernelRequest kernels[] = {
+            {
+                "ns_KDF_4W.cl", "firstKDF_4way", "",
+                WGD(4, 16),
+                "$wuData, kdfResult, KDF_CONST_N, buffA, buffB"
+            },
+            {
+                "ns_coreLoop_1W.cl", "sequentialWrite_dual", dual,
+                WGD(2, 64),
+                "kdfResult, padSalsa, padChacha, LOOP_ITERATIONS, STATE_SLICES, MIX_ROUNDS, xo, xi"
+            },
+            {
+                "ns_coreLoop_1W.cl", "indirectedRead_dual", dual,
+                WGD(2, 64),
+                "xo, xi, padSalsa, padChacha, LOOP_ITERATIONS, STATE_SLICES, MIX_ROUNDS"
+            },
+            {
+                "ns_KDF_4W.cl", "lastKDF_4way", "",
+                WGD(4, 16),
+                "$candidates, $dispatchData, xo, xi, KDF_CONST_N, buffA, buffB, padSalsa"
+            }
+        };
+        return PrepareKernels(kernels, sizeof(kernels) / sizeof(kernels[0]), specials, loadPathPrefix);
+    }
+    bool BigEndian() const { return false; }
+    aulong GetDifficultyNumerator() const { return 0xFFFF000000000000ull; }
+};
+
+}
@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2015 Massimo Del Zotto
+ * This code is released under the MIT license.
+ * For conditions of distribution and use, see the LICENSE or hit the web.
+ */
+#pragma once
+#include "../../Common/AREN/ArenDataTypes.h"
+#include <string>
+
+namespace algoImplementations {
+
+/*! Pad buffer layouts supported by ns_coreLoop_1W.cl, see PAD_LAYOUT there. Values match the kernel defines.
+Which one is faster depends on the device memory subsystem so it is up to the caller to pick one, possibly by benchmarking. */
+enum class NeoscryptPadLayout {
+    sliceInterleaved, //!< the only one available originally, 16 uint per hash rotated by workgroup index, staged in LDS
+    hashMajor, //!< all entries of a hash are contiguous
+    uint4Strided //!< hashes interleaved every 4 uints
+};
+
+
+inline const char* GetName(NeoscryptPadLayout layout) {
+    switch(layout) {
+    case NeoscryptPadLayout::sliceInterleaved: return "slice interleaved";
+    case NeoscryptPadLayout::hashMajor: return "hash major";
+    case NeoscryptPadLayout::uint4Strided: return "uint4 strided";
+    }
+    return "<unknown>";
+}
+
+
+//! Compile flags to be appended to ns_coreLoop_1W.cl ones. Default layout produces no flags, so kernels built as they always have been.
+inline std::string GetCompileFlags(NeoscryptPadLayout layout) {
+    if(layout == NeoscryptPadLayout::sliceInterleaved) return std::string();
+    return " -D PAD_LAYOUT=" + std::to_string(static_cast<auint>(layout));
+}
+
+
+/*! Index of the uint in the whole pad buffer holding element el of slice (in pad order) of the given pad entry for hash slot.
+Pad buffer holds padEntries * 64 uints for each of hashCount hashes. This is what the host uses to reorder GPU pads. */
+inline asizei PadIndex(NeoscryptPadLayout layout, asizei hashCount, asizei padEntries, asizei slot, asizei entry, asizei slice, asizei el) {
+    const asizei block = entry * 4 + slice;
+    switch(layout) {
+    case NeoscryptPadLayout::hashMajor: return slot * padEntries * 64 + block * 16 + el;
+    case NeoscryptPadLayout::uint4Strided: return block * 16 * hashCount + (el / 4) * 4 * hashCount + slot * 4 + el % 4;
+    }
+    return block * 16 * hashCount + slot * 16 + (el + slot % 64) % 16; // staggered by local id, workgroups are 64 hashes
+}
+
+}
@@ -5,20 +5,29 @@
  */
 #pragma once
 #include "../AbstractAlgorithm.h"
+#include "NeoscryptPadLayout.h"
 
 namespace algoImplementations {
 
 class NeoscryptSmoothCL12 : public AbstractAlgorithm {
 public:
-    NeoscryptSmoothCL12(cl_context ctx, cl_device_id dev, asizei concurrency)
-        : AbstractAlgorithm(concurrency, ctx, dev, "Neoscrypt", "smooth", "v1", 8) { }
+    /*! Only one state every lookupGap iterations is kept in the pad buffer, the others are recomputed when needed.
+    Pad memory is therefore reduced lookupGap times, which allows to run more hashes at once on cards with not much memory. */
+    const auint lookupGap;
+    //! How the pad is arranged in memory. All layouts produce the same results but speed depends on the device.
+    const NeoscryptPadLayout padLayout;
+
+    NeoscryptSmoothCL12(cl_context ctx, cl_device_id dev, asizei concurrency, auint gap = 1, NeoscryptPadLayout layout = NeoscryptPadLayout::sliceInterleaved)
+        : AbstractAlgorithm(concurrency, ctx, dev, "Neoscrypt", "smooth", "v1", 8), lookupGap(gap), padLayout(layout) { }
 
     std::vector<std::string> Init(ConfigDesc *desc, AbstractSpecialValuesProvider &specials, const std::string &loadPathPrefix) {
+        if(lookupGap < 1 || lookupGap > 128) return std::vector<std::string>(1, "Neoscrypt lookup gap must be in [1..128], " + std::to_string(lookupGap) + " given.");
+        const asizei padEntries = (128 + lookupGap - 1) / lookupGap;
         ResourceRequest resources[] = {
             ResourceRequest("buffA", CL_MEM_HOST_NO_ACCESS, (256 + 64) * hashCount),
             ResourceRequest("buffB", CL_MEM_HOST_NO_ACCESS, (256 + 32) * hashCount),
             ResourceRequest("kdfResult", CL_MEM_HOST_NO_ACCESS, 256 * hashCount),
-            ResourceRequest("pad", CL_MEM_HOST_NO_ACCESS, 32 * 1024 * hashCount),
+            ResourceRequest("pad", CL_MEM_HOST_NO_ACCESS, padEntries * 256 * hashCount),
             ResourceRequest("xo", CL_MEM_HOST_NO_ACCESS, 256 * hashCount),
             ResourceRequest("xi", CL_MEM_HOST_NO_ACCESS, 256 * hashCount),
             Immediate<cl_uint>("LOOP_ITERATIONS", 128),
@@ -38,6 +47,8 @@ public:
         if(errors.size()) return errors;
 
         typedef WorkGroupDimensionality WGD;
+        const std::string gap((lookupGap > 1? " -D LOOKUP_GAP=" + std::to_string(lookupGap) : std::string()) + GetCompileFlags(padLayout));
+        const std::string salsa("-D BLOCKMIX_SALSA" + gap), chacha("-D BLOCKMIX_CHACHA" + gap);
         KernelRequest kernels[] = {
             {
                 "ns_KDF_4W.cl", "firstKDF_4way", "",
@@ -45,22 +56,22 @@ public:
                 "$wuData, kdfResult, KDF_CONST_N, buffA, buffB"
             },
             {
-                "ns_coreLoop_1W.cl", "sequentialWrite_1way", "-D BLOCKMIX_SALSA",
+                "ns_coreLoop_1W.cl", "sequentialWrite_1way", salsa,
                 WGD(64),
                 "kdfResult, pad, LOOP_ITERATIONS, STATE_SLICES, MIX_ROUNDS, xo"
             },
             {
-                "ns_coreLoop_1W.cl", "indirectedRead_1way", "-D BLOCKMIX_SALSA",
+                "ns_coreLoop_1W.cl", "indirectedRead_1way", salsa,
                 WGD(64),
                 "xo, pad, LOOP_ITERATIONS, STATE_SLICES, MIX_ROUNDS"
             },
             {
-                "ns_coreLoop_1W.cl", "sequentialWrite_1way", "-D BLOCKMIX_CHACHA",
+                "ns_coreLoop_1W.cl", "sequentialWrite_1way", chacha,
                 WGD(64),
                 "kdfResult, pad, LOOP_ITERATIONS, STATE_SLICES, MIX_ROUNDS, xi"
             },
             {
-                "ns_coreLoop_1W.cl", "indirectedRead_1way", "-D BLOCKMIX_CHACHA",
+                "ns_coreLoop_1W.cl", "indirectedRead_1way", chacha,
                 WGD(64),
                 "xi, pad, LOOP_ITERATIONS, STATE_SLICES, MIX_ROUNDS"
             },
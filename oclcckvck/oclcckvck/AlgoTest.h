@@ -21,6 +21,14 @@ public:
 
     asizei GetNumTests() const { return GetHeaders().second; }
 
+    //! Amount of hashes computed by RunTests, useful to turn test time into an hash rate.
+    aulong GetTotalHashes() const {
+        auto blocks(GetHeaders());
+        aulong count = 0;
+        for(asizei b = 0; b < blocks.second; b++) count += blocks.first[b].iterations * nominalHashCount;
+        return count;
+    }
+
     //! Tests must consume exact amounts of hashes at each step or run the risk of missing nonces or placing them in the wrong bucket.
     //! This returns true if the hashes can be divided correctly. If so, it's worth calling RunTests on the algorithm.
     bool CanRunTests(const asizei concurrency) const {
@@ -127,6 +135,7 @@ protected:
             case AlgoEvent::working: {
                 std::vector<cl_event> blockers;
                 dispatch.GetEvents(blockers); // in this case I can just wait here. This is not always possible.
+                trace::Span span("map wait");
                 ret = clWaitForEvents(cl_uint(blockers.size()), blockers.data());
                 for(auto ev : blockers) {
                     if(trigger.find(ev) == trigger.cend()) trigger.insert(ev);
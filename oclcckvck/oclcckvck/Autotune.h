@@ -0,0 +1,220 @@
+/*
+ * Copyright (C) 2015 Massimo Del Zotto
+ * This code is released under the MIT license.
+ * For conditions of distribution and use, see the LICENSE or hit the web.
+ */
+#pragma once
+#include "Benchmark.h"
+#include <CL/cl.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <sstream>
+#include <memory>
+
+
+/*! Best concurrency found for an algorithm implementation on a device. Keyed by device name and driver version, as both change the compiled
+code, and by the versioning hash of the implementation which changes with kernel sources and compile flags. Variants of an implementation
+(AES tables, Groestl tables, pad layouts...) have different versioning hashes and are therefore tuned independently.
+The same file also keeps the variant picked for each device by the tests benchmarking variants against each other, see PrintFastest.
+Kept in a text file, one entry for each line, tab separated as device names have spaces:
+    device  driver  versioningHash  concurrency  hashesPerSecond  p95ms
+    pick  device  driver  what  value  name
+versioningHash is hex, everything else decimal. what tells the choice, such as "Neoscrypt pad layout", value is what the implementation
+takes (the enum value or the lookup gap), name is only there for humans. Lines not making sense are ignored. */
+class TuningProfiles {
+public:
+    struct Entry {
+        asizei concurrency;
+        adouble hashesPerSecond;
+        adouble p95ms; //!< per dispatch latency
+        explicit Entry() : concurrency(0), hashesPerSecond(0), p95ms(0) { }
+    };
+
+    explicit TuningProfiles(const char *fileName) : file(fileName) {
+        std::ifstream disk(file);
+        std::string line;
+        while(std::getline(disk, line)) {
+            std::stringstream parse(line);
+            if(line.compare(0, 5, "pick\t") == 0) {
+                std::string skip;
+                PickKey key;
+                Pick pick;
+                std::getline(parse, skip, '\t');
+                std::getline(parse, key.device, '\t');
+                std::getline(parse, key.driver, '\t');
+                std::getline(parse, key.what, '\t');
+                parse>>pick.value;
+                parse.ignore(1);
+                std::getline(parse, pick.name);
+                if(!parse.fail() && key.device.length() && key.what.length()) picks[key] = pick;
+                continue;
+            }
+            Key key;
+            Entry entry;
+            std::getline(parse, key.device, '\t');
+            std::getline(parse, key.driver, '\t');
+            parse>>std::hex>>key.versioning>>std::dec>>entry.concurrency>>entry.hashesPerSecond>>entry.p95ms;
+            if(parse.fail() || key.device.empty() || entry.concurrency == 0) continue;
+            known[key] = entry;
+        }
+    }
+
+    bool Empty() const { return known.empty() && picks.empty(); }
+
+    bool Find(Entry &entry, cl_device_id device, aulong versioning) const {
+        auto match = known.find(Key(device, versioning));
+        if(match == known.cend()) return false;
+        entry = match->second;
+        return true;
+    }
+
+    //! Rewrites the whole file so a new winner replaces the old one.
+    void Store(cl_device_id device, aulong versioning, const Entry &entry) {
+        known[Key(device, versioning)] = entry;
+        Save();
+    }
+
+    //! Variant stored by StorePick for the choice what on the device. value is only changed if there's one.
+    bool FindPick(auint &value, cl_device_id device, const std::string &what) const {
+        auto match = picks.find(PickKey(device, what));
+        if(match == picks.cend()) return false;
+        value = match->second.value;
+        return true;
+    }
+
+    //! Rewrites the whole file so the new pick replaces the old one.
+    void StorePick(cl_device_id device, const std::string &what, auint value, const std::string &name) {
+        Pick pick;
+        pick.value = value;
+        pick.name = name;
+        picks[PickKey(device, what)] = pick;
+        Save();
+    }
+
+private:
+    struct Key {
+        std::string device, driver;
+        aulong versioning;
+        explicit Key() : versioning(0) { }
+        Key(cl_device_id dev, aulong v) : device(DeviceString(dev, CL_DEVICE_NAME)), driver(DeviceString(dev, CL_DRIVER_VERSION)), versioning(v) { }
+        bool operator<(const Key &other) const {
+            if(versioning != other.versioning) return versioning < other.versioning;
+            if(device != other.device) return device < other.device;
+            return driver < other.driver;
+        }
+    };
+    struct PickKey {
+        std::string device, driver, what;
+        explicit PickKey() { }
+        PickKey(cl_device_id dev, const std::string &choice) : device(DeviceString(dev, CL_DEVICE_NAME)), driver(DeviceString(dev, CL_DRIVER_VERSION)), what(choice) { }
+        bool operator<(const PickKey &other) const {
+            if(what != other.what) return what < other.what;
+            if(device != other.device) return device < other.device;
+            return driver < other.driver;
+        }
+    };
+    struct Pick {
+        auint value;
+        std::string name;
+        explicit Pick() : value(0) { }
+    };
+    const std::string file;
+    std::map<Key, Entry> known;
+    std::map<PickKey, Pick> picks;
+
+    void Save() const {
+        std::ofstream disk(file, std::ios::trunc);
+        for(const auto &el : known) {
+            disk<<el.first.device<<'\t'<<el.first.driver<<'\t'<<std::hex<<el.first.versioning<<'\t'<<std::dec;
+            disk<<el.second.concurrency<<'\t'<<el.second.hashesPerSecond<<'\t'<<el.second.p95ms<<std::endl;
+        }
+        for(const auto &el : picks) disk<<"pick\t"<<el.first.device<<'\t'<<el.first.driver<<'\t'<<el.first.what<<'\t'<<el.second.value<<'\t'<<el.second.name<<std::endl;
+    }
+
+    static std::string DeviceString(cl_device_id device, cl_device_info what) {
+        asizei required = 0;
+        clGetDeviceInfo(device, what, 0, NULL, &required);
+        std::vector<char> buff(required + 1);
+        if(clGetDeviceInfo(device, what, buff.size(), buff.data(), NULL) != CL_SUCCESS) return "<ERROR>";
+        std::string ret(buff.data());
+        for(auto &c : ret) {
+            if(c == '\t' || c == '\n') c = ' ';
+        }
+        return ret;
+    }
+};
+
+
+/*! Concurrencies tried by Autotune are the powers of two in [minConcurrency, maxConcurrency]. Each one is benchmarked, the one giving
+the most hashes/s wins as long as its p95 dispatch latency is at most latencyCapMs: a miner needs to get back to the device often
+enough to change the block header. */
+struct AutotuneSweep {
+    asizei minConcurrency;
+    asizei maxConcurrency;
+    adouble latencyCapMs;
+    asizei warmUp, repetitions;
+    explicit AutotuneSweep() : minConcurrency(1024), maxConcurrency(1024 * 256), latencyCapMs(200), warmUp(2), repetitions(8) { }
+};
+
+
+/*! Builds TestSubject with concurrency and Init it with a dispatcher, returns the versioning hash or throws the Init errors. */
+template<typename TestSubject, typename... Tunables>
+aulong BuildForTuning(std::unique_ptr<TestSubject> &imp, std::unique_ptr<StopWaitDispatcher> &dispatcher, cl_context ctx, cl_device_id dev, asizei concurrency, Tunables... tunables) {
+    dispatcher.reset();
+    imp.reset(new TestSubject(ctx, dev, concurrency, tunables...));
+    dispatcher.reset(new StopWaitDispatcher(*imp));
+    auto errors(imp->Init(nullptr, dispatcher->AsValueProvider(), ""));
+    if(errors.size()) {
+        std::string meh;
+        for(auto err : errors) meh += err + "\n\n";
+        throw meh;
+    }
+    return imp->GetVersioningHash();
+}
+
+
+/*! Sweep concurrency for TestSubject on a device. Only values the test data can be split in (AlgoTest::CanRunTests) are considered so the
+winner can be validated as usual. Values failing to initialize, usually for lack of memory, are skipped. Nothing is validated here:
+dispatches run an all-zero header with a zero target. Returns false if no value qualified. */
+template<typename TestData, typename TestSubject, typename... Tunables>
+bool Autotune(TuningProfiles::Entry &best, aulong &versioning, cl_context ctx, cl_device_id dev, const AutotuneSweep &sweep, Tunables... tunables) {
+    TestData test;
+    best = TuningProfiles::Entry();
+    for(asizei concurrency = sweep.minConcurrency; concurrency <= sweep.maxConcurrency; concurrency *= 2) {
+        if(!test.CanRunTests(concurrency)) continue;
+        std::unique_ptr<TestSubject> imp;
+        std::unique_ptr<StopWaitDispatcher> dispatcher;
+        try {
+            versioning = BuildForTuning(imp, dispatcher, ctx, dev, concurrency, tunables...);
+            dispatcher->BlockHeader(std::array<aubyte, 80>());
+            dispatcher->TargetBits(0);
+            const auto stats(Benchmark(*dispatcher, sweep.warmUp, sweep.repetitions));
+            if(stats.Percentile(95) > sweep.latencyCapMs) break; // only going to take longer from now on
+            if(stats.HashesPerSecond() > best.hashesPerSecond) {
+                best.concurrency = concurrency;
+                best.hashesPerSecond = stats.HashesPerSecond();
+                best.p95ms = stats.Percentile(95);
+            }
+        } catch(const std::string&) {
+        } catch(const char*) {
+        }
+    }
+    return best.concurrency != 0;
+}
+
+
+/*! Concurrency to use for TestSubject on a device: what profiles has for it or, if autotune, what Autotune finds, which is then stored.
+Otherwise fallback. The versioning hash keying profiles is peeked from an instance built with fallback concurrency, no kernel is built. */
+template<typename TestData, typename TestSubject, typename... Tunables>
+asizei TunedConcurrency(TuningProfiles &profiles, bool autotune, const AutotuneSweep &sweep, cl_context ctx, cl_device_id dev, asizei fallback, Tunables... tunables) {
+    if(!autotune && profiles.Empty()) return fallback;
+    aulong versioning = TestSubject(ctx, dev, fallback, tunables...).PeekVersioningHash("");
+    if(!versioning) return fallback; // will fail again and get reported by whoever uses it
+    TuningProfiles::Entry entry;
+    if(profiles.Find(entry, dev, versioning) && TestData().CanRunTests(entry.concurrency)) return entry.concurrency;
+    if(!autotune || !Autotune<TestData, TestSubject>(entry, versioning, ctx, dev, sweep, tunables...)) return fallback;
+    profiles.Store(dev, versioning, entry);
+    return entry.concurrency;
+}
@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2015 Massimo Del Zotto
+ * This code is released under the MIT license.
+ * For conditions of distribution and use, see the LICENSE or hit the web.
+ */
+#pragma once
+#include "StopWaitDispatcher.h"
+#include "AbstractAlgorithm.h"
+#include <chrono>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+
+/*! Timing an algorithm without anything else going on. Test times as Dispatch measures them include host checks and change with the
+amount of test blocks, this instead runs the very same dispatch over and over: a few warm-up ones which are not measured (first
+dispatch builds caches, wakes the GPU up from power saving...) then a fixed amount of measured ones, each one being hashCount
+hashes from the same nonce. Every dispatch is measured as the miner sees it: from buffer uploads to results being mapped. */
+struct BenchmarkStats {
+    asizei hashCount = 0; //!< hashes computed by each dispatch
+    std::vector<double> latency; //!< milliseconds taken by each measured dispatch, sorted
+
+    double Mean() const {
+        double sum = 0;
+        for(auto ms : latency) sum += ms;
+        return latency.size()? sum / latency.size() : .0;
+    }
+    //! Sample variance in ms^2.
+    double Variance() const {
+        if(latency.size() < 2) return .0;
+        const double mean = Mean();
+        double sum = 0;
+        for(auto ms : latency) sum += (ms - mean) * (ms - mean);
+        return sum / (latency.size() - 1);
+    }
+    //! Nearest rank percentile, p in [0..100].
+    double Percentile(double p) const {
+        if(latency.empty()) return .0;
+        asizei rank = asizei(std::ceil(p / 100.0 * latency.size()));
+        return latency[rank? rank - 1 : 0];
+    }
+    double HashesPerSecond() const {
+        const double mean = Mean();
+        return mean > .0? hashCount * 1000.0 / mean : .0;
+    }
+
+    std::string Describe() const {
+        std::stringstream build;
+        build<<std::fixed<<std::setprecision(1)<<HashesPerSecond() / 1000.0<<" kH/s over "<<latency.size()<<" dispatches of "<<hashCount<<" hashes, ";
+        build<<std::setprecision(3)<<"latency p50="<<Percentile(50)<<" p95="<<Percentile(95)<<" p99="<<Percentile(99)<<" ms, ";
+        build<<"stddev="<<std::sqrt(Variance())<<" ms";
+        return build.str();
+    }
+};
+
+
+/*! Complete whatever the dispatcher has in flight, results are thrown away.
+Step tests leave their result buffers mapped after checking, this makes Tick dispatch again. */
+inline void DrainDispatcher(StopWaitDispatcher &dispatcher) {
+    std::vector<cl_event> pending;
+    dispatcher.GetEvents(pending);
+    if(pending.empty()) return;
+    {
+        trace::Span span("map wait");
+        clWaitForEvents(cl_uint(pending.size()), pending.data());
+    }
+    std::set<cl_event> done(pending.cbegin(), pending.cend());
+    if(dispatcher.Tick(done) == AlgoEvent::results) dispatcher.GetResults();
+}
+
+
+/*! Run warmUp + repetitions dispatches of the algorithm driven by dispatcher, with whatever header and target it has.
+The algorithm must be already initialized and is restarted at nonce 0 before each dispatch. Nothing is validated. */
+inline BenchmarkStats Benchmark(StopWaitDispatcher &dispatcher, asizei warmUp, asizei repetitions) {
+    using namespace std::chrono;
+    BenchmarkStats stats;
+    stats.hashCount = dispatcher.algo.hashCount;
+    stats.latency.reserve(repetitions);
+    DrainDispatcher(dispatcher);
+    for(asizei loop = 0; loop < warmUp + repetitions; loop++) {
+        dispatcher.algo.Restart();
+        const auto start(high_resolution_clock::now());
+        std::set<cl_event> triggered;
+        if(dispatcher.Tick(triggered) != AlgoEvent::dispatched) throw std::string("Benchmark could not dispatch work.");
+        DrainDispatcher(dispatcher);
+        const auto finished(high_resolution_clock::now());
+        if(loop >= warmUp) stats.latency.push_back(duration_cast<duration<double, std::milli>>(finished - start).count());
+    }
+    std::sort(stats.latency.begin(), stats.latency.end());
+    return stats;
+}
+
+
+/*! Rough estimate of how busy a kernel keeps a compute unit. OpenCL tells neither how many wavefronts (warps) a compute unit keeps in flight
+nor how many registers a kernel takes so wavesPerCU is to be provided (40 on GCN, 64 warps on Maxwell) and registers only show up as
+CL_KERNEL_WORK_GROUP_SIZE going below the declared group size. Work groups resident on a compute unit are limited by LDS and wave slots. */
+struct KernelOccupancy {
+    asizei wavesPerGroup = 0;
+    adouble laneUse = 0; //!< work items / lanes of the waves they take, less than 1 means reqd_work_group_size leaves lanes idle
+    asizei groupsPerCU = 0;
+    adouble occupancy = 0; //!< waves in flight / wavesPerCU
+    bool ldsLimited = false; //!< else limited by wave slots
+    bool fits = true; //!< false if the driver reports the declared work group size cannot be dispatched
+
+    KernelOccupancy(const AbstractAlgorithm::KernelDesc &kernel, cl_ulong deviceLocalBytes, asizei wavesPerCU) {
+        const asizei items = kernel.WorkItems();
+        const asizei lanes = kernel.preferredMultiple? kernel.preferredMultiple : 1;
+        if(!items || !wavesPerCU) return;
+        wavesPerGroup = (items + lanes - 1) / lanes;
+        laneUse = adouble(items) / (wavesPerGroup * lanes);
+        fits = kernel.maxWorkGroupSize == 0 || items <= kernel.maxWorkGroupSize;
+        groupsPerCU = wavesPerCU / wavesPerGroup;
+        if(kernel.localBytes && deviceLocalBytes / kernel.localBytes < groupsPerCU) {
+            groupsPerCU = asizei(deviceLocalBytes / kernel.localBytes);
+            ldsLimited = true;
+        }
+        occupancy = adouble(groupsPerCU * wavesPerGroup) / wavesPerCU;
+    }
+};
@@ -3,19 +3,53 @@
  * This code is released under the MIT license.
  * For conditions of distribution and use, see the LICENSE or hit the web.
  */
-void AESRoundLDS(local uint *o0, local uint *o1, local uint *o2, local uint *o3, uint k0, uint k1, uint k2, uint k3,
-                 local uint *lut0, local uint *lut1, local uint *lut2, local uint *lut3) {
+/* AES T tables are copied to LDS at kernel start by default. AES_TABLES_GLOBAL reads them straight from the buffer instead,
+AES_TABLES_IMAGE from a 1D image of 4*256 uints (CL_R, CL_UNSIGNED_INT32) so they go through the texture cache.
+AES_TABLE_ROW_[1,2,3] select the rows being used in all cases, missing rows are obtained by rotating row 0. */
+#if defined AES_TABLES_IMAGE
+#define AES_TABLES_PARAM read_only image1d_t aes_round_luts
+#define AES_LUT_PARAMS read_only image1d_t luts
+#define AES_LUT(li, index) read_imageui(luts, (int)((li) * 256 + (index))).x
+#else
+#if defined AES_TABLES_GLOBAL
+#define AES_LUT_SPACE global
+#else
+#define AES_LUT_SPACE local
+#endif
+#define AES_TABLES_PARAM global uint *aes_round_luts
+#define AES_LUT_PARAMS AES_LUT_SPACE uint *lut0, AES_LUT_SPACE uint *lut1, AES_LUT_SPACE uint *lut2, AES_LUT_SPACE uint *lut3
+#define AES_LUT(li, index) lut##li[index]
+#endif
+
+#if defined AES_TABLE_ROW_1
+#define AES_HAS_ROW_1 1
+#else
+#define AES_HAS_ROW_1 0
+#endif
+#if defined AES_TABLE_ROW_2
+#define AES_HAS_ROW_2 1
+#else
+#define AES_HAS_ROW_2 0
+#endif
+#if defined AES_TABLE_ROW_3
+#define AES_HAS_ROW_3 1
+#else
+#define AES_HAS_ROW_3 0
+#endif
+
+
+void AESRoundLDS(local uint *o0, local uint *o1, local uint *o2, local uint *o3, uint k0, uint k1, uint k2, uint k3, AES_LUT_PARAMS) {
 #if __ENDIAN_LITTLE__
-#define LUT(li, val)  (lut##li != 0? lut##li[(val >> (8 * li)) & 0xFF] : rotate(lut0[(val >> (8 * li)) & 0xFF], (8u * li##u)))
+#define LUT(li, val)  (AES_HAS_ROW_##li? AES_LUT(li, (val >> (8 * li)) & 0xFF) : rotate(AES_LUT(0, (val >> (8 * li)) & 0xFF), (8u * li##u)))
 
     uint i0 = *o0;
     uint i1 = *o1;
     uint i2 = *o2;
     uint i3 = *o3;
-    *o0 = lut0[i0 & 0xFF] ^ LUT(1, i1) ^ LUT(2, i2) ^ LUT(3, i3) ^ k0;
-    *o1 = lut0[i1 & 0xFF] ^ LUT(1, i2) ^ LUT(2, i3) ^ LUT(3, i0) ^ k1;
-    *o2 = lut0[i2 & 0xFF] ^ LUT(1, i3) ^ LUT(2, i0) ^ LUT(3, i1) ^ k2;
-    *o3 = lut0[i3 & 0xFF] ^ LUT(1, i0) ^ LUT(2, i1) ^ LUT(3, i2) ^ k3;
+    *o0 = AES_LUT(0, i0 & 0xFF) ^ LUT(1, i1) ^ LUT(2, i2) ^ LUT(3, i3) ^ k0;
+    *o1 = AES_LUT(0, i1 & 0xFF) ^ LUT(1, i2) ^ LUT(2, i3) ^ LUT(3, i0) ^ k1;
+    *o2 = AES_LUT(0, i2 & 0xFF) ^ LUT(1, i3) ^ LUT(2, i0) ^ LUT(3, i1) ^ k2;
+    *o3 = AES_LUT(0, i3 & 0xFF) ^ LUT(1, i0) ^ LUT(2, i1) ^ LUT(3, i2) ^ k3;
 
 #undef LUT
 #else
@@ -24,9 +58,13 @@ void AESRoundLDS(local uint *o0, local uint *o1, local uint *o2, local uint *o3,
 }
 
 
-void AESRoundNoKeyLDS(local uint *o0, local uint *o1, local uint *o2, local uint *o3,
-                   local uint *lut0, local uint *lut1, local uint *lut2, local uint *lut3) {
-    AESRoundLDS(o0, o1, o2, o3, 0, 0, 0, 0, lut0, lut1, lut2, lut3);
+#if defined AES_TABLES_IMAGE
+#define AES_LUT_ARGS luts
+#else
+#define AES_LUT_ARGS lut0, lut1, lut2, lut3
+#endif
+void AESRoundNoKeyLDS(local uint *o0, local uint *o1, local uint *o2, local uint *o3, AES_LUT_PARAMS) {
+    AESRoundLDS(o0, o1, o2, o3, 0, 0, 0, 0, AES_LUT_ARGS);
 }
 
 /* stop of repeated code, below is echo specific */
@@ -75,12 +113,18 @@ uint Wrap(uint offset) {
 
 #if defined ECHO_IS_LAST
 __attribute__((reqd_work_group_size(8, 8, 1)))
-kernel void Echo_8way(global uint2 *input, volatile global uint *found, global uint *dispatchData, global uint *aes_round_luts) {
+kernel void Echo_8way(global uint2 *input, volatile global uint *found, global uint *dispatchData, AES_TABLES_PARAM) {
 #else
 __attribute__((reqd_work_group_size(8, 8, 1)))
-kernel void Echo_8way(global uint2 *input, global uint2 *hashOut, global uint *aes_round_luts, global uint *debug) {
+kernel void Echo_8way(global uint2 *input, global uint2 *hashOut, AES_TABLES_PARAM, global uint *debug) {
 #endif
     input += (get_global_id(1) - get_global_offset(1)) * 8;
+#if defined AES_TABLES_IMAGE
+#define AES_TABLES aes_round_luts
+#elif defined AES_TABLES_GLOBAL
+#define AES_TABLES aes_round_luts, aes_round_luts + 256 * 1, aes_round_luts + 256 * 2, aes_round_luts + 256 * 3
+#else
+#define AES_TABLES aesLUT0, aesLUT1, aesLUT2, aesLUT3
     local uint aesLUT0[256];
     event_t ldsReady = async_work_group_copy(aesLUT0, aes_round_luts + 256 * 0, 256, 0);
 #if defined AES_TABLE_ROW_1
@@ -100,6 +144,7 @@ kernel void Echo_8way(global uint2 *input, global uint2 *hashOut, global uint *a
     async_work_group_copy(aesLUT3, aes_round_luts + 256 * 3, 256, ldsReady);
 #else
     local uint *aesLUT3 = 0;
+#endif
 #endif
 
     /* Legacy 1-way kernels here have a boatload of registers here. Think at them as
@@ -142,7 +187,9 @@ kernel void Echo_8way(global uint2 *input, global uint2 *hashOut, global uint *a
         break;
     }
 
+#if !defined AES_TABLES_IMAGE && !defined AES_TABLES_GLOBAL
     wait_group_events(1, &ldsReady); // this is really necessary only a few lines below but here is nicer for structure
+#endif
     local uint passhi[4 * 8 * 8];
     local uint passlo[4 * 8 * 8];
 
@@ -166,9 +213,9 @@ kernel void Echo_8way(global uint2 *input, global uint2 *hashOut, global uint *a
                 local uint *x0 = passhi + slot + too, *x1 = passlo + slot + too;
                 local uint *x2 = passhi + slot + toi, *x3 = passlo + slot + toi;
                 barrier(CLK_LOCAL_MEM_FENCE);
-                AESRoundLDS(x0, x1, x2, x3, notSoK.x, notSoK.y, notSoK.z, notSoK.w, aesLUT0, aesLUT1, aesLUT2, aesLUT3);
+                AESRoundLDS(x0, x1, x2, x3, notSoK.x, notSoK.y, notSoK.z, notSoK.w, AES_TABLES);
                 barrier(CLK_LOCAL_MEM_FENCE);
-                AESRoundNoKeyLDS(x0, x1, x2, x3, aesLUT0, aesLUT1, aesLUT2, aesLUT3);
+                AESRoundNoKeyLDS(x0, x1, x2, x3, AES_TABLES);
                 Increment(&notSoK, 2);
             }
             slot += 8 * 8 * 2;
@@ -176,9 +223,9 @@ kernel void Echo_8way(global uint2 *input, global uint2 *hashOut, global uint *a
                 local uint *x0 = passhi + slot + too, *x1 = passlo + slot + too;
                 local uint *x2 = passhi + slot + toi, *x3 = passlo + slot + toi;
                 barrier(CLK_LOCAL_MEM_FENCE);
-                AESRoundLDS(x0, x1, x2, x3, notSoK.x, notSoK.y, notSoK.z, notSoK.w, aesLUT0, aesLUT1, aesLUT2, aesLUT3);
+                AESRoundLDS(x0, x1, x2, x3, notSoK.x, notSoK.y, notSoK.z, notSoK.w, AES_TABLES);
                 barrier(CLK_LOCAL_MEM_FENCE);
-                AESRoundNoKeyLDS(x0, x1, x2, x3, aesLUT0, aesLUT1, aesLUT2, aesLUT3);
+                AESRoundNoKeyLDS(x0, x1, x2, x3, AES_TABLES);
                 Increment(&notSoK, 16 - 2);
             }
         }
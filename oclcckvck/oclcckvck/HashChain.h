@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2015 Massimo Del Zotto
+ * This code is released under the MIT license.
+ * For conditions of distribution and use, see the LICENSE or hit the web.
+ */
+#pragma once
+#include "../Common/AREN/ArenDataTypes.h"
+#include <array>
+
+extern "C" {
+#include "../SPH/sph_batch.h"
+}
+
+
+/*! Host side hash chains put together at compile time, for example
+    typedef hashChain::Chain<hashChain::Luffa512, hashChain::CubeHash512, hashChain::Shavite512, hashChain::Simd512, hashChain::Echo512> Qubit;
+Each stage hashes many messages with a single call, so everything a stage can do across nonces (SSE2 CubeHash, context set up once for the common
+prefix) applies to the whole chain. Intermediate hashes are always 64 bytes and go back and forth between two buffers the caller provides.
+A stage is anything with
+    static void Batch(const void *prefix, asizei prefixLen, const void *data, asizei len, asizei count, void *dst);
+producing count 64 byte hashes of prefix followed by the len bytes of each message, same as the SPH batch API. */
+namespace hashChain {
+
+struct Luffa512 {
+    static void Batch(const void *prefix, asizei prefixLen, const void *data, asizei len, asizei count, void *dst) {
+        sph_luffa512_batch(prefix, prefixLen, data, len, count, dst);
+    }
+};
+
+struct CubeHash512 {
+    static void Batch(const void *prefix, asizei prefixLen, const void *data, asizei len, asizei count, void *dst) {
+        sph_cubehash512_batch(prefix, prefixLen, data, len, count, dst);
+    }
+};
+
+struct Shavite512 {
+    static void Batch(const void *prefix, asizei prefixLen, const void *data, asizei len, asizei count, void *dst) {
+        sph_shavite512_batch(prefix, prefixLen, data, len, count, dst);
+    }
+};
+
+struct Simd512 {
+    static void Batch(const void *prefix, asizei prefixLen, const void *data, asizei len, asizei count, void *dst) {
+        sph_simd512_batch(prefix, prefixLen, data, len, count, dst);
+    }
+};
+
+struct Echo512 {
+    static void Batch(const void *prefix, asizei prefixLen, const void *data, asizei len, asizei count, void *dst) {
+        sph_echo512_batch(prefix, prefixLen, data, len, count, dst);
+    }
+};
+
+struct Groestl512 {
+    static void Batch(const void *prefix, asizei prefixLen, const void *data, asizei len, asizei count, void *dst) {
+        sph_groestl512_batch(prefix, prefixLen, data, len, count, dst);
+    }
+};
+
+
+template<typename... Stages>
+struct Chain;
+
+//! Nothing to do, the last stage already wrote to dst.
+template<>
+struct Chain<> {
+    static const asizei stages = 0;
+    static void Batch(const void *prefix, asizei prefixLen, const void *data, asizei len, asizei count, void *dst, void *scratch) { }
+};
+
+template<typename Head, typename... Tail>
+struct Chain<Head, Tail...> {
+    static const asizei stages = 1 + sizeof...(Tail);
+
+    /*! Nonces going through Headers together. Their intermediate hashes, 2 * 64 bytes each, stay in L1 from a stage to the next
+    while the per-call cost of the stages (setting up the prefix) is still a small fraction. */
+    static const asizei LANES = 64;
+
+    /*! Same interface as a single stage, so chains are stages themselves. scratch is another count * 64 bytes, unused with a single stage.
+    Stages alternate between dst and scratch so that the last one writes dst. */
+    static void Batch(const void *prefix, asizei prefixLen, const void *data, asizei len, asizei count, void *dst, void *scratch) {
+        void *out = sizeof...(Tail) % 2? scratch : dst;
+        Head::Batch(prefix, prefixLen, data, len, count, out);
+        Chain<Tail...>::Batch(nullptr, 0, out, 64, count, dst, scratch);
+    }
+    static void Batch(const void *prefix, asizei prefixLen, const void *data, asizei len, asizei count, void *dst) {
+        aubyte scratch[LANES * 64];
+        for(asizei base = 0; base < count; base += LANES) {
+            const asizei lanes = count - base < LANES? count - base : LANES;
+            const aubyte *src = reinterpret_cast<const aubyte*>(data) + base * len;
+            Batch(prefix, prefixLen, src, len, lanes, reinterpret_cast<aubyte*>(dst) + base * 64, scratch);
+        }
+    }
+
+    /*! Hash the 80 byte block header for nonces [first, first + count), the nonce being its last uint.
+    The first 64 bytes are common to all nonces and go through the prefix. dst gets count * 64 bytes. */
+    static void Headers(void *dst, const std::array<auint, 20> &header, auint first, asizei count) {
+        auint tail[LANES * 4];
+        aubyte scratch[LANES * 64];
+        for(asizei base = 0; base < count; base += LANES) {
+            const asizei lanes = count - base < LANES? count - base : LANES;
+            for(asizei i = 0; i < lanes; i++) {
+                tail[i * 4 + 0] = header[16];
+                tail[i * 4 + 1] = header[17];
+                tail[i * 4 + 2] = header[18];
+                tail[i * 4 + 3] = first + auint(base + i);
+            }
+            Batch(header.data(), 64, tail, 16, lanes, reinterpret_cast<aubyte*>(dst) + base * 64, scratch);
+        }
+    }
+};
+
+
+typedef Chain<Luffa512, CubeHash512, Shavite512, Simd512, Echo512> Qubit;
+typedef Chain<Shavite512, Simd512, Shavite512, Simd512, Echo512> Fresh;
+
+}
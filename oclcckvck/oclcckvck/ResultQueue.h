@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2015 Massimo Del Zotto
+ * This code is released under the MIT license.
+ * For conditions of distribution and use, see the LICENSE or hit the web.
+ */
+#pragma once
+#include "../Common/AREN/ArenDataTypes.h"
+#include "NonceStructs.h"
+#include <atomic>
+#include <memory>
+#include <array>
+#include <utility>
+#include <cstdint>
+
+/*! Bounded multi producer, multi consumer queue without locks: each slot has a sequence number telling whether it is free to be written
+or ready to be read for the current lap, producers and consumers claim slots by bumping their own counter. Nobody ever waits
+on somebody else, a full queue makes TryPush fail and an empty one TryPop: what to do then is up to the caller.
+Capacity is rounded up to a power of two. T must be default constructible and movable.
+Counters wrap around, 32 bit ones in a few hours of a long soak, so they are only ever compared by their signed difference. */
+template<typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(asizei minCapacity) : mask(RoundUp(minCapacity) - 1), cells(new Cell[mask + 1]) {
+        for(asizei i = 0; i <= mask; i++) cells[i].sequence.store(i, std::memory_order_relaxed);
+        enqueuePos.store(0, std::memory_order_relaxed);
+        dequeuePos.store(0, std::memory_order_relaxed);
+    }
+
+    asizei Capacity() const { return mask + 1; }
+
+    //! Only a snapshot, it might be already wrong when returned.
+    asizei Depth() const {
+        const asizei in = enqueuePos.load(std::memory_order_relaxed), out = dequeuePos.load(std::memory_order_relaxed);
+        const intptr_t diff = intptr_t(in - out);
+        return diff > 0? asizei(diff) : 0;
+    }
+
+    //! Moves from value only if there was room.
+    bool TryPush(T &value) {
+        Cell *cell = nullptr;
+        asizei pos = enqueuePos.load(std::memory_order_relaxed);
+        while(true) {
+            cell = &cells[pos & mask];
+            const asizei seq = cell->sequence.load(std::memory_order_acquire);
+            const intptr_t diff = intptr_t(seq - pos);
+            if(diff == 0) {
+                if(enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            }
+            else if(diff < 0) return false; // slot still holding the previous lap
+            else pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+        cell->data = std::move(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool TryPop(T &value) {
+        Cell *cell = nullptr;
+        asizei pos = dequeuePos.load(std::memory_order_relaxed);
+        while(true) {
+            cell = &cells[pos & mask];
+            const asizei seq = cell->sequence.load(std::memory_order_acquire);
+            const intptr_t diff = intptr_t(seq - (pos + 1));
+            if(diff == 0) {
+                if(dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            }
+            else if(diff < 0) return false; // not written yet
+            else pos = dequeuePos.load(std::memory_order_relaxed);
+        }
+        value = std::move(cell->data);
+        cell->data = T();
+        cell->sequence.store(pos + mask + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    struct Cell {
+        std::atomic<asizei> sequence;
+        T data;
+    };
+    static asizei RoundUp(asizei value) {
+        asizei ret = 2;
+        while(ret < value) ret *= 2;
+        return ret;
+    }
+    const asizei mask;
+    std::unique_ptr<Cell[]> cells;
+    // Producers and consumers bump different counters, keep them on different cache lines.
+    char padBefore[64];
+    std::atomic<asizei> enqueuePos;
+    char padBetween[64];
+    std::atomic<asizei> dequeuePos;
+    char padAfter[64];
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+};
+
+
+/*! What a dispatch produced with everything needed to check it away from the dispatching thread. \sa StopWaitDispatcher::PushResults */
+struct DispatchResults {
+    asizei device = 0; //!< whatever the caller uses to tell dispatchers apart
+    MinedNonces found; //!< found.from is the header as dispatched, bytes of each uint swapped if bigEndian
+    aulong targetBits = 0; //!< the one dispatched
+    aulong difficultyNumerator = 0; //!< AbstractAlgorithm::GetDifficultyNumerator
+    asizei uintsPerHash = 0;
+    bool bigEndian = false;
+    aulong enqueued = 0; //!< trace::Now() when pushed, for queue latency
+
+    //! The header as the CPU miners take it, see AlgoTest::TestRun::clData.
+    std::array<aubyte, 80> HostHeader() const {
+        std::array<aubyte, 80> ret(found.from);
+        if(bigEndian) {
+            for(asizei i = 0; i < ret.size(); i += 4) {
+                std::swap(ret[i + 0], ret[i + 3]);
+                std::swap(ret[i + 1], ret[i + 2]);
+            }
+        }
+        return ret;
+    }
+};
+
+typedef BoundedQueue<DispatchResults> ResultQueue;
@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) 2015 Massimo Del Zotto
+ * This code is released under the MIT license.
+ * For conditions of distribution and use, see the LICENSE or hit the web.
+ */
+#pragma once
+#include "../Common/AREN/ArenDataTypes.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+
+/*! Every test and benchmark run appends a RunRecord to a history file, one JSON object per line so it can be appended to without parsing
+and fed as is to most tools. Records of two versions of the same kernels (versioning hashes) can then be compared to notice
+performance regressions, see CompareSignatures. */
+struct RunRecord {
+    std::string kind; //!< "test" or "benchmark"
+    std::string platform, device, driver;
+    std::string algorithm, implementation, version;
+    aulong versioning = 0;
+    aulong concurrency = 0; //!< hashes computed by each dispatch, AbstractAlgorithm::hashCount
+    aulong hashCount = 0; //!< hashes computed by the whole run
+    adouble ms = 0;
+    aulong errors = 0; //!< tests only
+    std::string check; //!< tests only: "full", "sampled" or "golden" for step tests, "nonces" for algorithms
+    adouble hashesPerSecond = 0;
+    adouble p50 = 0, p95 = 0, p99 = 0; //!< benchmarks only, dispatch latency in ms
+    aulong time = 0; //!< seconds since epoch, set by AppendRecord
+
+    std::string ToJSON() const {
+        std::stringstream build;
+        build.precision(12);
+        build<<"{\"time\":"<<time<<",\"kind\":"<<Quote(kind);
+        build<<",\"platform\":"<<Quote(platform)<<",\"device\":"<<Quote(device)<<",\"driver\":"<<Quote(driver);
+        build<<",\"algorithm\":"<<Quote(algorithm)<<",\"implementation\":"<<Quote(implementation)<<",\"version\":"<<Quote(version);
+        build<<",\"versioning\":\""<<std::hex<<std::setw(16)<<std::setfill('0')<<versioning<<std::dec<<std::setfill(' ')<<'"';
+        build<<",\"concurrency\":"<<concurrency<<",\"hashCount\":"<<hashCount<<",\"ms\":"<<ms;
+        if(kind == "test") build<<",\"errors\":"<<errors<<",\"check\":"<<Quote(check);
+        build<<",\"hashesPerSecond\":"<<hashesPerSecond;
+        if(kind == "benchmark") build<<",\"p50\":"<<p50<<",\"p95\":"<<p95<<",\"p99\":"<<p99;
+        build<<'}';
+        return build.str();
+    }
+
+    //! Parses what ToJSON produces. Unknown keys are ignored, returns false if this does not look like a record at all.
+    bool FromJSON(const std::string &json) {
+        std::map<std::string, std::string> field;
+        asizei at = json.find('{');
+        if(at == std::string::npos) return false;
+        at++;
+        while(at < json.length()) {
+            std::string key, value;
+            if(!Token(key, json, at) || at >= json.length() || json[at] != ':') return false;
+            at++;
+            if(!Token(value, json, at)) return false;
+            field[key] = value;
+            if(at < json.length() && json[at] == ',') at++;
+            else break;
+        }
+        if(field.find("kind") == field.cend() || field.find("versioning") == field.cend()) return false;
+        auto get = [&field](const char *key) -> std::string {
+            auto match = field.find(key);
+            return match != field.cend()? match->second : std::string();
+        };
+        auto number = [&get](const char *key) -> adouble {
+            const std::string value(get(key));
+            return value.length()? std::stod(value) : .0;
+        };
+        kind = get("kind");
+        platform = get("platform");
+        device = get("device");
+        driver = get("driver");
+        algorithm = get("algorithm");
+        implementation = get("implementation");
+        version = get("version");
+        versioning = std::stoull(get("versioning"), nullptr, 16);
+        concurrency = aulong(number("concurrency"));
+        hashCount = aulong(number("hashCount"));
+        ms = number("ms");
+        errors = aulong(number("errors"));
+        check = get("check");
+        hashesPerSecond = number("hashesPerSecond");
+        p50 = number("p50");
+        p95 = number("p95");
+        p99 = number("p99");
+        time = aulong(number("time"));
+        return true;
+    }
+
+private:
+    static std::string Quote(const std::string &str) {
+        std::string ret("\"");
+        for(auto c : str) {
+            if(c == '"' || c == '\\') ret += '\\';
+            if(c >= 0 && c < ' ') continue;
+            ret += c;
+        }
+        return ret + '"';
+    }
+
+    //! A string (unescaped) or a bare number at json[at], at is moved past it.
+    static bool Token(std::string &out, const std::string &json, asizei &at) {
+        out.clear();
+        if(at < json.length() && json[at] == '"') {
+            for(at++; at < json.length() && json[at] != '"'; at++) {
+                if(json[at] == '\\') at++;
+                if(at < json.length()) out += json[at];
+            }
+            if(at >= json.length()) return false;
+            at++;
+            return true;
+        }
+        while(at < json.length() && json[at] != ',' && json[at] != '}') out += json[at++];
+        return out.length() != 0;
+    }
+};
+
+
+inline void AppendRecord(const char *fileName, RunRecord record) {
+    using namespace std::chrono;
+    record.time = aulong(duration_cast<seconds>(system_clock::now().time_since_epoch()).count());
+    std::ofstream disk(fileName, std::ios::app);
+    disk<<record.ToJSON()<<std::endl;
+}
+
+
+inline std::vector<RunRecord> LoadRecords(const char *fileName) {
+    std::vector<RunRecord> ret;
+    std::ifstream disk(fileName);
+    std::string line;
+    while(std::getline(disk, line)) {
+        RunRecord record;
+        try {
+            if(record.FromJSON(line)) ret.push_back(record);
+        } catch(const std::exception&) { } // malformed numbers, skip the line
+    }
+    return ret;
+}
+
+
+/*! For each device having benchmarks of both signatures, compare the hashes/s of the latest benchmark of each. Only benchmarks of the
+same implementation at the same concurrency are compared, runs of a concurrency sweep or with a tuned concurrency do not replace
+each other. Changes are printed, candidate being slower than baseline by more than thresholdPercent is a regression.
+Returns the amount of regressions, so it can be used as exit code to gate kernel changes. */
+inline asizei CompareSignatures(const std::vector<RunRecord> &history, aulong baseline, aulong candidate, adouble thresholdPercent, std::ostream &out) {
+    struct RunKey {
+        std::string device, driver, implementation;
+        aulong concurrency;
+        bool operator<(const RunKey &other) const {
+            if(device != other.device) return device < other.device;
+            if(driver != other.driver) return driver < other.driver;
+            if(implementation != other.implementation) return implementation < other.implementation;
+            return concurrency < other.concurrency;
+        }
+    };
+    std::map<RunKey, std::pair<const RunRecord*, const RunRecord*>> latest;
+    for(const auto &record : history) {
+        if(record.kind != "benchmark") continue;
+        if(record.versioning != baseline && record.versioning != candidate) continue;
+        const RunKey key = { record.device, record.driver, record.algorithm + '.' + record.implementation, record.concurrency };
+        auto &slot(latest[key]);
+        auto &pick(record.versioning == baseline? slot.first : slot.second);
+        if(!pick || pick->time <= record.time) pick = &record;
+    }
+    asizei regressions = 0, compared = 0;
+    for(const auto &el : latest) {
+        if(!el.second.first || !el.second.second) continue;
+        const RunRecord &base(*el.second.first), &cand(*el.second.second);
+        if(base.hashesPerSecond <= 0) continue;
+        const adouble change = (cand.hashesPerSecond / base.hashesPerSecond - 1) * 100;
+        const bool regressed = change < -thresholdPercent;
+        out<<el.first.device<<" ("<<el.first.driver<<"), "<<el.first.implementation<<" x"<<el.first.concurrency<<": "<<std::fixed<<std::setprecision(1)<<base.hashesPerSecond / 1000<<" -> ";
+        out<<cand.hashesPerSecond / 1000<<" kH/s, "<<std::showpos<<change<<std::noshowpos<<'%'<<(regressed? " REGRESSION" : "")<<std::endl;
+        compared++;
+        if(regressed) regressions++;
+    }
+    if(!compared) out<<"No device has benchmarks of both signatures for the same implementation and concurrency."<<std::endl;
+    return regressions;
+}
@@ -16,17 +16,37 @@ whatever it's easier to understand can be debated.
 */
 
 
+/* AES T tables are copied to LDS at kernel start by default. AES_TABLES_GLOBAL reads them straight from the buffer instead,
+AES_TABLES_IMAGE from a 1D image of 4*256 uints (CL_R, CL_UNSIGNED_INT32) so they go through the texture cache. */
+#if defined AES_TABLES_IMAGE
+#define AES_TABLES_PARAM read_only image1d_t aes_round_luts
+#define AES_LUT_PARAMS read_only image1d_t luts
+#define AES_LUT_ARGS luts
+#define AES_LUT(li, index) read_imageui(luts, (int)((li) * 256 + (index))).x
+#else
+#if defined AES_TABLES_GLOBAL
+#define AES_LUT_SPACE global
+#else
+#define AES_LUT_SPACE local
+#endif
+#define AES_TABLES_PARAM global uint *aes_round_luts
+#define AES_LUT_PARAMS AES_LUT_SPACE uint *lut0, AES_LUT_SPACE uint *lut1, AES_LUT_SPACE uint *lut2, AES_LUT_SPACE uint *lut3
+#define AES_LUT_ARGS lut0, lut1, lut2, lut3
+#define AES_LUT(li, index) lut##li[index]
+#endif
+
+
 /*! The basic building block of SHAVite-3 is the AES round.
 Because of the way it's used this does not need a pointer to modify registers in-place
 as the input parameter is always a temporary. */
-uint4 AESR(uint4 val, uint4 k, local uint *lut0, local uint *lut1, local uint *lut2, local uint *lut3) {
+uint4 AESR(uint4 val, uint4 k, AES_LUT_PARAMS) {
 #if __ENDIAN_LITTLE__
-#define LUT(li, val)  (lut##li != 0? lut##li[(val >> (8 * li)) & 0xFF] : rotate(lut0[(val >> (8 * li)) & 0xFF], (8u * li##u)))
+#define LUT(li, val)  AES_LUT(li, (val >> (8 * li)) & 0xFF)
     uint4 result;
-    result.s0 = lut0[val.s0 & 0xFF] ^ LUT(1, val.s1) ^ LUT(2, val.s2) ^ LUT(3, val.s3) ^ k.s0;
-    result.s1 = lut0[val.s1 & 0xFF] ^ LUT(1, val.s2) ^ LUT(2, val.s3) ^ LUT(3, val.s0) ^ k.s1;
-    result.s2 = lut0[val.s2 & 0xFF] ^ LUT(1, val.s3) ^ LUT(2, val.s0) ^ LUT(3, val.s1) ^ k.s2;
-    result.s3 = lut0[val.s3 & 0xFF] ^ LUT(1, val.s0) ^ LUT(2, val.s1) ^ LUT(3, val.s2) ^ k.s3;
+    result.s0 = LUT(0, val.s0) ^ LUT(1, val.s1) ^ LUT(2, val.s2) ^ LUT(3, val.s3) ^ k.s0;
+    result.s1 = LUT(0, val.s1) ^ LUT(1, val.s2) ^ LUT(2, val.s3) ^ LUT(3, val.s0) ^ k.s1;
+    result.s2 = LUT(0, val.s2) ^ LUT(1, val.s3) ^ LUT(2, val.s0) ^ LUT(3, val.s1) ^ k.s2;
+    result.s3 = LUT(0, val.s3) ^ LUT(1, val.s0) ^ LUT(2, val.s1) ^ LUT(3, val.s2) ^ k.s3;
 #undef LUT
 #else
 #error Endianness?
@@ -35,8 +55,8 @@ uint4 AESR(uint4 val, uint4 k, local uint *lut0, local uint *lut1, local uint *l
 }
 
 
-uint4 AESRNK(uint4 val, local uint *lut0, local uint *lut1, local uint *lut2, local uint *lut3) {
-    return AESR(val, (uint4)(0, 0, 0, 0), lut0, lut1, lut2, lut3);
+uint4 AESRNK(uint4 val, AES_LUT_PARAMS) {
+    return AESR(val, (uint4)(0, 0, 0, 0), AES_LUT_ARGS);
 }
 
 
@@ -73,7 +93,7 @@ uint4 OffOne(uint4 *vals, uint start) {
 
 
 __attribute__((reqd_work_group_size(64, 1, 1)))
-kernel void SHAvite3_1way(global uint *input, global uint *hashOut, global uint *aes_round_luts, const uint roundCount) {
+kernel void SHAvite3_1way(global uint *input, global uint *hashOut, AES_TABLES_PARAM, const uint roundCount) {
 #ifdef HEAD_OF_CHAINED_HASHING
 // do nothing to input. We all fetch the same thing.
 #else
@@ -84,12 +104,18 @@ kernel void SHAvite3_1way(global uint *input, global uint *hashOut, global uint
 
 
 
+#if defined AES_TABLES_IMAGE
+#define TABLES aes_round_luts
+#elif defined AES_TABLES_GLOBAL
+#define TABLES aes_round_luts, aes_round_luts + 256 * 1, aes_round_luts + 256 * 2, aes_round_luts + 256 * 3
+#else
     local uint TBL0[256], TBL1[256], TBL2[256], TBL3[256];
 #define TABLES TBL0, TBL1, TBL2, TBL3
     event_t ldsReady = async_work_group_copy(TBL0, aes_round_luts + 256 * 0, 256, 0);
     async_work_group_copy(TBL1, aes_round_luts + 256 * 1, 256, ldsReady);
     async_work_group_copy(TBL2, aes_round_luts + 256 * 2, 256, ldsReady);
     async_work_group_copy(TBL3, aes_round_luts + 256 * 3, 256, ldsReady);
+#endif
 
     uint4 rk[4+4], hashing[4], p[4];
     for(uint init = 0; init < 4; init++) {
@@ -126,7 +152,9 @@ kernel void SHAvite3_1way(global uint *input, global uint *hashOut, global uint
             rk[4 + 0].s2 = as_uint(as_uchar4(rk[4 + 0].s2).wzyx);
         #endif
     #endif
+#if !defined AES_TABLES_IMAGE && !defined AES_TABLES_GLOBAL
     wait_group_events(1, &ldsReady);
+#endif
     { // Round [0] is the easiest so let's have it there directly.
         uint4 temp; // in lib SPH, that's 'x'
         temp = AESRNK(p[1] ^ rk[0 + 0], TABLES);
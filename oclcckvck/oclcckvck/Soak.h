@@ -0,0 +1,193 @@
+/*
+ * Copyright (C) 2015 Massimo Del Zotto
+ * This code is released under the MIT license.
+ * For conditions of distribution and use, see the LICENSE or hit the web.
+ */
+#pragma once
+#include "NonceStructs.h"
+#include "ResultQueue.h"
+#include "Trace.h"
+#include "TestData/CPUMiners.h"
+#include "../Common/hashing.h"
+#include "../Common/AREN/SerializationBuffers.h"
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <exception>
+
+/*! Soaking runs an algorithm for hours on random headers with a target low enough to produce a few candidates for each dispatch.
+Every candidate is checked on the host: a device computing a value different from the CPU miner, or one not passing target,
+is a hardware error. A single validation pass takes seconds, overclocked cards usually start miscomputing once warm. */
+
+/*! Check each candidate against the CPU miner. Kernels output uints 6 and 7 of the final hash as they compare them to target
+so those are compared to CPUMiner::HostMagic. Nonces come out bytes swapped, they are returned as such. Nonces the device missed
+cannot be noticed without scanning the whole range, the kernels being the same this is no different than validation anyway.
+Share difficulties are the algorithm difficulty numerator over the magic (or target), same as pools do. */
+inline VerifiedNonces Verify(const testData::CPUMiner &miner, const DispatchResults &batch) {
+    VerifiedNonces ret;
+    ret.device = batch.device;
+    ret.nonce2 = 0;
+    ret.targetDiff = batch.targetBits? adouble(batch.difficultyNumerator) / batch.targetBits : .0;
+    const std::array<aubyte, 80> header(batch.HostHeader());
+    const asizei count = batch.found.nonces.size();
+    for(asizei i = 0; i < count; i++) {
+        if((i + 1) * batch.uintsPerHash > batch.found.hashes.size() || batch.uintsPerHash < 8) {
+            ret.wrong++;
+            continue;
+        }
+        const auint *hash = batch.found.hashes.data() + i * batch.uintsPerHash;
+        const aulong deviceMagic = (aulong(hash[7]) << 32) | hash[6];
+        const aulong hostMagic = miner.HostMagic(header.data(), SWAP_BYTES(batch.found.nonces[i]));
+        if(hostMagic != deviceMagic || !miner.Accepts(hostMagic, batch.targetBits)) {
+            ret.wrong++;
+            continue;
+        }
+        VerifiedNonces::Nonce good;
+        good.nonce = batch.found.nonces[i];
+        good.diff = hostMagic? adouble(batch.difficultyNumerator) / hostMagic : adouble(batch.difficultyNumerator);
+        memcpy_s(good.hashSlice.data(), sizeof(good.hashSlice), hash + 7, sizeof(good.hashSlice));
+        ret.nonces.push_back(good);
+    }
+    return ret;
+}
+
+
+//! Running totals of a device.
+struct SoakTally {
+    aulong hashes = 0; //!< dispatched
+    aulong candidates = 0; //!< returned by the device and checked
+    aulong wrong = 0; //!< VerifiedNonces::wrong, accumulated
+    void Add(const VerifiedNonces &checked) {
+        candidates += checked.Total();
+        wrong += checked.wrong;
+    }
+    adouble ErrorRate() const { return candidates? adouble(wrong) / candidates : .0; }
+};
+
+
+//! Snapshot of how a VerifierPool keeps up with the devices. Latency goes from StopWaitDispatcher::PushResults to the check being tallied.
+struct VerifierMetrics {
+    asizei capacity = 0;
+    aulong batches = 0; //!< checked so far
+    adouble meanDepth = 0; //!< batches already waiting when a new one was pushed
+    asizei maxDepth = 0;
+    aulong stalls = 0; //!< times a dispatcher found the queue full, those delay the next dispatch
+    adouble meanLatencyMs = 0, maxLatencyMs = 0;
+};
+
+
+/*! Host threads checking candidates with Verify while the devices keep going. Dispatchers push to Queue() without ever taking a lock,
+workers poll it backing off to short sleeps when there's nothing to do so an idle pool costs next to nothing. A full queue makes
+dispatchers wait (see StopWaitDispatcher::PushResults) so a slow host slows down dispatching rather than piling up memory for hours.
+The first exception thrown by a check is rethrown by Drain. */
+class VerifierPool {
+public:
+    /*! Without threads, all the host threads but one, which is left to dispatching. */
+    VerifierPool(const testData::CPUMiner &checker, asizei devices, asizei threads = 0)
+        : miner(checker), tallies(devices), queue(ThreadCount(threads) * 4) {
+        pushed = completed = stalls = depthSum = depthMax = latencySum = latencyMax = 0;
+        stop = false;
+        threads = ThreadCount(threads);
+        for(asizei t = 0; t < threads; t++) workers.push_back(std::thread([this]() { Work(); }));
+    }
+    ~VerifierPool() {
+        stop = true;
+        for(auto &w : workers) w.join();
+    }
+
+    //! Pass to StopWaitDispatcher::PushResults, then call Pushed with what it returned.
+    ResultQueue& Queue() { return queue; }
+
+    /*! Accounting for a batch just pushed. Depth is sampled here so it tells how far behind the workers are when a new one comes.
+    Hashes go to the tallies as soon as they are dispatched, candidates when verified. */
+    void Pushed(asizei device, aulong hashes, asizei fullQueue) {
+        const asizei depth = queue.Depth();
+        pushed++;
+        stalls += fullQueue;
+        depthSum += depth;
+        RaiseTo(depthMax, depth);
+        std::unique_lock<std::mutex> lock(guard);
+        tallies[device].hashes += hashes;
+    }
+
+    //! Wait for everything pushed to be checked.
+    void Drain() {
+        while(completed.load() != pushed.load()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        std::unique_lock<std::mutex> lock(guard);
+        if(failure) std::rethrow_exception(failure);
+    }
+
+    std::vector<SoakTally> Tallies() const {
+        std::unique_lock<std::mutex> lock(guard);
+        return tallies;
+    }
+
+    VerifierMetrics Metrics() const {
+        VerifierMetrics ret;
+        ret.capacity = queue.Capacity();
+        const aulong in = pushed.load(), out = completed.load();
+        ret.batches = out;
+        ret.meanDepth = in? adouble(depthSum.load()) / in : .0;
+        ret.maxDepth = asizei(depthMax.load());
+        ret.stalls = stalls.load();
+        ret.meanLatencyMs = out? latencySum.load() / 1000000.0 / out : .0;
+        ret.maxLatencyMs = latencyMax.load() / 1000000.0;
+        return ret;
+    }
+
+private:
+    const testData::CPUMiner &miner;
+    std::vector<std::thread> workers;
+    mutable std::mutex guard; //!< tallies and failure only, never held while checking
+    std::exception_ptr failure;
+    std::vector<SoakTally> tallies;
+    ResultQueue queue;
+    std::atomic<bool> stop;
+    std::atomic<aulong> pushed, completed, stalls, depthSum, depthMax, latencySum, latencyMax;
+
+    static asizei ThreadCount(asizei threads) {
+        if(threads) return threads;
+        return std::thread::hardware_concurrency() > 1? std::thread::hardware_concurrency() - 1 : 1;
+    }
+
+    static void RaiseTo(std::atomic<aulong> &max, aulong value) {
+        aulong was = max.load();
+        while(was < value && !max.compare_exchange_weak(was, value)) { }
+    }
+
+    void Work() {
+        hashing::ScratchArena::ThreadScope arena;
+        asizei idle = 0;
+        DispatchResults batch;
+        while(true) {
+            if(!queue.TryPop(batch)) {
+                if(stop) break;
+                if(++idle < 64) std::this_thread::yield();
+                else std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+            idle = 0;
+            VerifiedNonces checked;
+            std::exception_ptr error;
+            try {
+                trace::Span span("Verify");
+                checked = Verify(miner, batch);
+            } catch(...) {
+                error = std::current_exception();
+            }
+            const aulong now = trace::Now();
+            const aulong latency = now > batch.enqueued? now - batch.enqueued : 0;
+            {
+                std::unique_lock<std::mutex> lock(guard);
+                if(error && !failure) failure = error;
+                tallies[batch.device].Add(checked);
+            }
+            latencySum += latency;
+            RaiseTo(latencyMax, latency);
+            completed++;
+        }
+        trace::ReleaseThisThread();
+    }
+};
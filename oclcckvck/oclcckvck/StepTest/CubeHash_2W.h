@@ -12,13 +12,14 @@
 
 extern "C" {
 #include "../../SPH/sph_cubehash.h"
+#include "../../SPH/sph_batch.h"
 }
 
 
 namespace stepTest {
 
 
-struct CubeHash_2W : public AbstractAlgorithm {
+struct CubeHash_2W : public AbstractAlgorithm, BatchedReferences {
     typedef Hash512Mismatch ValidationMismatch;
     typedef BadResultsList<Hash512Mismatch> BadResults;
 
@@ -52,24 +53,15 @@ struct CubeHash_2W : public AbstractAlgorithm {
     }
     bool BigEndian() const { return true; }
 
-    bool Mismatch(ValidationMismatch &bad, auint nonce) const {
-        std::array<auint, 16> reference;
-        std::array<auint, 16> input; // Cubehash apparently needs bytes in different order to match
-        for(asizei cp = 0; cp < input.size(); cp++) input[cp] = HTOBE(dummyPrevious[nonce * 16 + cp]);
+    void References(auint *hashes, asizei first, asizei count) const {
+        std::vector<auint> input(count * 16); // Cubehash apparently needs bytes in different order to match
+        for(asizei cp = 0; cp < input.size(); cp++) input[cp] = HTOBE(dummyPrevious[first * 16 + cp]);
         for(asizei cp = 0; cp < input.size(); cp += 2) std::swap(input[cp], input[cp + 1]);
-		{
-			sph_cubehash512_context ctx;
-			sph_cubehash512_init(&ctx);
-			sph_cubehash512(&ctx, input.data(), sizeof(input));
-			sph_cubehash512_close(&ctx, reference.data());
-		}
-        if(memcmp(blob + nonce * 16, reference.data(), sizeof(reference))) {
-            std::array<cl_uint, 16> computed;
-            for(asizei cp = 0; cp < 16; cp++) computed[cp] = blob[nonce * 16 + cp];
-            bad = ValidationMismatch(computed, reference, nonce);
-            return true;
-        }
-        return false;
+        sph_cubehash512_batch(nullptr, 0, input.data(), sizeof(auint) * 16, count, hashes);
+    }
+
+    bool Mismatch(ValidationMismatch &bad, auint nonce, const auint *reference) const {
+        return Hash512Mismatches(bad, blob, nonce, reference);
     }
 
     void MapResults(cl_command_queue cq) {
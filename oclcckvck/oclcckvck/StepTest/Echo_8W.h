@@ -12,13 +12,14 @@
 
 extern "C" {
 #include "../../SPH/sph_echo.h"
+#include "../../SPH/sph_batch.h"
 }
 
 
 namespace stepTest {
 
 
-struct ECHO_8W : public AbstractAlgorithm {
+struct ECHO_8W : public AbstractAlgorithm, BatchedReferences {
     std::vector<auint> dummyPrevious;
     cl_mem candidates = 0;
     const aulong target = 0x9FFFFFF000000ull;
@@ -60,17 +61,11 @@ struct ECHO_8W : public AbstractAlgorithm {
     }
     bool BigEndian() const { return true; }
 
-    aulong GetMagic(asizei hash) const {
-        const auint *input = dummyPrevious.data() + hash * 16;
-        std::array<auint, 16> refHash;
-        {
-            sph_echo512_context ctx;
-            sph_echo512_init(&ctx);
-            sph_echo512(&ctx, input, sizeof(auint) * 16);
-            sph_echo512_close(&ctx, refHash.data());
-        }
-        return (aulong(refHash[7]) << 32) | refHash[6];
+    void References(auint *hashes, asizei first, asizei count) const {
+        sph_echo512_batch(nullptr, 0, dummyPrevious.data() + first * 16, sizeof(auint) * 16, count, hashes);
     }
+
+    aulong GetMagic(const auint *reference) const { return (aulong(reference[7]) << 32) | reference[6]; }
     aulong GetDifficultyNumerator() const { return 0; } // unused, not a real mining algo
 };
 
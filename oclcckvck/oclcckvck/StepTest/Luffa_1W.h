@@ -14,13 +14,14 @@
 
 extern "C" {
 #include "../../SPH/sph_luffa.h"
+#include "../../SPH/sph_batch.h"
 }
 
 
 namespace stepTest {
 
 
-struct Luffa_1W : public AbstractAlgorithm {
+struct Luffa_1W : public AbstractAlgorithm, BatchedReferences {
     typedef Hash512Mismatch ValidationMismatch;
     typedef BadResultsList<Hash512Mismatch> BadResults;
 
@@ -49,26 +50,20 @@ struct Luffa_1W : public AbstractAlgorithm {
     }
     bool BigEndian() const { return true; }
 
-    bool Mismatch(ValidationMismatch &bad, std::array<auint, 20> &block, auint nonce) const {
-        block[19] = nonce;
-        std::array<auint, 16> reference;
-        {
-            sph_luffa512_context head;
-            sph_luffa512_init(&head);
-            sph_luffa512(&head, block.data(), sizeof(block));
-            sph_luffa512_close(&head, reference.data());
+    //! First 64 bytes of the header are the same for all hashes so they are hashed only once.
+    void References(auint *hashes, const std::array<auint, 20> &block, asizei first, asizei count) const {
+        std::vector<auint> tails(count * 4);
+        for(asizei i = 0; i < count; i++) {
+            for(asizei cp = 0; cp < 3; cp++) tails[i * 4 + cp] = block[16 + cp];
+            tails[i * 4 + 3] = auint(first + i);
         }
+        sph_luffa512_batch(block.data(), sizeof(auint) * 16, tails.data(), sizeof(auint) * 4, count, hashes);
+        for(asizei i = 0; i < count * 16; i++) hashes[i] = SWAP_BYTES(hashes[i]);
+        for(asizei i = 0; i < count * 16; i += 2) std::swap(hashes[i], hashes[i + 1]);
+    }
 
-        for(asizei i = 0; i < reference.size(); i++) reference[i] = SWAP_BYTES(reference[i]);
-        for(asizei i = 0; i < reference.size(); i += 2) std::swap(reference[i], reference[i + 1]);
-
-        if(memcmp(blob + nonce * 16, reference.data(), sizeof(reference))) {
-            std::array<cl_uint, 16> computed;
-            for(asizei cp = 0; cp < 16; cp++) computed[cp] = blob[nonce * 16 + cp];
-            bad = ValidationMismatch(computed, reference, nonce);
-            return true;
-        }
-        return false;
+    bool Mismatch(ValidationMismatch &bad, auint nonce, const auint *reference) const {
+        return Hash512Mismatches(bad, blob, nonce, reference);
     }
 
     void MapResults(cl_command_queue cq) {
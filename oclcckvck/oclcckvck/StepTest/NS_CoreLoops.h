@@ -8,6 +8,8 @@
 #include <CL/cl.h>
 #include "../AbstractAlgorithm.h"
 #include "../StopWaitDispatcher.h"
+#include "../AlgoImplementations/NeoscryptPadLayout.h"
+#include "../TestData/NeoscryptCoreLoops.h"
 #include <random>
 #include "../misc.h"
 #include "misc.h"
@@ -18,97 +20,28 @@ namespace stepTest {
 
 
 namespace nsHelp {
-    static const auint MIX_ROUNDS = 10;
-
-	// The usage of salsa or chacha also mandates use of a different shader compile define so and algorithm names so this has to be slightly more modular
-    // It is made quite more complicated by the fact AbstractAlgorithm identifier must be currently constructed by const char* and it's const.
-    enum class Pass {
-        sequentialWrite,
-        indirectedRead
-    };
-
-    struct Salsa {
-        static const char* GetDefineName() { return "SALSA"; }
-        static const char* GetAlgoName(Pass p) { return p == Pass::sequentialWrite? "SequentialWrite_salsa" : "IndirectedRead_salsa"; }
-        void operator()(auint state[16]);
-    };
-    struct Chacha {
-        static const char* GetDefineName() { return "CHACHA"; }
-        static const char* GetAlgoName(Pass p) { return p == Pass::sequentialWrite? "SequentialWrite_chacha" : "IndirectedRead_chacha"; }
-        void operator()(auint state[16]);
-    };
-
-	// As checking isn't considered a performance path I could avoid using a template here: they are still a bit ugly to debuggers and messages.
-	template<typename MixFunc>
-	static void SequentialWrite(auint iterations, auint *pad, auint *state, MixFunc &&mix) {
-		static const auint perm[2][4] = {
-			{0, 1, 2, 3},
-			{0, 2, 1, 3}
-		};
-		for(auint loop = 0; loop < iterations; loop++) {
-			for(auint slice = 0; slice < 4; slice++) {
-				auint *one = state + perm[loop % 2][slice] * 16;
-				auint *two = state + perm[loop % 2][(slice + 3) % 4] * 16;
-				auint prev[16];
-				for(auint el = 0; el < 16; el++) {
-					pad[el] = one[el];
-					one[el] ^= two[el];
-					prev[el] = one[el];
-				}
-				pad += 16;
-				mix(one);
-				for(auint el = 0; el < 16; el++) one[el] += prev[el];
-			}
-		}
-	}
-	template<typename MixFunc>
-	static void IndirectedRead(auint iterations, auint *state, auint *pad, MixFunc &&mix) {
-		static const auint perm[2][4] = {
-			{0, 1, 2, 3},
-			{0, 2, 1, 3}
-		};
-		for(auint loop = 0; loop < iterations; loop++) {
-			const auint indirected = state[48] % 128;
-			for(auint slice = 0; slice < 4; slice++) {
-				auint *one = state + perm[loop % 2][slice] * 16;
-				for(auint el = 0; el < 16; el++) one[el] ^= pad[indirected * 64 + slice * 16 + el];
-			}
-			for(auint slice = 0; slice < 4; slice++) {
-				auint *one = state + perm[loop % 2][slice] * 16;
-				auint *two = state + perm[loop % 2][(slice + 3) % 4] * 16;
-				auint prev[16];
-				for(auint el = 0; el < 16; el++) {
-					one[el] ^= two[el];
-					prev[el] = one[el];
-				}
-				mix(one);
-				for(auint el = 0; el < 16; el++) one[el] += prev[el];
-			}
-		}
-	}
-    
-
     struct NSCoreMismatch {
         auint nonce;
         std::array<auint, 64> stateGPU, stateHost;
-        asizei padDifference; //!< index of first uint in pad buffer being different, if >= 128*64 pad is the same
+        asizei padDifference; //!< index of first uint in pad buffer being different, if >= padUints pad is the same
+        asizei padUints; //!< size of the pad for a single hash, it is less than 128*64 when a lookup gap is used
 
         void Describe(std::stringstream &conc) const {
             conc<<'['<<nonce<<"] is "<<Hex(reinterpret_cast<const aubyte*>(stateGPU.data()), sizeof(stateGPU));
             conc<<", should be "<<Hex(reinterpret_cast<const aubyte*>(stateHost.data()), sizeof(stateHost));
-            if(padDifference < 64 * 128) conc<<", first pad difference uint index="<<padDifference;
+            if(padDifference < padUints) conc<<", first pad difference uint index="<<padDifference;
         }
     };
 }
 
 
-template<typename MixFunc>
-class NS_SW : public AbstractAlgorithm {
+/*! LOOKUP_GAP is the amount of iterations for each pad entry being stored. Missing entries are recomputed by indirectedRead_1way.
+Default value of 1 means all the states are stored (and the kernels are built as they always have been).
+PAD_LAYOUT selects the kernel pad layout, host reorders the pad to its own layout using algoImplementations::PadIndex. */
+template<typename MixFunc, auint LOOKUP_GAP = 1, algoImplementations::NeoscryptPadLayout PAD_LAYOUT = algoImplementations::NeoscryptPadLayout::sliceInterleaved>
+class NS_SW : public AbstractAlgorithm, public BatchedReferences {
+    static const auint padEntries = (128 + LOOKUP_GAP - 1) / LOOKUP_GAP;
     std::vector<auint> dummyPrevious;
-    mutable std::array<auint, 64> hostState; //!< slice of dummyPrevious used as helper to input hash to CPU validation, updated verification
-    mutable std::array<auint, 128 * 64> hostPad;
-    mutable std::array<auint, 64> gpuStateOut; //!< helper buffer taken from GPU buffer with same layout as CPU output
-    mutable std::array<auint, 128 * 64> gpuPad; //!< pad buffer values, but with same layout as CPU, for a single hash
     cl_uint *padMap = nullptr, *xoMap = nullptr;
 
 public:
@@ -121,7 +54,7 @@ public:
     std::vector<std::string> Init(ConfigDesc *desc, AbstractSpecialValuesProvider &specials, const std::string &loadPathPrefix) {
         ResourceRequest resources[] = {
             ResourceRequest("kdfResult", CL_MEM_HOST_NO_ACCESS, 256 * hashCount, dummyPrevious.data()),
-            ResourceRequest("pad", CL_MEM_HOST_READ_ONLY | CL_MEM_WRITE_ONLY, 32 * 1024 * hashCount),
+            ResourceRequest("pad", CL_MEM_HOST_READ_ONLY | CL_MEM_WRITE_ONLY, padEntries * 256 * hashCount),
             ResourceRequest("xo", CL_MEM_HOST_READ_ONLY | CL_MEM_WRITE_ONLY, 256 * hashCount),
             Immediate<cl_uint>("LOOP_ITERATIONS", 128),
             Immediate<cl_uint>("STATE_SLICES", 4),
@@ -131,7 +64,9 @@ public:
         if(errors.size()) return errors;
 
         typedef WorkGroupDimensionality WGD;
-        const std::string blockMix("-D BLOCKMIX_" + std::string(MixFunc::GetDefineName()));
+        std::string blockMix("-D BLOCKMIX_" + std::string(MixFunc::GetDefineName()));
+        if(LOOKUP_GAP > 1) blockMix += " -D LOOKUP_GAP=" + std::to_string(LOOKUP_GAP);
+        blockMix += algoImplementations::GetCompileFlags(PAD_LAYOUT);
         KernelRequest kernels[] = {
             {
                 "ns_coreLoop_1W.cl", "sequentialWrite_1way", blockMix.c_str(),
@@ -146,53 +81,52 @@ public:
     typedef nsHelp::NSCoreMismatch ValidationMismatch;
     typedef BadResultsList<nsHelp::NSCoreMismatch> BadResults;
 
-    bool Mismatch(ValidationMismatch &bad, auint nonce) const {
+    //! Each reference is the final state followed by the pad as produced by SequentialWrite.
+    static const asizei referenceUints = 64 + padEntries * 64;
+    static const asizei referenceBatch = 32;
+    void References(auint *hashes, asizei first, asizei count) const {
         const auint iterations = 128;
-        const asizei get_local_size = 64; // number of hashes per work group
-        const asizei get_group_id = nonce / get_local_size;
-        const asizei get_local_id = nonce % get_local_size;
-        const asizei get_global_size = hashCount;
-        {
-            const auint *xin = dummyPrevious.data() + get_group_id * get_local_size * 64;
-            xin += get_local_id;
-            for(asizei slice = 0; slice < 4; slice++) {
-                const auint *currSlice = xin + slice * 16 * get_local_size;
-                for(asizei el = 0; el < 16; el++) hostState[slice * 16 + el] = currSlice[el * get_local_size];
+        for(asizei base = 0; base < count; base += nsHelp::CORE_LANES) {
+            const asizei lanes = count - base < nsHelp::CORE_LANES? count - base : nsHelp::CORE_LANES;
+            auint *state[nsHelp::CORE_LANES], *pad[nsHelp::CORE_LANES];
+            for(asizei lane = 0; lane < lanes; lane++) {
+                state[lane] = hashes + (base + lane) * referenceUints;
+                pad[lane] = state[lane] + 64;
+                nsHelp::LoadState(state[lane], dummyPrevious.data(), first + base + lane);
+            }
+            if(lanes == nsHelp::CORE_LANES) nsHelp::SequentialWriteLanes<nsHelp::CORE_LANES>(iterations, pad, state, MixFunc(), LOOKUP_GAP);
+            else {
+                for(asizei lane = 0; lane < lanes; lane++) nsHelp::SequentialWrite(iterations, pad[lane], state[lane], MixFunc(), LOOKUP_GAP);
             }
-            //SequentialWrite(iterations, hostPad.data(), hostState.data(), std::function<void(auint*)>(SALSA? Salsa : Chacha));
-            nsHelp::SequentialWrite(iterations, hostPad.data(), hostState.data(), MixFunc());
         }
+    }
 
-        // Now take care of the output. 
-        { // the pad buffer comes in sequences of 16 uints, staggered by local id. Slices have same offset as previously
-            const auint *pad = padMap + get_group_id * get_local_size * 16;
-            pad += get_local_id * 16;
+    bool Mismatch(ValidationMismatch &bad, auint nonce, const auint *reference) const {
+        const asizei get_global_size = hashCount;
+        const auint *hostState = reference;
+        const auint *hostPad = reference + 64;
+        std::array<auint, 64> gpuStateOut; // helper buffer taken from GPU buffer with same layout as CPU output
+        std::array<auint, padEntries * 64> gpuPad; // pad buffer values, but with same layout as CPU, for a single hash
+        { // the pad buffer layout depends on PAD_LAYOUT, the default comes in sequences of 16 uints, staggered by local id.
             asizei dsti = 0;
-            for(asizei it = 0; it < iterations; it++) {
+            for(asizei it = 0; it < padEntries; it++) {
                 for(asizei slice = 0; slice < 4; slice++) {
-                    for(asizei el = 0; el < 16; el++) gpuPad[dsti++] = pad[(el + get_local_id) % 16];
-                    pad += 16 * get_global_size;
+                    for(asizei el = 0; el < 16; el++) gpuPad[dsti++] = padMap[algoImplementations::PadIndex(PAD_LAYOUT, get_global_size, padEntries, nonce, it, slice, el)];
                 }
             }
         }
-        { // the output value is more or less the same as input, just comes from different buffer
-            const auint *xout = xoMap + get_group_id * get_local_size * 64;
-            xout += get_local_id;
-            for(asizei slice = 0; slice < 4; slice++) {
-                const auint *currSlice = xout + slice * 16 * get_local_size;
-                for(asizei el = 0; el < 16; el++) gpuStateOut[slice * 16 + el] = currSlice[el * get_local_size];
-            }
-        }
+        nsHelp::LoadState(gpuStateOut.data(), xoMap, nonce); // the output value is more or less the same as input, just comes from different buffer
 
-        const bool goodState = memcmp(gpuStateOut.data(), hostState.data(), sizeof(hostState)) == 0;
-        const bool goodPad = memcmp(gpuPad.data(), hostPad.data(), sizeof(hostPad)) == 0;
+        const bool goodState = memcmp(gpuStateOut.data(), hostState, sizeof(gpuStateOut)) == 0;
+        const bool goodPad = memcmp(gpuPad.data(), hostPad, sizeof(gpuPad)) == 0;
         if(goodState && goodPad) return false;
         // :(
         bad.nonce = nonce;
         bad.stateGPU = gpuStateOut;
-        bad.stateHost = hostState;
+        std::copy(hostState, hostState + 64, bad.stateHost.begin());
         bad.padDifference = 0;
-        while(bad.padDifference < hostPad.size()) {
+        bad.padUints = gpuPad.size();
+        while(bad.padDifference < gpuPad.size()) {
             if(hostPad[bad.padDifference] != gpuPad[bad.padDifference]) break;
             bad.padDifference++;
         }
@@ -202,7 +136,7 @@ public:
         cl_mem padBuff = resHandles.find("pad")->second;
         cl_mem xoBuff = resHandles.find("xo")->second;
         cl_int err = 0;
-        padMap = reinterpret_cast<cl_uint*>(clEnqueueMapBuffer(cq, padBuff, CL_TRUE, CL_MAP_READ, 0, 32 * 1024 * hashCount, 0, NULL, NULL, &err));
+        padMap = reinterpret_cast<cl_uint*>(clEnqueueMapBuffer(cq, padBuff, CL_TRUE, CL_MAP_READ, 0, padEntries * 256 * hashCount, 0, NULL, NULL, &err));
         if(err != CL_SUCCESS) throw std::string("Failed mapping pad buffer results with error ") + std::to_string(err);
 
         xoMap = reinterpret_cast<cl_uint*>(clEnqueueMapBuffer(cq, xoBuff, CL_TRUE, CL_MAP_READ, 0, 256 * hashCount, 0, NULL, NULL, &err));
@@ -220,14 +154,13 @@ public:
 };
 
 
-template<typename MixFunc>
-class NS_IR : public AbstractAlgorithm {
+//! \sa NS_SW for LOOKUP_GAP and PAD_LAYOUT. The random pad is considered to hold only the stored entries.
+template<typename MixFunc, auint LOOKUP_GAP = 1, algoImplementations::NeoscryptPadLayout PAD_LAYOUT = algoImplementations::NeoscryptPadLayout::sliceInterleaved>
+class NS_IR : public AbstractAlgorithm, public BatchedReferences {
+    static const auint padEntries = (128 + LOOKUP_GAP - 1) / LOOKUP_GAP;
     std::vector<auint> bigState;
     std::vector<auint> bigPad;
 
-    mutable std::array<auint, 64> hostState; //!< slice of dummyPrevious used as helper to input hash to CPU validation, updated verification
-    mutable std::array<auint, 64> gpuStateOut; //!< helper buffer taken from GPU buffer with same layout as CPU output
-    mutable std::array<auint, 128 * 64> hostPad;
 
     cl_uint *xoMap = nullptr;
 
@@ -235,14 +168,14 @@ public:
     NS_IR(std::mt19937 &random, cl_context ctx, cl_device_id dev, asizei concurrency)
         : AbstractAlgorithm(concurrency, ctx, dev, "Neoscrypt", MixFunc::GetAlgoName(nsHelp::Pass::indirectedRead), "v1", 0) {
         bigState.resize(hashCount * 64);
-        bigPad.resize(hashCount * 128 * 64);
+        bigPad.resize(hashCount * padEntries * 64);
         for(auto &i : bigState) i = random();
         for(auto &i : bigPad) i = random();
     }
 
     std::vector<std::string> Init(ConfigDesc *desc, AbstractSpecialValuesProvider &specials, const std::string &loadPathPrefix) {
         ResourceRequest resources[] = {
-            ResourceRequest("pad", CL_MEM_HOST_NO_ACCESS, 32 * 1024 * hashCount, bigPad.data()),
+            ResourceRequest("pad", CL_MEM_HOST_NO_ACCESS, padEntries * 256 * hashCount, bigPad.data()),
             ResourceRequest("xo", CL_MEM_HOST_READ_ONLY, 256 * hashCount, bigState.data()),
             Immediate<cl_uint>("LOOP_ITERATIONS", 128),
             Immediate<cl_uint>("STATE_SLICES", 4),
@@ -252,7 +185,9 @@ public:
         if(errors.size()) return errors;
 
         typedef WorkGroupDimensionality WGD;
-        const std::string blockMix("-D BLOCKMIX_" + std::string(MixFunc::GetDefineName()));
+        std::string blockMix("-D BLOCKMIX_" + std::string(MixFunc::GetDefineName()));
+        if(LOOKUP_GAP > 1) blockMix += " -D LOOKUP_GAP=" + std::to_string(LOOKUP_GAP);
+        blockMix += algoImplementations::GetCompileFlags(PAD_LAYOUT);
         KernelRequest kernels[] = {
             {
                 "ns_coreLoop_1W.cl", "indirectedRead_1way", blockMix.c_str(),
@@ -267,48 +202,46 @@ public:
     typedef nsHelp::NSCoreMismatch ValidationMismatch;
     typedef BadResultsList<nsHelp::NSCoreMismatch> BadResults;
 
-    bool Mismatch(ValidationMismatch &bad, auint nonce) const {
+    //! Each reference is the final state.
+    static const asizei referenceUints = 64;
+    static const asizei referenceBatch = 64;
+    void References(auint *hashes, asizei first, asizei count) const {
         const auint iterations = 128;
-        const asizei get_local_size = 64; // number of hashes per work group
-        const asizei get_group_id = nonce / get_local_size;
-        const asizei get_local_id = nonce % get_local_size;
         const asizei get_global_size = hashCount;
-        {
-            const auint *xio = bigState.data() + get_group_id * get_local_size * 64;
-            xio += get_local_id;
-            for(asizei slice = 0; slice < 4; slice++) {
-                const auint *currSlice = xio + slice * 16 * get_local_size;
-                for(asizei el = 0; el < 16; el++) hostState[slice * 16 + el] = currSlice[el * get_local_size];
-            }
-
-            const auint *pad = bigPad.data() + nonce * 16;
-            asizei dsti = 0;
-            for(asizei it = 0; it < iterations; it++) {
-                for(asizei slice = 0; slice < 4; slice++) {
-                    for(asizei el = 0; el < 16; el++) hostPad[dsti++] = pad[(el + get_local_id) % 16];
-                    pad += 16 * get_global_size;
+        std::vector<auint> hostPad(nsHelp::CORE_LANES * padEntries * 64);
+        for(asizei base = 0; base < count; base += nsHelp::CORE_LANES) {
+            const asizei lanes = count - base < nsHelp::CORE_LANES? count - base : nsHelp::CORE_LANES;
+            auint *state[nsHelp::CORE_LANES];
+            const auint *pad[nsHelp::CORE_LANES];
+            for(asizei lane = 0; lane < lanes; lane++) {
+                const asizei nonce = first + base + lane;
+                state[lane] = hashes + (base + lane) * referenceUints;
+                nsHelp::LoadState(state[lane], bigState.data(), nonce);
+                auint *dst = hostPad.data() + lane * padEntries * 64;
+                for(asizei it = 0; it < padEntries; it++) {
+                    for(asizei slice = 0; slice < 4; slice++) {
+                        for(asizei el = 0; el < 16; el++) *dst++ = bigPad[algoImplementations::PadIndex(PAD_LAYOUT, get_global_size, padEntries, nonce, it, slice, el)];
+                    }
                 }
+                pad[lane] = hostPad.data() + lane * padEntries * 64;
             }
-            nsHelp::IndirectedRead(iterations, hostState.data(), hostPad.data(), MixFunc());
-        }
-
-        // Now take care of the output. 
-        { // the output value is more or less the same as input, just comes from different buffer
-            const auint *xout = xoMap + get_group_id * get_local_size * 64;
-            xout += get_local_id;
-            for(asizei slice = 0; slice < 4; slice++) {
-                const auint *currSlice = xout + slice * 16 * get_local_size;
-                for(asizei el = 0; el < 16; el++) gpuStateOut[slice * 16 + el] = currSlice[el * get_local_size];
+            if(lanes == nsHelp::CORE_LANES) nsHelp::IndirectedReadLanes<nsHelp::CORE_LANES>(iterations, state, pad, MixFunc(), LOOKUP_GAP);
+            else {
+                for(asizei lane = 0; lane < lanes; lane++) nsHelp::IndirectedRead(iterations, state[lane], pad[lane], MixFunc(), LOOKUP_GAP);
             }
         }
+    }
 
-        const bool goodState = memcmp(gpuStateOut.data(), hostState.data(), sizeof(hostState)) == 0;
-        if(goodState) return false;
+    bool Mismatch(ValidationMismatch &bad, auint nonce, const auint *reference) const {
+        std::array<auint, 64> gpuStateOut; // helper buffer taken from GPU buffer with same layout as CPU output
+        nsHelp::LoadState(gpuStateOut.data(), xoMap, nonce);
+        if(memcmp(gpuStateOut.data(), reference, sizeof(gpuStateOut)) == 0) return false;
         // :(
         bad.nonce = nonce;
         bad.stateGPU = gpuStateOut;
-        bad.stateHost = hostState;
-        bad.padDifference = auint(hostPad.size());
+        std::copy(reference, reference + 64, bad.stateHost.begin());
+        bad.padDifference = padEntries * 64;
+        bad.padUints = padEntries * 64;
         return true;
     }
     void MapResults(cl_command_queue cq){
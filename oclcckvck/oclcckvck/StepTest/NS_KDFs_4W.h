@@ -5,6 +5,7 @@
  */
 #pragma once
 #include "../../Common/AREN/ArenDataTypes.h"
+#include "../TestData/NeoscryptKDF.h"
 #include <CL/cl.h>
 #include "../AbstractAlgorithm.h"
 #include "../StopWaitDispatcher.h"
@@ -15,26 +16,6 @@
 
 namespace stepTest {
 
-//! Stuff mostly copied from M8M BlockVerifier for Neoscrypt
-struct NS_KDFHelper {
-    static const auint KDF_CONST_N;
-    static const auint KDF_SIZE;
-	static const auint MIX_ROUNDS;
-	static const auint blake2S_IV[8];
-	static const aubyte blake2S_sigma[10][16];
-    
-
-    std::array<auint, 64> FirstKDF(const aubyte *block, aubyte *buff_a, aubyte *buff_b);
-	std::array<aubyte, 32> LastKDF(const std::array<auint, 64> &state, const aubyte *buff_a, aubyte *buff_b);
-
-private:
-    auint FastKDFIteration(auint buffStart, const aubyte *buff_a, aubyte *buff_b);
-    void FillInitialBuffer(aubyte *target, auint extraBytes, const aubyte *pattern, auint blockLen);
-    void Blake2S_64_32(auint *output, auint *input, auint *key, const auint numRounds);
-    std::array<auint, 8> Blake2SBlockXForm(const std::array<auint, 8> hash, const std::array<auint, 4> &counter, const auint numRounds, const std::array<auint, 16> &msg);
-};
-
-
 struct NS_FirstKDF_4W : public AbstractAlgorithm {
     struct FKDFMismatch {
         struct {
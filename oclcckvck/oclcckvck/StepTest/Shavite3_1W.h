@@ -12,13 +12,14 @@
 
 extern "C" {
 #include "../../SPH/sph_shavite.h"
+#include "../../SPH/sph_batch.h"
 }
 
 
 namespace stepTest {
 
 
-struct ShaVite3_1W : public AbstractAlgorithm {
+struct ShaVite3_1W : public AbstractAlgorithm, BatchedReferences {
     typedef Hash512Mismatch ValidationMismatch;
     typedef BadResultsList<Hash512Mismatch> BadResults;
 
@@ -56,21 +57,12 @@ struct ShaVite3_1W : public AbstractAlgorithm {
     }
     bool BigEndian() const { return true; }
 
-    bool Mismatch(ValidationMismatch &bad, auint nonce) const {
-        std::array<auint, 16> reference;
-        {
-            sph_shavite512_context head;
-            sph_shavite512_init(&head);
-            sph_shavite512(&head, dummyPrevious.data() + nonce * 16, sizeof(auint) * 16);
-            sph_shavite512_close(&head, reference.data());
-        }
-        if(memcmp(blob + nonce * 16, reference.data(), sizeof(reference))) {
-            std::array<cl_uint, 16> computed;
-            for(asizei cp = 0; cp < 16; cp++) computed[cp] = blob[nonce * 16 + cp];
-            bad = ValidationMismatch(computed, reference, nonce);
-            return true;
-        }
-        return false;
+    void References(auint *hashes, asizei first, asizei count) const {
+        sph_shavite512_batch(nullptr, 0, dummyPrevious.data() + first * 16, sizeof(auint) * 16, count, hashes);
+    }
+
+    bool Mismatch(ValidationMismatch &bad, auint nonce, const auint *reference) const {
+        return Hash512Mismatches(bad, blob, nonce, reference);
     }
 
     void MapResults(cl_command_queue cq) {
@@ -12,6 +12,18 @@
 #include "../misc.h"
 #include <string>
 #include <sstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <type_traits>
+#include <map>
+#include <fstream>
+#include <cmath>
+#include <set>
+#include <memory>
+#include <algorithm>
 
 
 namespace stepTest {
@@ -24,6 +36,31 @@ struct BadResultsList {
     asizei count; //!< might be > mismatch.size() + more.size as not everything is collected even though everything is counted
     explicit BadResultsList() : count(0) { }
     bool Failed() { return count != 0; }
+    asizei Count() const { return count; }
+
+    /*! Records a mismatch, the first maxBadStuff in detail, then only nonces up to maxBadStuff * 4, then just counted.
+    Mismatches must come in nonce order. */
+    void Add(const DetailedMismatch &bad, auint nonce, asizei maxBadStuff) {
+        if(count < maxBadStuff) mismatch.push_back(bad);
+        else if(count < maxBadStuff * 4) more.push_back(nonce);
+        count++;
+    }
+
+    /*! Appends a list built with the same maxBadStuff for the nonces following the ones already there, so the result is the same
+    as calling Add for each mismatch. A partial list has the details of its first maxBadStuff mismatches, so it always has them when needed. */
+    void Merge(const BadResultsList &other, asizei maxBadStuff) {
+        asizei index = count;
+        for(const auto &bad : other.mismatch) {
+            if(index < maxBadStuff) mismatch.push_back(bad);
+            else if(index < maxBadStuff * 4) more.push_back(auint(bad.nonce));
+            index++;
+        }
+        for(auto nonce : other.more) {
+            if(index++ < maxBadStuff * 4) more.push_back(nonce);
+        }
+        count += other.count;
+    }
+
     std::string Describe(asizei totalTests) {
         std::stringstream conc;
         conc<<"Results differ\n";
@@ -56,6 +93,7 @@ struct BadNonces {
     std::vector<auint> badMissing; //!< those are supposed to be found but they are not.
     explicit BadNonces() { }
     bool Failed() { return badFound.size() + badMissing.size() != 0; }
+    asizei Count() const { return badFound.size() + badMissing.size(); }
     std::string Describe(asizei totalTests) {
         std::stringstream conc;
         conc << "Results differ";
@@ -82,6 +120,337 @@ struct BadNonces {
 };
 
 
+/*! Host threads CheckRanges runs its ranges on, one for each hardware thread. Check runs once per dispatch so the threads are created
+on first use and kept until the process exits instead of being created for each call. Runs are serialized, a caller waits for
+the previous one to complete. Jobs must not run CheckRanges themselves, nor throw. */
+class HostPool {
+public:
+    static HostPool& Shared() {
+        static HostPool pool(std::thread::hardware_concurrency()? std::thread::hardware_concurrency() : 1);
+        return pool;
+    }
+
+    asizei Threads() const { return workers.size(); }
+
+    //! Calls job(index) for each index in [0, count) and returns when all calls returned. Calls might share a thread.
+    void Run(asizei count, const std::function<void(asizei index)> &job) {
+        std::unique_lock<std::mutex> serial(running);
+        std::unique_lock<std::mutex> lock(guard);
+        current = &job;
+        next = 0;
+        jobs = pending = count;
+        wake.notify_all();
+        done.wait(lock, [this]() { return pending == 0; });
+        current = nullptr;
+    }
+
+    ~HostPool() {
+        {
+            std::unique_lock<std::mutex> lock(guard);
+            quit = true;
+        }
+        wake.notify_all();
+        for(auto &w : workers) w.join();
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::mutex running; //!< held for a whole Run
+    std::mutex guard; //!< everything below
+    std::condition_variable wake, done;
+    const std::function<void(asizei)> *current = nullptr;
+    asizei next = 0, jobs = 0, pending = 0;
+    bool quit = false;
+
+    explicit HostPool(asizei threads) {
+        for(asizei t = 0; t < threads; t++) workers.push_back(std::thread([this]() { Work(); }));
+    }
+
+    void Work() {
+        hashing::ScratchArena::ThreadScope arena;
+        std::unique_lock<std::mutex> lock(guard);
+        while(true) {
+            wake.wait(lock, [this]() { return quit || next < jobs; });
+            if(quit) break;
+            const asizei index = next++;
+            const auto &job(*current);
+            lock.unlock();
+            job(index);
+            lock.lock();
+            if(--pending == 0) done.notify_all();
+        }
+        lock.unlock();
+        trace::ReleaseThisThread();
+    }
+
+    HostPool(const HostPool&) = delete;
+    HostPool& operator=(const HostPool&) = delete;
+};
+
+
+/*! CPU validation takes way longer than the GPU step so hashes [0..count) are split in contiguous ranges, one for each HostPool thread.
+Each range produces its own Partial by calling func(partial, first, last), results are returned in range order so callers can merge them
+deterministically. First exception thrown by a range is rethrown after all threads completed. */
+template<typename Partial, typename RangeFunc>
+std::vector<Partial> CheckRanges(asizei count, RangeFunc &&func) {
+    HostPool &pool(HostPool::Shared());
+    asizei threads = pool.Threads();
+    if(threads > count) threads = count? count : 1;
+    const asizei chunk = (count + threads - 1) / threads;
+    std::vector<Partial> partial(threads);
+    std::vector<std::exception_ptr> failure(threads);
+    pool.Run(threads, [&func, &partial, &failure, chunk, count](asizei t) {
+        const asizei first = t * chunk;
+        const asizei last = first + chunk < count? first + chunk : count;
+        try {
+            trace::Span span("CheckRanges");
+            func(partial[t], first, last);
+        } catch(...) {
+            failure[t] = std::current_exception();
+        }
+    });
+    for(auto &f : failure) {
+        if(f) std::rethrow_exception(f);
+    }
+    return partial;
+}
+
+
+/*! SHA-256 of each buffer the host reads back from algo (see AbstractAlgorithm::HostReadableBuffers), then SHA-256 of those digests.
+Buffers are mapped one at a time, before the test maps them for checking. Returns false if there are no such buffers: tails only produce nonces. */
+inline bool ResultsDigest(hashing::SHA256::Digest &digest, const AbstractAlgorithm &algo, cl_command_queue cq) {
+    const auto buffers(algo.HostReadableBuffers());
+    if(buffers.empty()) return false;
+    std::vector<aubyte> all;
+    for(const auto &buff : buffers) {
+        cl_int err = 0;
+        void *map = clEnqueueMapBuffer(cq, buff.first, CL_TRUE, CL_MAP_READ, 0, buff.second, 0, NULL, NULL, &err);
+        if(err != CL_SUCCESS) throw std::string("Failed mapping results for digest with error ") + std::to_string(err);
+        ScopedFuncCall unmap([cq, &buff, map]() { clEnqueueUnmapMemObject(cq, buff.first, map, 0, NULL, NULL); });
+        hashing::SHA256::Digest one;
+        hashing::SHA256(reinterpret_cast<const aubyte*>(map), buff.second).GetHash(one);
+        all.insert(all.end(), one.cbegin(), one.cend());
+    }
+    hashing::SHA256(all.data(), all.size()).GetHash(digest);
+    return true;
+}
+
+
+/*! Digests of results which have already been validated hash by hash. When a later run of the same kernels (versioning hash) with the same
+input data (seed) and hashCount produces the same digest, there's no need to compute the CPU references again.
+Kept in a text file, one digest for each line:
+    versioningHash seed hashCount digest
+hashCount is decimal, everything else hex. Lines not making sense are ignored. */
+class GoldenDigests {
+public:
+    explicit GoldenDigests(const char *fileName) : file(fileName) {
+        std::ifstream disk(file);
+        std::string line;
+        while(std::getline(disk, line)) {
+            std::stringstream parse(line);
+            Key key;
+            std::string hex;
+            parse>>std::hex>>key.versioning>>key.seed>>std::dec>>key.hashCount>>hex;
+            hashing::SHA256::Digest digest;
+            if(parse.fail() || hex.length() != digest.size() * 2) continue;
+            for(asizei i = 0; i < digest.size(); i++) digest[i] = aubyte(std::stoul(hex.substr(i * 2, 2), nullptr, 16));
+            known[key] = digest;
+        }
+    }
+
+    bool Matches(aulong versioning, auint seed, asizei hashCount, const hashing::SHA256::Digest &digest) const {
+        auto match = known.find(Key(versioning, seed, hashCount));
+        return match != known.cend() && match->second == digest;
+    }
+
+    //! Call this after validating the results hash by hash. Rewrites the whole file so a changed digest replaces the old one.
+    void Store(aulong versioning, auint seed, asizei hashCount, const hashing::SHA256::Digest &digest) {
+        known[Key(versioning, seed, hashCount)] = digest;
+        std::ofstream disk(file, std::ios::trunc);
+        for(const auto &el : known) {
+            disk<<std::hex<<el.first.versioning<<' '<<el.first.seed<<' '<<std::dec<<el.first.hashCount<<' ';
+            disk<<Hex(el.second.data(), el.second.size())<<std::endl;
+        }
+    }
+
+private:
+    struct Key {
+        aulong versioning;
+        auint seed;
+        asizei hashCount;
+        explicit Key() : versioning(0), seed(0), hashCount(0) { }
+        Key(aulong v, auint s, asizei c) : versioning(v), seed(s), hashCount(c) { }
+        bool operator<(const Key &other) const {
+            if(versioning != other.versioning) return versioning < other.versioning;
+            if(seed != other.seed) return seed < other.seed;
+            return hashCount < other.hashCount;
+        }
+    };
+    const std::string file;
+    std::map<Key, hashing::SHA256::Digest> known;
+};
+
+
+/*! How many hashes the tests check. By default all of them. Otherwise some hashes are always checked, the boundaries: first and last hash
+of each work group of each kernel and the hashes where the nonce wraps around 2^32. Other hashes are picked at random, either a fraction
+of them (rate) or as many as needed to notice at least an error with the given confidence if the error rate is maxErrorRate or more. */
+struct Sampling {
+    adouble rate;
+    adouble maxErrorRate;
+    adouble confidence;
+    explicit Sampling() : rate(1.0), maxErrorRate(0), confidence(0) { }
+    static Sampling Rate(adouble fraction) {
+        Sampling ret;
+        ret.rate = fraction;
+        return ret;
+    }
+    static Sampling Confidence(adouble errorRate, adouble probability) {
+        Sampling ret;
+        ret.maxErrorRate = errorRate;
+        ret.confidence = probability;
+        return ret;
+    }
+    bool Full() const { return maxErrorRate <= 0 && rate >= 1.0; }
+
+    //! Random hashes to check out of candidates. With no errors found in n hashes, the error rate is below p with confidence 1-(1-p)^n.
+    asizei RandomSamples(asizei candidates) const {
+        adouble want = rate * candidates;
+        if(maxErrorRate > 0) want = std::ceil(std::log(1.0 - confidence) / std::log(1.0 - maxErrorRate));
+        return want >= candidates? candidates : asizei(want);
+    }
+};
+
+
+/*! What has been checked by the last Check call of a test and what it says about the hashes which have not. The estimate only
+considers the random hashes: boundaries are more likely to be wrong than others. */
+struct SampleReport {
+    asizei hashCount, boundary, random, randomBad;
+    explicit SampleReport(asizei hashes = 0) : hashCount(hashes), boundary(0), random(hashes), randomBad(0) { }
+    asizei Checked() const { return boundary + random; }
+    bool Full() const { return Checked() == hashCount; }
+
+    //! Wilson score interval at 95% for the fraction of wrong hashes.
+    std::pair<adouble, adouble> ErrorRateBounds() const {
+        if(random == 0) return std::make_pair(0.0, 1.0);
+        const adouble z = 1.96, n = adouble(random), p = randomBad / n;
+        const adouble div = 1 + z * z / n;
+        const adouble center = (p + z * z / (2 * n)) / div;
+        const adouble spread = z * std::sqrt(p * (1 - p) / n + z * z / (4 * n * n)) / div;
+        return std::make_pair(center - spread < 0? 0.0 : center - spread, center + spread > 1? 1.0 : center + spread);
+    }
+
+    std::string Describe() const {
+        std::stringstream conc;
+        const auto bounds(ErrorRateBounds());
+        conc<<"checked "<<Checked()<<" of "<<hashCount<<" ("<<boundary<<" boundary, "<<random<<" random, "<<randomBad<<" of them wrong), ";
+        conc<<"error rate in [" << bounds.first * 100<<"%, "<<bounds.second * 100<<"%] at 95% confidence";
+        return conc.str();
+    }
+};
+
+
+/*! The hashes to check for a given Sampling, as sorted ranges so batched references are still computed in batches.
+Each range is either boundary or random hashes. firstNonce is the nonce of hash 0, steps always start from 0. */
+struct SamplePlan {
+    struct Run {
+        asizei first, last;
+        bool boundary;
+    };
+    std::vector<Run> runs;
+    std::vector<bool> checked, boundary; //!< by hash index
+    SampleReport report;
+
+    SamplePlan(const Sampling &sampling, asizei hashCount, const std::vector<asizei> &hashesPerGroup, aulong firstNonce, auint seed)
+        : checked(hashCount, false), boundary(hashCount, false), report(hashCount) {
+        if(hashCount == 0) return;
+        auto mark = [this](asizei hash) {
+            if(boundary[hash]) return;
+            boundary[hash] = checked[hash] = true;
+            report.boundary++;
+        };
+        for(auto group : hashesPerGroup) {
+            if(group == 0) continue;
+            for(asizei first = 0; first < hashCount; first += group) {
+                mark(first);
+                mark(first + group - 1 < hashCount? first + group - 1 : hashCount - 1);
+            }
+        }
+        const aulong wrap = (1ull << 32) - (firstNonce & 0xFFFFFFFFull); // index of the first hash with nonce 0 after wrapping
+        if(wrap < hashCount) {
+            mark(asizei(wrap - 1));
+            mark(asizei(wrap));
+        }
+        mark(0);
+        mark(hashCount - 1);
+
+        const asizei candidates = hashCount - report.boundary;
+        report.random = sampling.RandomSamples(candidates);
+        if(report.random * 2 >= candidates) { // easier to pick the ones not to check
+            for(asizei hash = 0; hash < hashCount; hash++) checked[hash] = checked[hash] || !boundary[hash];
+            Pick(candidates - report.random, false, seed);
+        }
+        else Pick(report.random, true, seed);
+
+        for(asizei hash = 0; hash < hashCount; hash++) {
+            if(!checked[hash]) continue;
+            if(runs.size() && runs.back().last == hash && runs.back().boundary == boundary[hash]) runs.back().last++;
+            else {
+                Run add = { hash, hash + 1, boundary[hash] };
+                runs.push_back(add);
+            }
+        }
+    }
+
+private:
+    //! Set checked to value for count random non-boundary hashes which have not that value yet.
+    void Pick(asizei count, bool value, auint seed) {
+        std::mt19937 random(seed);
+        std::uniform_int_distribution<asizei> hash(0, checked.size() - 1);
+        while(count) {
+            const asizei pick = hash(random);
+            if(boundary[pick] || checked[pick] == value) continue;
+            checked[pick] = value;
+            count--;
+        }
+    }
+};
+
+
+/*! Check the hashes in plan in parallel, func(partial, first, last) checks hashes [first, last). Like CheckRanges, partial results are
+returned in hash order so they can be merged. Counts the wrong random hashes in plan.report. */
+template<typename BadResults, typename RangeFunc>
+std::vector<BadResults> CheckSampled(SamplePlan &plan, RangeFunc &&func) {
+    typedef std::pair<BadResults, asizei> Partial;
+    auto partial(CheckRanges<Partial>(plan.runs.size(), [&plan, &func](Partial &bads, asizei first, asizei last) {
+        bads.second = 0;
+        for(asizei loop = first; loop < last; loop++) {
+            const auto &run(plan.runs[loop]);
+            const asizei before = bads.first.count;
+            func(bads.first, run.first, run.last);
+            if(!run.boundary) bads.second += bads.first.count - before;
+        }
+    }));
+    std::vector<BadResults> ret;
+    for(auto &range : partial) {
+        ret.push_back(range.first);
+        plan.report.randomBad += range.second;
+    }
+    return ret;
+}
+
+
+/*! Validators deriving from this compute their CPU references for referenceBatch hashes at once, mostly with the SPH batch API.
+Besides the usual members they provide
+    void References(auint *hashes, asizei first, asizei count) const; // referenceUints for each hash
+    bool Mismatch(ValidationMismatch &bad, auint nonce, const auint *reference) const;
+Head validators get the block header as an additional References parameter, tail validators GetMagic(const auint *reference).
+Validators whose references are not a 512 bit hash redefine referenceUints and possibly referenceBatch to keep the buffer small. */
+struct BatchedReferences {
+    static const asizei referenceBatch = 256;
+    static const asizei referenceUints = 16;
+};
+
+
 /*! An "head test" is meant to test the first step of an algorithm. The head mangles an 80-bytes block to all hashes.
 There can be multiple outputs. */
 template<typename AlgoHeadValidator>
@@ -90,8 +459,11 @@ class HeadTest {
     std::array<aubyte, 80> dummyHeader;
 
 public:
+    static const auint seed = std::mt19937::default_seed; //!< all the input data comes from this
     AlgoHeadValidator algo;
-    HeadTest(cl_context ctx, cl_device_id dev, asizei concurrency) : algo(ctx, dev, concurrency) { }
+    Sampling sampling; //!< set before Check, by default everything is checked
+    SampleReport sampled; //!< what the last Check has checked
+    HeadTest(cl_context ctx, cl_device_id dev, asizei concurrency) : random(seed), algo(ctx, dev, concurrency) { }
     
     //! Fetch the dispatcher with the data it will pass to the algorithm, called once immediately after both
     //! this and the dispatcher has been called.
@@ -115,19 +487,51 @@ public:
         algo.MapResults(cq);
         ScopedFuncCall unmapAlgo([this, cq]() { algo.UnmapResults(cq); });
 
-        std::array<auint, 20> block;
-        memcpy_s(block.data(), sizeof(block), dummyHeader.data(), sizeof(dummyHeader));
+        std::array<auint, 20> header;
+        memcpy_s(header.data(), sizeof(header), dummyHeader.data(), sizeof(dummyHeader));
 
-        for(auint hash = 0; hash < algo.hashCount; hash++) {
-            AlgoHeadValidator::ValidationMismatch bad;
-            if(algo.Mismatch(bad, block, hash)) {
-                if(ret.count < maxBadStuff) ret.mismatch.push_back(bad);
-                else if(ret.count < maxBadStuff * 4) ret.more.push_back(hash);
-                ret.count++;
-            }
+        typedef typename AlgoHeadValidator::BadResults Partial;
+        auto check = [this, &header, maxBadStuff](Partial &bads, asizei first, asizei last) {
+            CheckRange(bads, header, first, last, maxBadStuff, std::is_base_of<BatchedReferences, AlgoHeadValidator>());
+        };
+        std::vector<Partial> partial;
+        if(sampling.Full()) {
+            partial = CheckRanges<Partial>(algo.hashCount, check);
+            sampled = SampleReport(algo.hashCount);
         }
+        else {
+            SamplePlan plan(sampling, algo.hashCount, algo.HashesPerWorkGroup(), 0, seed);
+            partial = CheckSampled<Partial>(plan, check);
+            sampled = plan.report;
+        }
+        for(const auto &range : partial) ret.Merge(range, maxBadStuff);
         return ret;
     }
+
+private:
+    typedef typename AlgoHeadValidator::BadResults BadResults;
+    typedef typename AlgoHeadValidator::ValidationMismatch ValidationMismatch;
+
+    void CheckRange(BadResults &bads, const std::array<auint, 20> &header, asizei first, asizei last, asizei maxBadStuff, std::false_type) const {
+        auto block(header); // Mismatch writes the nonce there
+        for(auint hash = auint(first); hash < last; hash++) {
+            ValidationMismatch bad;
+            if(algo.Mismatch(bad, block, hash)) bads.Add(bad, hash, maxBadStuff);
+        }
+    }
+
+    void CheckRange(BadResults &bads, const std::array<auint, 20> &header, asizei first, asizei last, asizei maxBadStuff, std::true_type) const {
+        std::vector<auint> reference(AlgoHeadValidator::referenceBatch * AlgoHeadValidator::referenceUints);
+        for(asizei base = first; base < last; base += AlgoHeadValidator::referenceBatch) {
+            const asizei count = last - base < AlgoHeadValidator::referenceBatch? last - base : AlgoHeadValidator::referenceBatch;
+            algo.References(reference.data(), header, base, count);
+            for(asizei i = 0; i < count; i++) {
+                ValidationMismatch bad;
+                const auint hash = auint(base + i);
+                if(algo.Mismatch(bad, hash, reference.data() + i * AlgoHeadValidator::referenceUints)) bads.Add(bad, hash, maxBadStuff);
+            }
+        }
+    }
 };
 
 
@@ -137,20 +541,41 @@ class TailTest {
     std::mt19937 random; // this must be built before algo as it's needed to fetch the internal buffers.
 
 public:
+    static const auint seed = std::mt19937::default_seed;
     AlgoTailValidator algo;
-    TailTest(cl_context ctx, cl_device_id dev, asizei concurrency) : algo(random, ctx, dev, concurrency) { }
+    Sampling sampling;
+    SampleReport sampled;
+    TailTest(cl_context ctx, cl_device_id dev, asizei concurrency) : random(seed), algo(random, ctx, dev, concurrency) { }
     void MakeInputData(StopWaitDispatcher &disp) {
         std::array<aubyte, 80> dummyHeader;
         disp.BlockHeader(dummyHeader); // unused for chained steps
         disp.TargetBits(algo.target);
     }
-    BadNonces Check(StopWaitDispatcher &disp, asizei maxBadStuff = 512) const {
+    BadNonces Check(StopWaitDispatcher &disp, asizei maxBadStuff = 512) {
         BadNonces ret;
-        const auto candidates(disp.GetResults());
+        auto candidates(disp.GetResults());
         MinedNonces sph;
-        for(auint hash = 0; hash < algo.hashCount; hash++) {
-            const aulong magic = algo.GetMagic(hash);
-            if(magic <= algo.target) sph.nonces.push_back(HTOBE(hash));
+        auto find = [this](std::vector<auint> &nonces, asizei first, asizei last) {
+            FindRange(nonces, first, last, std::is_base_of<BatchedReferences, AlgoTailValidator>());
+        };
+        std::unique_ptr<SamplePlan> plan;
+        if(sampling.Full()) {
+            auto partial(CheckRanges< std::vector<auint> >(algo.hashCount, find));
+            for(const auto &range : partial) sph.nonces.insert(sph.nonces.end(), range.cbegin(), range.cend());
+            sampled = SampleReport(algo.hashCount);
+        }
+        else { // only the GPU nonces in the sample can be checked
+            plan.reset(new SamplePlan(sampling, algo.hashCount, algo.HashesPerWorkGroup(), 0, seed));
+            auto partial(CheckRanges< std::vector<auint> >(plan->runs.size(), [&plan, &find](std::vector<auint> &nonces, asizei first, asizei last) {
+                for(asizei loop = first; loop < last; loop++) find(nonces, plan->runs[loop].first, plan->runs[loop].last);
+            }));
+            for(const auto &range : partial) sph.nonces.insert(sph.nonces.end(), range.cbegin(), range.cend());
+            const SamplePlan &check(*plan);
+            auto skip = std::remove_if(candidates.nonces.begin(), candidates.nonces.end(), [&check](auint nonce) {
+                const auint hash = HTOBE(nonce);
+                return hash >= check.checked.size() || !check.checked[hash];
+            });
+            candidates.nonces.erase(skip, candidates.nonces.end());
         }
         for(auto gpu : candidates.nonces) {
             if (std::find(sph.nonces.cbegin(), sph.nonces.cend(), gpu) == sph.nonces.cend()) {
@@ -162,8 +587,35 @@ public:
                 ret.badMissing.push_back(sph);
             }
         }
+        if(plan) {
+            std::set<auint> wrong;
+            for(auto nonce : ret.badFound) wrong.insert(HTOBE(nonce));
+            for(auto nonce : ret.badMissing) wrong.insert(HTOBE(nonce));
+            for(auto hash : wrong) plan->report.randomBad += plan->boundary[hash]? 0 : 1;
+            sampled = plan->report;
+        }
         return ret;
     }
+
+private:
+    void FindRange(std::vector<auint> &nonces, asizei first, asizei last, std::false_type) const {
+        for(auint hash = auint(first); hash < last; hash++) {
+            const aulong magic = algo.GetMagic(hash);
+            if(magic <= algo.target) nonces.push_back(HTOBE(hash));
+        }
+    }
+
+    void FindRange(std::vector<auint> &nonces, asizei first, asizei last, std::true_type) const {
+        std::vector<auint> reference(AlgoTailValidator::referenceBatch * AlgoTailValidator::referenceUints);
+        for(asizei base = first; base < last; base += AlgoTailValidator::referenceBatch) {
+            const asizei count = last - base < AlgoTailValidator::referenceBatch? last - base : AlgoTailValidator::referenceBatch;
+            algo.References(reference.data(), base, count);
+            for(asizei i = 0; i < count; i++) {
+                const aulong magic = algo.GetMagic(reference.data() + i * AlgoTailValidator::referenceUints);
+                if(magic <= algo.target) nonces.push_back(HTOBE(auint(base + i)));
+            }
+        }
+    }
 };
 
 
@@ -175,8 +627,11 @@ class StepTest {
     std::mt19937 random; // this must be built before algo as it's needed to fetch the internal buffers.
 
 public:
+    static const auint seed = std::mt19937::default_seed;
     AlgoStepValidator algo;
-    StepTest(cl_context ctx, cl_device_id dev, asizei concurrency) : algo(random, ctx, dev, concurrency) { }
+    Sampling sampling;
+    SampleReport sampled;
+    StepTest(cl_context ctx, cl_device_id dev, asizei concurrency) : random(seed), algo(random, ctx, dev, concurrency) { }
     void MakeInputData(StopWaitDispatcher &disp) {
         std::array<aubyte, 80> dummyHeader;
         disp.BlockHeader(dummyHeader); // unused for chained steps
@@ -187,16 +642,47 @@ public:
         auto cq(disp.GetQueue());
         algo.MapResults(cq);
         ScopedFuncCall unmapAlgo([this, cq]() { algo.UnmapResults(cq); });
-        for(auint hash = 0; hash < algo.hashCount; hash++) {
-            AlgoStepValidator::ValidationMismatch bad;
-            if(algo.Mismatch(bad, hash)) {
-                if(ret.count < maxBadStuff) ret.mismatch.push_back(bad);
-                else if(ret.count < maxBadStuff * 4) ret.more.push_back(hash);
-                ret.count++;
-            }
+        typedef typename AlgoStepValidator::BadResults Partial;
+        auto check = [this, maxBadStuff](Partial &bads, asizei first, asizei last) {
+            CheckRange(bads, first, last, maxBadStuff, std::is_base_of<BatchedReferences, AlgoStepValidator>());
+        };
+        std::vector<Partial> partial;
+        if(sampling.Full()) {
+            partial = CheckRanges<Partial>(algo.hashCount, check);
+            sampled = SampleReport(algo.hashCount);
         }
+        else {
+            SamplePlan plan(sampling, algo.hashCount, algo.HashesPerWorkGroup(), 0, seed);
+            partial = CheckSampled<Partial>(plan, check);
+            sampled = plan.report;
+        }
+        for(const auto &range : partial) ret.Merge(range, maxBadStuff);
         return ret;
     }
+
+private:
+    typedef typename AlgoStepValidator::BadResults BadResults;
+    typedef typename AlgoStepValidator::ValidationMismatch ValidationMismatch;
+
+    void CheckRange(BadResults &bads, asizei first, asizei last, asizei maxBadStuff, std::false_type) const {
+        for(auint hash = auint(first); hash < last; hash++) {
+            ValidationMismatch bad;
+            if(algo.Mismatch(bad, hash)) bads.Add(bad, hash, maxBadStuff);
+        }
+    }
+
+    void CheckRange(BadResults &bads, asizei first, asizei last, asizei maxBadStuff, std::true_type) const {
+        std::vector<auint> reference(AlgoStepValidator::referenceBatch * AlgoStepValidator::referenceUints);
+        for(asizei base = first; base < last; base += AlgoStepValidator::referenceBatch) {
+            const asizei count = last - base < AlgoStepValidator::referenceBatch? last - base : AlgoStepValidator::referenceBatch;
+            algo.References(reference.data(), base, count);
+            for(asizei i = 0; i < count; i++) {
+                ValidationMismatch bad;
+                const auint hash = auint(base + i);
+                if(algo.Mismatch(bad, hash, reference.data() + i * AlgoStepValidator::referenceUints)) bads.Add(bad, hash, maxBadStuff);
+            }
+        }
+    }
 };
 
 
@@ -216,4 +702,17 @@ struct Hash512Mismatch {
     }
 };
 
+
+//! Mismatch for BatchedReferences validators producing a 512 bit hash, 16 uints for each hash in gpu.
+inline bool Hash512Mismatches(Hash512Mismatch &bad, const cl_uint *gpu, auint nonce, const auint *reference) {
+    if(memcmp(gpu + nonce * 16, reference, sizeof(auint) * 16) == 0) return false;
+    std::array<auint, 16> computed, cpu;
+    for(asizei cp = 0; cp < 16; cp++) {
+        computed[cp] = gpu[nonce * 16 + cp];
+        cpu[cp] = reference[cp];
+    }
+    bad = Hash512Mismatch(computed, cpu, nonce);
+    return true;
+}
+
 }
@@ -6,7 +6,10 @@
 #pragma once
 #include "AbstractAlgorithm.h"
 #include "AbstractSpecialValuesProvider.h"
+#include "Trace.h"
+#include "ResultQueue.h"
 #include <set>
+#include <thread>
 
 /*! The stop-n-wait dispatcher takes an algorithm and uses it to drive the GPU 1 unit of work at time.
 It dispatches data and waits for result. It is basically the same thing M8M always did, which is very similar to legacy miners.
@@ -21,7 +24,10 @@ class StopWaitDispatcher : private AbstractSpecialValuesProvider {
 public:
     AbstractAlgorithm &algo;
 
-    StopWaitDispatcher(AbstractAlgorithm &drive) : algo(drive) {
+    /*! When profiling, the queue is created with CL_QUEUE_PROFILING_ENABLE and every command enqueued by Tick is timed,
+    device time being accumulated each time results are pulled out. \sa GetProfile
+    Profiled commands also go to the device track of trace::Session, if tracing. */
+    StopWaitDispatcher(AbstractAlgorithm &drive, bool profileCommands = false) : algo(drive), profiling(profileCommands) {
         PrepareIOBuffers(algo.context, algo.hashCount);
 
         // Bind value names...
@@ -35,11 +41,13 @@ public:
         specials.push_back(NamedValue("$candidates", early));
 
         cl_int err = 0;
-        queue = clCreateCommandQueue(algo.context, algo.device, 0, &err);
+        queue = clCreateCommandQueue(algo.context, algo.device, profiling? CL_QUEUE_PROFILING_ENABLE : 0, &err);
         if(!queue || err != CL_SUCCESS) throw "Could not create command queue for device!";
+        if(profiling) CalibrateClock();
     }
     ~StopWaitDispatcher() {
         if(mapping) clReleaseEvent(mapping);
+        for(auto &cmd : inFlight) clReleaseEvent(cmd.second);
         if(nonces) clEnqueueUnmapMemObject(queue, candidates, nonces, 0, NULL, NULL);
         if(queue) clReleaseCommandQueue(queue);
     }
@@ -60,8 +68,12 @@ public:
         }
         if(algo.Overflowing()) return AlgoEvent::exhausted; // nothing to do
 
+        trace::Span span("Tick");
         cl_int err = 0;
-        err = clEnqueueWriteBuffer(queue, wuData, CL_TRUE, 0, sizeof(blockHeader), blockHeader.data(), 0, NULL, NULL);
+        {
+            trace::Span write("write $wuData");
+            err = clEnqueueWriteBuffer(queue, wuData, CL_TRUE, 0, sizeof(blockHeader), blockHeader.data(), 0, NULL, Profile("write $wuData"));
+        }
         if(err != CL_SUCCESS) throw std::string("CL error ") + std::to_string(err) + " while attempting to update $wuData";
 
         cl_uint buffer[5]; // taken as is from M8M FillDispatchData... how ugly!
@@ -70,14 +82,34 @@ public:
         buffer[2] = static_cast<cl_uint>(targetBits);
         buffer[3] = 0;
         buffer[4] = 0;
-        err = clEnqueueWriteBuffer(queue, dispatchData, CL_TRUE, 0, sizeof(buffer), buffer, 0, NULL, NULL);
+        {
+            trace::Span write("write $dispatchData");
+            err = clEnqueueWriteBuffer(queue, dispatchData, CL_TRUE, 0, sizeof(buffer), buffer, 0, NULL, Profile("write $dispatchData"));
+        }
         if(err != CL_SUCCESS) throw std::string("CL error ") + std::to_string(err) + " while attempting to update $dispatchData";
 
         cl_uint zero = 0;
-        clEnqueueWriteBuffer(queue, candidates, true, 0, sizeof(cl_uint), &zero, 0, NULL, NULL);
+        {
+            trace::Span write("write $candidates");
+            clEnqueueWriteBuffer(queue, candidates, true, 0, sizeof(cl_uint), &zero, 0, NULL, Profile("write $candidates"));
+        }
 
-        algo.RunAlgorithm(queue, algo.hashCount);
+        trace::Span enqueue("RunAlgorithm");
+        if(profiling) {
+            std::vector<cl_event> kernels;
+            try {
+                algo.RunAlgorithm(queue, algo.hashCount, &kernels);
+            } catch(...) {
+                for(auto ev : kernels) clReleaseEvent(ev);
+                throw;
+            }
+            auto names(algo.KernelNames());
+            for(asizei loop = 0; loop < kernels.size(); loop++) inFlight.push_back(std::make_pair(names[loop], kernels[loop]));
+            dispatchedHashes = algo.hashCount;
+        }
+        else algo.RunAlgorithm(queue, algo.hashCount);
         dispatchedHeader = blockHeader;
+        dispatchedTarget = targetBits;
 
         nonces = reinterpret_cast<cl_uint*>(clEnqueueMapBuffer(queue, candidates, CL_FALSE, CL_MAP_READ, 0, nonceBufferSize, 0, NULL, &mapping, &err));
         if(err != CL_SUCCESS) throw std::string("CL error ") + std::to_string(err) + " attempting to map nonce buffers.";
@@ -92,6 +124,7 @@ public:
 
 
     MinedNonces GetResults() {
+        trace::Span span("GetResults");
         asizei count = *nonces;
         if(count > maxResults) {
             //! \todo Resize buffer for next time! This isn't very likely anyway as more results --> higher diff --> less results
@@ -110,12 +143,38 @@ public:
         }
         clEnqueueUnmapMemObject(queue, candidates, nonces, 0, NULL, NULL);
         nonces = nullptr;
-        clReleaseEvent(mapping);
+        if(profiling) {
+            inFlight.push_back(std::make_pair(std::string("map $candidates"), mapping));
+            Accumulate();
+        }
+        else clReleaseEvent(mapping);
         mapping = 0;
         return ret;
     }
 
 
+    /*! Same as GetResults but results go to queue so whoever drains it can check them while the next dispatch is already running.
+    Nothing can be dispatched before results are pulled out of the mapped buffer so a full queue is waited here, yielding.
+    Returns how many times the queue was found full, 0 being the norm. */
+    asizei PushResults(ResultQueue &queue, asizei device) {
+        DispatchResults push;
+        push.device = device;
+        push.targetBits = dispatchedTarget;
+        push.difficultyNumerator = algo.GetDifficultyNumerator();
+        push.uintsPerHash = algo.uintsPerHash;
+        push.bigEndian = algo.BigEndian();
+        push.found = GetResults();
+        trace::Span span("PushResults");
+        push.enqueued = trace::Now();
+        asizei full = 0;
+        while(!queue.TryPush(push)) {
+            full++;
+            std::this_thread::yield();
+        }
+        return full;
+    }
+
+
     void Push(LateBinding &slot, asizei valueIndex) {
         // Do nothing. Stop-n-wait has only early bound buffers.
     }
@@ -126,6 +185,17 @@ public:
     //! This is needed mainly for testing. No real need to have it there but more private stuff.
     cl_command_queue GetQueue() const { return queue; }
 
+    //! Device time taken by a command, summed across all dispatches whose results have been pulled out.
+    struct CommandTime {
+        std::string name; //!< "write $buffer", "map $candidates" or fileName:entryPoint for kernels
+        aulong ns = 0;
+        CommandTime(const std::string &command) : name(command) { }
+    };
+    //! Commands in enqueue order, empty if not profiling.
+    const std::vector<CommandTime>& GetProfile() const { return profile; }
+    //! Hashes computed by the dispatches accounted in GetProfile, to turn times in ns/hash.
+    aulong GetProfiledHashes() const { return profiledHashes; }
+
     //! Returns true if the header **might** be returned by a future call to GetResults
     bool IsInFlight(const std::array<aubyte, 80> &test) {
         return test == dispatchedHeader || test == blockHeader;
@@ -138,11 +208,61 @@ private:
     cl_event mapping = 0;
     cl_command_queue queue = 0;
     auint *nonces = nullptr;
+    const bool profiling;
+    std::vector<std::pair<std::string, cl_event>> inFlight; //!< commands of the last dispatch to be profiled, when profiling
+    std::vector<CommandTime> profile;
+    aulong profiledHashes = 0;
+    asizei dispatchedHashes = 0;
+    along deviceToHost = 0; //!< add to device profiling times to get trace::Now() times
     std::array<aubyte, 80> dispatchedHeader; //!< block dispatched to last RunAlgorithm
     std::array<aubyte, 80> blockHeader; //!< block to dispatch at NEXT RunAlgorithm!
     aulong targetBits;
+    aulong dispatchedTarget = 0; //!< targetBits dispatched to last RunAlgorithm
     asizei maxResults = 0;
 
+    //! Event to be passed to an enqueue call so the command is profiled, NULL when not profiling.
+    cl_event* Profile(const char *command) {
+        if(!profiling) return NULL;
+        inFlight.push_back(std::make_pair(std::string(command), cl_event(0)));
+        return &inFlight.back().second;
+    }
+
+    /*! Device and host clocks are unrelated. The marker completes right before clFinish returns, so its end is taken to be trace::Now().
+    Good to a few microseconds, that is what it takes to go back from the driver. */
+    void CalibrateClock() {
+        cl_event marker = 0;
+        if(clEnqueueMarkerWithWaitList(queue, 0, NULL, &marker) != CL_SUCCESS) return;
+        clFinish(queue);
+        const aulong host = trace::Now();
+        cl_ulong end = 0;
+        clGetEventProfilingInfo(marker, CL_PROFILING_COMMAND_END, sizeof(end), &end, NULL);
+        clReleaseEvent(marker);
+        deviceToHost = along(host) - along(end);
+    }
+
+    //! Called when results are pulled out, the queue being in order all the commands of the dispatch are complete.
+    void Accumulate() {
+        bool same = profile.size() == inFlight.size();
+        for(asizei loop = 0; same && loop < inFlight.size(); loop++) same = profile[loop].name == inFlight[loop].first;
+        if(!same) { // different commands this time around, restart accounting so all times and profiledHashes cover the same dispatches
+            profile.clear();
+            for(const auto &cmd : inFlight) profile.push_back(CommandTime(cmd.first));
+            profiledHashes = 0;
+        }
+        for(asizei loop = 0; loop < inFlight.size(); loop++) {
+            cl_ulong start = 0, end = 0;
+            cl_event ev = inFlight[loop].second;
+            if(!ev) continue; // enqueue gave no event, the command keeps its place in profile with no time added
+            clGetEventProfilingInfo(ev, CL_PROFILING_COMMAND_START, sizeof(start), &start, NULL);
+            clGetEventProfilingInfo(ev, CL_PROFILING_COMMAND_END, sizeof(end), &end, NULL);
+            clReleaseEvent(ev);
+            if(end > start) trace::Device(inFlight[loop].first.c_str(), aulong(along(start) + deviceToHost), aulong(along(end) + deviceToHost));
+            profile[loop].ns += end > start? end - start : 0;
+        }
+        inFlight.clear();
+        profiledHashes += dispatchedHashes;
+    }
+
     void PrepareIOBuffers(cl_context context, asizei hashCount){
         cl_int error;
         asizei byteCount = 80;
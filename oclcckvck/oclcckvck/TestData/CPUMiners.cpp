@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2015 Massimo Del Zotto
+ * This code is released under the MIT license.
+ * For conditions of distribution and use, see the LICENSE or hit the web.
+ */
+#include "CPUMiners.h"
+#include "../StepTest/misc.h"
+#include "NeoscryptKDF.h"
+#include "NeoscryptCoreLoops.h"
+#include "../../Common/hashing.h"
+#include "../../Common/AREN/SerializationBuffers.h"
+#include <string>
+
+namespace testData {
+
+
+std::vector<auint> CPUMiner::Scan(const aubyte header[80], aulong targetBits, aulong first, aulong count) const {
+    if(first > (1ull << 32) || count > (1ull << 32) - first) throw std::string("CPU miner nonce range goes past 2^32 nonces.");
+    if(count > asizei(-1)) throw std::string("CPU miner nonce range too big for this build, split it.");
+    std::array<auint, 20> block;
+    memcpy_s(block.data(), sizeof(block), header, 80);
+    auto partial(stepTest::CheckRanges<std::vector<auint>>(asizei(count), [this, &block, targetBits, first](std::vector<auint> &found, asizei begin, asizei end) {
+        std::vector<aulong> magic(batch);
+        for(asizei base = begin; base < end; base += batch) {
+            const asizei hashes = end - base < batch? end - base : batch;
+            const auint nonce = auint(first + base);
+            Magic(magic.data(), block, nonce, hashes);
+            for(asizei i = 0; i < hashes; i++) {
+                if(Passes(magic[i], targetBits)) found.push_back(SWAP_BYTES(auint(nonce + i)));
+            }
+        }
+    }));
+    std::vector<auint> ret;
+    for(const auto &part : partial) ret.insert(ret.end(), part.cbegin(), part.cend());
+    return ret;
+}
+
+
+aulong CPUMiner::HostMagic(const aubyte header[80], auint nonce) const {
+    std::array<auint, 20> block;
+    memcpy_s(block.data(), sizeof(block), header, 80);
+    aulong magic = 0;
+    Magic(&magic, block, nonce, 1);
+    return magic;
+}
+
+
+void MYRGRSCPU::Magic(aulong *magic, const std::array<auint, 20> &header, auint first, asizei count) const {
+    std::vector<aubyte> groestl(count * 64);
+    hashChain::Chain<hashChain::Groestl512>::Headers(groestl.data(), header, first, count);
+
+    // SHA-256 of a 64 byte message is the message block followed by a padding only block, same for all hashes.
+    aubyte padding[64];
+    memset(padding, 0, sizeof(padding));
+    padding[0] = 0x80;
+    padding[62] = 0x02; // 512 bits, big endian
+    std::vector<hashing::sha256::State> state(count, hashing::sha256::IV());
+    std::vector<const aubyte*> blocks(count);
+    for(asizei i = 0; i < count; i++) blocks[i] = groestl.data() + i * 64;
+    hashing::sha256::Compress(state.data(), blocks.data(), count);
+    for(asizei i = 0; i < count; i++) blocks[i] = padding;
+    hashing::sha256::Compress(state.data(), blocks.data(), count);
+
+    // Digest is big endian, magic is bytes [24..31] taken as a little endian ulong.
+    for(asizei i = 0; i < count; i++) magic[i] = (aulong(SWAP_BYTES(state[i][7])) << 32) | SWAP_BYTES(state[i][6]);
+}
+
+
+NeoscryptCPU::NeoscryptCPU() : CPUMiner("Neoscrypt", stepTest::nsHelp::CORE_LANES) { }
+
+
+void NeoscryptCPU::Magic(aulong *magic, const std::array<auint, 20> &header, auint first, asizei count) const {
+    using namespace stepTest;
+    const asizei LANES = nsHelp::CORE_LANES;
+    const auint iterations = 128;
+    std::array<auint, (256 + 64) / 4> buff_a[LANES];
+    std::array<auint, (256 + 32) / 4> buff_b[LANES];
+    std::array<auint, 64> salsa[LANES], chacha[LANES];
+    // 128 KiB, allocating it for each call would take more than the core loops. The arena is the one hashing::Scrypt uses.
+    auint *padBlob = reinterpret_cast<auint*>(hashing::ScratchArena::ThisThread().Get(LANES * iterations * 64 * sizeof(auint)));
+    auint *salsaState[LANES], *chachaState[LANES], *pad[LANES];
+    NS_KDFHelper helper;
+    for(asizei lane = 0; lane < count; lane++) {
+        std::array<auint, 20> block(header);
+        block[19] = first + auint(lane);
+        salsa[lane] = helper.FirstKDF(reinterpret_cast<const aubyte*>(block.data()), reinterpret_cast<aubyte*>(buff_a[lane].data()), reinterpret_cast<aubyte*>(buff_b[lane].data()));
+        chacha[lane] = salsa[lane];
+        salsaState[lane] = salsa[lane].data();
+        chachaState[lane] = chacha[lane].data();
+        pad[lane] = padBlob + lane * iterations * 64;
+    }
+    if(count == LANES) {
+        nsHelp::SequentialWriteLanes<LANES>(iterations, pad, salsaState, nsHelp::Salsa());
+        nsHelp::IndirectedReadLanes<LANES>(iterations, salsaState, pad, nsHelp::Salsa());
+        nsHelp::SequentialWriteLanes<LANES>(iterations, pad, chachaState, nsHelp::Chacha());
+        nsHelp::IndirectedReadLanes<LANES>(iterations, chachaState, pad, nsHelp::Chacha());
+    }
+    else {
+        for(asizei lane = 0; lane < count; lane++) {
+            nsHelp::SequentialWrite(iterations, pad[lane], salsaState[lane], nsHelp::Salsa());
+            nsHelp::IndirectedRead(iterations, salsaState[lane], pad[lane], nsHelp::Salsa());
+            nsHelp::SequentialWrite(iterations, pad[lane], chachaState[lane], nsHelp::Chacha());
+            nsHelp::IndirectedRead(iterations, chachaState[lane], pad[lane], nsHelp::Chacha());
+        }
+    }
+    for(asizei lane = 0; lane < count; lane++) {
+        std::array<auint, 64> mixed;
+        for(asizei i = 0; i < mixed.size(); i++) mixed[i] = salsa[lane][i] ^ chacha[lane][i];
+        auto final(helper.LastKDF(mixed, reinterpret_cast<const aubyte*>(buff_a[lane].data()), reinterpret_cast<aubyte*>(buff_b[lane].data())));
+        const auint *dword = reinterpret_cast<const auint*>(final.data());
+        magic[lane] = (aulong(dword[7]) << 32) | dword[6];
+    }
+}
+
+
+}
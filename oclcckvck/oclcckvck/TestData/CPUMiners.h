@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2015 Massimo Del Zotto
+ * This code is released under the MIT license.
+ * For conditions of distribution and use, see the LICENSE or hit the web.
+ */
+#pragma once
+#include "../../Common/AREN/ArenDataTypes.h"
+#include "../HashChain.h"
+#include <array>
+#include <vector>
+
+namespace testData {
+
+/*! Host implementations of the complete algorithms, the same ones the test data was generated for with a legacy miner.
+They produce the same nonces the kernels do so new test runs for arbitrary headers can be generated without the legacy miner.
+Nonces are scanned the way AlgoTest::RunTests does: nonce 0 up to iterations * nominalHashCount, the header being TestRun::clData
+with the nonce going in the last 4 bytes, little endian. Results are returned the way the kernels output them: bytes swapped
+(see the various found_candidates) and sorted by nonce. */
+class CPUMiner {
+public:
+    const char *const name;
+    virtual ~CPUMiner() { }
+
+    /*! Test nonces [first, first + count), split across all the host threads with stepTest::CheckRanges.
+    Throws std::string if the range goes past 2^32 nonces. */
+    std::vector<auint> Scan(const aubyte header[80], aulong targetBits, aulong first, aulong count) const;
+
+    //! Produce the nonces the test data has for an AlgoTest::TestRun, nominalHashCount being the one of the corresponding AlgoTest.
+    template<typename TestRun>
+    std::vector<auint> Scan(const TestRun &run, aulong nominalHashCount) const {
+        return Scan(run.clData, run.targetBits, 0, aulong(run.iterations) * nominalHashCount);
+    }
+
+    /*! Value compared to the target for a single nonce, as the kernels compute it from uints 6 and 7 of their final hash (see MinedNonces::hashes).
+    Nonce is in host order, not as the kernels output it. */
+    aulong HostMagic(const aubyte header[80], auint nonce) const;
+    bool Accepts(aulong magic, aulong targetBits) const { return Passes(magic, targetBits); }
+
+protected:
+    const asizei batch; //!< nonces given to each Magic call, at most
+    CPUMiner(const char *algo, asizei hashesPerCall) : name(algo), batch(hashesPerCall) { }
+
+    /*! Compute the value to be compared to the target for nonces [first, first + count) where count <= batch.
+    Header is clData as uints, its last one is to be replaced by the nonce. Called by multiple threads at once, scratch memory
+    comes from hashing::ScratchArena::ThisThread(). */
+    virtual void Magic(aulong *magic, const std::array<auint, 20> &header, auint first, asizei count) const = 0;
+    virtual bool Passes(aulong magic, aulong target) const { return magic <= target; }
+};
+
+
+/*! Chains of 512 bit hashes comparing uints 6 and 7 of the final hash. CHAIN is a hashChain::Chain,
+so declaring a new algorithm of this kind is a typedef and a name. */
+template<typename CHAIN>
+class ChainCPU : public CPUMiner {
+public:
+    explicit ChainCPU(const char *algo) : CPUMiner(algo, BATCH) { }
+protected:
+    static const asizei BATCH = 256;
+    void Magic(aulong *magic, const std::array<auint, 20> &header, auint first, asizei count) const {
+        aubyte hashes[BATCH * 64];
+        CHAIN::Headers(hashes, header, first, count);
+        for(asizei i = 0; i < count; i++) {
+            const auint *words = reinterpret_cast<const auint*>(hashes + i * 64);
+            magic[i] = (aulong(words[7]) << 32) | words[6];
+        }
+    }
+};
+
+
+class QubitCPU : public ChainCPU<hashChain::Qubit> {
+public:
+    QubitCPU() : ChainCPU("Qubit") { }
+};
+
+
+class FreshCPU : public ChainCPU<hashChain::Fresh> {
+public:
+    FreshCPU() : ChainCPU("Fresh") { }
+};
+
+
+//! Groestl-512 then SHA-256 of the 64 byte digest. SHA-256 does not fit in a chain of 512 bit hashes, it goes through the multi-buffer hashing::sha256::Compress.
+class MYRGRSCPU : public CPUMiner {
+public:
+    MYRGRSCPU() : CPUMiner("MYRGRS", 256) { }
+protected:
+    void Magic(aulong *magic, const std::array<auint, 20> &header, auint first, asizei count) const;
+};
+
+
+/*! FastKDF from stepTest::NS_KDFHelper, then Salsa and ChaCha core loops from stepTest::nsHelp, CORE_LANES hashes at a time.
+Slower than the others by orders of magnitude, the kernels also use a strict comparison against target. */
+class NeoscryptCPU : public CPUMiner {
+public:
+    NeoscryptCPU();
+protected:
+    void Magic(aulong *magic, const std::array<auint, 20> &header, auint first, asizei count) const;
+    bool Passes(aulong magic, aulong target) const { return magic < target; }
+};
+
+}
@@ -0,0 +1,308 @@
+/*
+ * Copyright (C) 2015 Massimo Del Zotto
+ * This code is released under the MIT license.
+ * For conditions of distribution and use, see the LICENSE or hit the web.
+ */
+#include "NeoscryptCoreLoops.h"
+#include <intrin.h>
+#include <immintrin.h>
+
+/* SSE2 is always there on x64 and MSVC tells us when it is enabled on x86, AVX2 is checked at runtime.
+There's no way to turn them off, the single state operators are the scalar reference. */
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NS_MIX_SSE2 1
+#else
+#define NS_MIX_SSE2 0
+#endif
+
+namespace stepTest {
+
+namespace nsHelp {
+
+
+static bool ProbeAVX2() {
+	int regs[4];
+	__cpuid(regs, 0);
+	if(regs[0] < 7) return false;
+	__cpuid(regs, 1);
+	const bool osxsave = (regs[2] & (1 << 27)) != 0;
+	__cpuidex(regs, 7, 0);
+	return (regs[1] & (1 << 5)) && osxsave && (_xgetbv(0) & 6) == 6;
+}
+
+static const bool avx2 = ProbeAVX2();
+
+
+void Salsa::operator()(auint state[16]) {
+	for(auint loop = 0; loop < MIX_ROUNDS; loop++) {
+		// First we mangle 4 independant columns. Each column starts on a diagonal cell so they are "rotated up" somehow.
+		state[ 4] ^= _rotl(state[ 0] + state[12], 7u);
+		state[ 8] ^= _rotl(state[ 4] + state[ 0], 9u);
+		state[12] ^= _rotl(state[ 8] + state[ 4], 13u);
+		state[ 0] ^= _rotl(state[12] + state[ 8], 18u);
+
+		state[ 9] ^= _rotl(state[ 5] + state[ 1], 7u);
+		state[13] ^= _rotl(state[ 9] + state[ 5], 9u);
+		state[ 1] ^= _rotl(state[13] + state[ 9], 13u);
+		state[ 5] ^= _rotl(state[ 1] + state[13], 18u);
+
+		state[14] ^= _rotl(state[10] + state[ 6], 7u);
+		state[ 2] ^= _rotl(state[14] + state[10], 9u);
+		state[ 6] ^= _rotl(state[ 2] + state[14], 13u);
+		state[10] ^= _rotl(state[ 6] + state[ 2], 18u);
+
+		state[ 3] ^= _rotl(state[15] + state[11], 7u);
+		state[ 7] ^= _rotl(state[ 3] + state[15], 9u);
+		state[11] ^= _rotl(state[ 7] + state[ 3], 13u);
+		state[15] ^= _rotl(state[11] + state[ 7], 18u);
+
+		// Then we mangle rows, again those are rotated. First is rotated 3, others are rotated less.
+		// It would be easier to visualize that the other way around.
+		state[ 1] ^= _rotl(state[ 0] + state[ 3], 7u);
+		state[ 2] ^= _rotl(state[ 1] + state[ 0], 9u);
+		state[ 3] ^= _rotl(state[ 2] + state[ 1], 13u);
+		state[ 0] ^= _rotl(state[ 3] + state[ 2], 18u);
+
+		state[ 6] ^= _rotl(state[ 5] + state[ 4], 7u);
+		state[ 7] ^= _rotl(state[ 6] + state[ 5], 9u);
+		state[ 4] ^= _rotl(state[ 7] + state[ 6], 13u);
+		state[ 5] ^= _rotl(state[ 4] + state[ 7], 18u);
+
+		state[11] ^= _rotl(state[10] + state[ 9], 7u);
+		state[ 8] ^= _rotl(state[11] + state[10], 9u);
+		state[ 9] ^= _rotl(state[ 8] + state[11], 13u);
+		state[10] ^= _rotl(state[ 9] + state[ 8], 18u);
+
+		state[12] ^= _rotl(state[15] + state[14], 7u);
+		state[13] ^= _rotl(state[12] + state[15], 9u);
+		state[14] ^= _rotl(state[13] + state[12], 13u);
+		state[15] ^= _rotl(state[14] + state[13], 18u);
+	}
+}
+
+
+void Chacha::operator()(auint state[16]) {
+	for(auint loop = 0; loop < MIX_ROUNDS; loop++) {
+		// Here we have some mangling "by column".
+		state[ 0] += state[ 4];    state[12] = _rotl(state[12] ^ state[ 0], 16u);
+		state[ 8] += state[12];    state[ 4] = _rotl(state[ 4] ^ state[ 8], 12u);
+		state[ 0] += state[ 4];    state[12] = _rotl(state[12] ^ state[ 0], 8u);
+		state[ 8] += state[12];    state[ 4] = _rotl(state[ 4] ^ state[ 8], 7u);
+
+		state[ 1] += state[ 5];    state[13] = _rotl(state[13] ^ state[ 1], 16u);
+		state[ 9] += state[13];    state[ 5] = _rotl(state[ 5] ^ state[ 9], 12u);
+		state[ 1] += state[ 5];    state[13] = _rotl(state[13] ^ state[ 1], 8u);
+		state[ 9] += state[13];    state[ 5] = _rotl(state[ 5] ^ state[ 9], 7u);
+
+		state[ 2] += state[ 6];    state[14] = _rotl(state[14] ^ state[ 2], 16u);
+		state[10] += state[14];    state[ 6] = _rotl(state[ 6] ^ state[10], 12u);
+		state[ 2] += state[ 6];    state[14] = _rotl(state[14] ^ state[ 2], 8u);
+		state[10] += state[14];    state[ 6] = _rotl(state[ 6] ^ state[10], 7u);
+
+		state[ 3] += state[ 7];    state[15] = _rotl(state[15] ^ state[ 3], 16u);
+		state[11] += state[15];    state[ 7] = _rotl(state[ 7] ^ state[11], 12u);
+		state[ 3] += state[ 7];    state[15] = _rotl(state[15] ^ state[ 3], 8u);
+		state[11] += state[15];    state[ 7] = _rotl(state[ 7] ^ state[11], 7u);
+
+		// Then we mix by diagonal.
+		state[ 0] += state[ 5];    state[15] = _rotl(state[15] ^ state[ 0], 16u);
+		state[10] += state[15];    state[ 5] = _rotl(state[ 5] ^ state[10], 12u);
+		state[ 0] += state[ 5];    state[15] = _rotl(state[15] ^ state[ 0], 8u);
+		state[10] += state[15];    state[ 5] = _rotl(state[ 5] ^ state[10], 7u);
+
+		state[ 1] += state[ 6];    state[12] = _rotl(state[12] ^ state[ 1], 16u);
+		state[11] += state[12];    state[ 6] = _rotl(state[ 6] ^ state[11], 12u);
+		state[ 1] += state[ 6];    state[12] = _rotl(state[12] ^ state[ 1], 8u);
+		state[11] += state[12];    state[ 6] = _rotl(state[ 6] ^ state[11], 7u);
+
+		state[ 2] += state[ 7];    state[13] = _rotl(state[13] ^ state[ 2], 16u);
+		state[ 8] += state[13];    state[ 7] = _rotl(state[ 7] ^ state[ 8], 12u);
+		state[ 2] += state[ 7];    state[13] = _rotl(state[13] ^ state[ 2], 8u);
+		state[ 8] += state[13];    state[ 7] = _rotl(state[ 7] ^ state[ 8], 7u);
+
+		state[ 3] += state[ 4];    state[14] = _rotl(state[14] ^ state[ 3], 16u);
+		state[ 9] += state[14];    state[ 4] = _rotl(state[ 4] ^ state[ 9], 12u);
+		state[ 3] += state[ 4];    state[14] = _rotl(state[14] ^ state[ 3], 8u);
+		state[ 9] += state[14];    state[ 4] = _rotl(state[ 4] ^ state[ 9], 7u);
+	}
+}
+
+
+#if NS_MIX_SSE2
+/* Vectorised mixing, rows of the state go in 4 vectors. The 4 quarter-rounds of each half-round are independent and go in the 4 elements
+of each vector, rotating the vectors by one element at a time lines up the second half. ChaCha columns are the rows of the state so it's the
+usual layout, with diagonals lined up by rotations. Salsa columns start on the diagonal (see the scalar code) so the state is kept in diagonals:
+A = {0, 5, 10, 15}, B = {4, 9, 14, 3}, C = {8, 13, 2, 7}, D = {12, 1, 6, 11}, then its rows line up after the same rotations.
+Each half-round is a long dependency chain so a single state is no faster than the scalar code: two states are always mixed together
+to overlap them. With AVX2 each 128 bit half holds a different state, shuffles do not cross halves so the same code mixes four at once. */
+#define SALSA_DOUBLE_ROUND(A, B, C, D) \
+	B = V_XOR(B, V_ROTL(V_ADD(A, D),  7)); \
+	C = V_XOR(C, V_ROTL(V_ADD(B, A),  9)); \
+	D = V_XOR(D, V_ROTL(V_ADD(C, B), 13)); \
+	A = V_XOR(A, V_ROTL(V_ADD(D, C), 18)); \
+	B = V_SHUFFLE(B, 0x93); \
+	C = V_SHUFFLE(C, 0x4E); \
+	D = V_SHUFFLE(D, 0x39); \
+	D = V_XOR(D, V_ROTL(V_ADD(A, B),  7)); \
+	C = V_XOR(C, V_ROTL(V_ADD(D, A),  9)); \
+	B = V_XOR(B, V_ROTL(V_ADD(C, D), 13)); \
+	A = V_XOR(A, V_ROTL(V_ADD(B, C), 18)); \
+	B = V_SHUFFLE(B, 0x39); \
+	C = V_SHUFFLE(C, 0x4E); \
+	D = V_SHUFFLE(D, 0x93);
+
+#define CHACHA_QUARTER_ROUNDS(A, B, C, D) \
+	A = V_ADD(A, B);    D = V_ROTL(V_XOR(D, A), 16); \
+	C = V_ADD(C, D);    B = V_ROTL(V_XOR(B, C), 12); \
+	A = V_ADD(A, B);    D = V_ROTL(V_XOR(D, A),  8); \
+	C = V_ADD(C, D);    B = V_ROTL(V_XOR(B, C),  7);
+
+#define CHACHA_DOUBLE_ROUND(A, B, C, D) \
+	CHACHA_QUARTER_ROUNDS(A, B, C, D) \
+	B = V_SHUFFLE(B, 0x39); \
+	C = V_SHUFFLE(C, 0x4E); \
+	D = V_SHUFFLE(D, 0x93); \
+	CHACHA_QUARTER_ROUNDS(A, B, C, D) \
+	B = V_SHUFFLE(B, 0x93); \
+	C = V_SHUFFLE(C, 0x4E); \
+	D = V_SHUFFLE(D, 0x39);
+
+//! Element i of row r of the vectorised layout, either Salsa or ChaCha. The ChaCha one is the identity.
+static const auint rowLayout[2][4][4] = {
+	{
+		{  0,  5, 10, 15 },
+		{  4,  9, 14,  3 },
+		{  8, 13,  2,  7 },
+		{ 12,  1,  6, 11 }
+	},
+	{
+		{  0,  1,  2,  3 },
+		{  4,  5,  6,  7 },
+		{  8,  9, 10, 11 },
+		{ 12, 13, 14, 15 }
+	}
+};
+
+
+static __m128i LoadRow(const auint state[16], const auint index[4]) {
+	return _mm_set_epi32(int(state[index[3]]), int(state[index[2]]), int(state[index[1]]), int(state[index[0]]));
+}
+
+
+static void StoreRow(auint state[16], const auint index[4], __m128i v) {
+	auint elements[4];
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(elements), v);
+	for(asizei i = 0; i < 4; i++) state[index[i]] = elements[i];
+}
+
+
+#define V __m128i
+#define V_ADD _mm_add_epi32
+#define V_XOR _mm_xor_si128
+#define V_ROTL(v, n) _mm_or_si128(_mm_slli_epi32(v, n), _mm_srli_epi32(v, 32 - (n)))
+#define V_SHUFFLE _mm_shuffle_epi32
+#define V_LOAD(r, state) LoadRow(state[0], layout[r])
+#define V_STORE(r, state, v) StoreRow(state[0], layout[r], v)
+
+/* Two states: {A0, B0, C0, D0} and {A1, B1, C1, D1}. The AVX2 version below redefines the V_ macros so a V holds the same row of
+two states, the first two go in the first vector, the others in the second. */
+#define MIX_TWO_SETS(DOUBLE_ROUND, LAYOUT, STEP) \
+	const auint (*layout)[4] = rowLayout[LAYOUT]; \
+	V A0 = V_LOAD(0, state), B0 = V_LOAD(1, state), C0 = V_LOAD(2, state), D0 = V_LOAD(3, state); \
+	V A1 = V_LOAD(0, (state + STEP)), B1 = V_LOAD(1, (state + STEP)), C1 = V_LOAD(2, (state + STEP)), D1 = V_LOAD(3, (state + STEP)); \
+	for(auint loop = 0; loop < MIX_ROUNDS; loop++) { \
+		DOUBLE_ROUND(A0, B0, C0, D0) \
+		DOUBLE_ROUND(A1, B1, C1, D1) \
+	} \
+	V_STORE(0, state, A0); V_STORE(1, state, B0); V_STORE(2, state, C0); V_STORE(3, state, D0); \
+	V_STORE(0, (state + STEP), A1); V_STORE(1, (state + STEP), B1); V_STORE(2, (state + STEP), C1); V_STORE(3, (state + STEP), D1);
+
+static void SalsaSSE2(auint *const *state) {
+	MIX_TWO_SETS(SALSA_DOUBLE_ROUND, 0, 1)
+}
+
+
+static void ChachaSSE2(auint *const *state) {
+	MIX_TWO_SETS(CHACHA_DOUBLE_ROUND, 1, 1)
+}
+
+#undef V
+#undef V_ADD
+#undef V_XOR
+#undef V_ROTL
+#undef V_SHUFFLE
+#undef V_LOAD
+#undef V_STORE
+
+
+static __m256i LoadRows(const auint *const *state, const auint index[4]) {
+	return _mm256_inserti128_si256(_mm256_castsi128_si256(LoadRow(state[0], index)), LoadRow(state[1], index), 1);
+}
+
+
+static void StoreRows(auint *const *state, const auint index[4], __m256i v) {
+	StoreRow(state[0], index, _mm256_castsi256_si128(v));
+	StoreRow(state[1], index, _mm256_extracti128_si256(v, 1));
+}
+
+
+#define V __m256i
+#define V_ADD _mm256_add_epi32
+#define V_XOR _mm256_xor_si256
+#define V_ROTL(v, n) _mm256_or_si256(_mm256_slli_epi32(v, n), _mm256_srli_epi32(v, 32 - (n)))
+#define V_SHUFFLE _mm256_shuffle_epi32
+#define V_LOAD(r, state) LoadRows(state, layout[r])
+#define V_STORE(r, state, v) StoreRows(state, layout[r], v)
+
+static void SalsaAVX2(auint *const *state) {
+	MIX_TWO_SETS(SALSA_DOUBLE_ROUND, 0, 2)
+	_mm256_zeroupper();
+}
+
+
+static void ChachaAVX2(auint *const *state) {
+	MIX_TWO_SETS(CHACHA_DOUBLE_ROUND, 1, 2)
+	_mm256_zeroupper();
+}
+
+#undef V
+#undef V_ADD
+#undef V_XOR
+#undef V_ROTL
+#undef V_SHUFFLE
+#undef V_LOAD
+#undef V_STORE
+#undef MIX_TWO_SETS
+#undef CHACHA_DOUBLE_ROUND
+#undef CHACHA_QUARTER_ROUNDS
+#undef SALSA_DOUBLE_ROUND
+#endif
+
+
+void Salsa::operator()(auint *const *state, asizei count) {
+	asizei done = 0;
+#if NS_MIX_SSE2
+	if(avx2) {
+		for(; count - done >= 4; done += 4) SalsaAVX2(state + done);
+	}
+	for(; count - done >= 2; done += 2) SalsaSSE2(state + done);
+#endif
+	for(; done < count; done++) (*this)(state[done]);
+}
+
+
+void Chacha::operator()(auint *const *state, asizei count) {
+	asizei done = 0;
+#if NS_MIX_SSE2
+	if(avx2) {
+		for(; count - done >= 4; done += 4) ChachaAVX2(state + done);
+	}
+	for(; count - done >= 2; done += 2) ChachaSSE2(state + done);
+#endif
+	for(; done < count; done++) (*this)(state[done]);
+}
+
+
+}
+
+}
@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2015 Massimo Del Zotto
+ * This code is released under the MIT license.
+ * For conditions of distribution and use, see the LICENSE or hit the web.
+ */
+#pragma once
+#include "../../Common/AREN/ArenDataTypes.h"
+
+
+/* Host reference of the Neoscrypt core loops. No OpenCL in here so microbench can time it without the SDK, the step tests
+validating the kernels are in StepTest/NS_CoreLoops.h. */
+namespace stepTest {
+
+
+namespace nsHelp {
+    static const auint MIX_ROUNDS = 10;
+    static const asizei CORE_LANES = 4; //!< hashes the validators run through the core loops together so they can be mixed together
+
+	// The usage of salsa or chacha also mandates use of a different shader compile define so and algorithm names so this has to be slightly more modular
+    // It is made quite more complicated by the fact AbstractAlgorithm identifier must be currently constructed by const char* and it's const.
+    enum class Pass {
+        sequentialWrite,
+        indirectedRead
+    };
+
+    /*! Mixing a single state is the scalar reference. Multiple states are mixed two at a time with SSE2 and four at a time with AVX2
+    when the CPU has it, leftovers go through the scalar code. */
+    struct Salsa {
+        static const char* GetDefineName() { return "SALSA"; }
+        static const char* GetAlgoName(Pass p) { return p == Pass::sequentialWrite? "SequentialWrite_salsa" : "IndirectedRead_salsa"; }
+        void operator()(auint state[16]);
+        void operator()(auint *const *state, asizei count); //!< count independent states, same as mixing them one after the other
+    };
+    struct Chacha {
+        static const char* GetDefineName() { return "CHACHA"; }
+        static const char* GetAlgoName(Pass p) { return p == Pass::sequentialWrite? "SequentialWrite_chacha" : "IndirectedRead_chacha"; }
+        void operator()(auint state[16]);
+        void operator()(auint *const *state, asizei count); //!< count independent states, same as mixing them one after the other
+    };
+
+	static const auint slicePerm[2][4] = {
+		{0, 1, 2, 3},
+		{0, 2, 1, 3}
+	};
+
+	/* Checking runs on all the host threads and still takes most of a step test: lanes are a template parameter so the loops
+	over them unroll and each lane count gets its own MixFunc call. */
+	/*! A single iteration of the sequential write loop for LANES independent hashes, state[lane] being 64 uints. When pad is not nullptr,
+	the 4 slices get stored at pad[lane] in the order they are consumed, which is not the same order they are in state.
+	Parity is the loop index % 2 as it selects the slice permutation. All the lanes are mixed with a single call. */
+	template<asizei LANES, typename MixFunc>
+	static void SequentialIterationLanes(auint *const *state, auint parity, auint *const *pad, MixFunc &&mix) {
+		for(auint slice = 0; slice < 4; slice++) {
+			auint *one[LANES];
+			auint prev[LANES][16];
+			for(asizei lane = 0; lane < LANES; lane++) {
+				one[lane] = state[lane] + slicePerm[parity][slice] * 16;
+				const auint *two = state[lane] + slicePerm[parity][(slice + 3) % 4] * 16;
+				for(auint el = 0; el < 16; el++) {
+					if(pad) pad[lane][slice * 16 + el] = one[lane][el];
+					one[lane][el] ^= two[el];
+					prev[lane][el] = one[lane][el];
+				}
+			}
+			if(LANES == 1) mix(one[0]);
+			else mix(one, LANES);
+			for(asizei lane = 0; lane < LANES; lane++) {
+				for(auint el = 0; el < 16; el++) one[lane][el] += prev[lane][el];
+			}
+		}
+	}
+
+	template<typename MixFunc>
+	static void SequentialIteration(auint *state, auint parity, auint *pad, MixFunc &&mix) {
+		SequentialIterationLanes<1>(&state, parity, pad? &pad : nullptr, mix);
+	}
+
+	/*! With a lookup gap G only every G-th state is written to pad. The pad is therefore ceil(128 / G) * 64 uints instead of 128 * 64. */
+	template<asizei LANES, typename MixFunc>
+	static void SequentialWriteLanes(auint iterations, auint *const *pad, auint *const *state, MixFunc &&mix, auint lookupGap = 1) {
+		auint *dst[LANES];
+		for(asizei lane = 0; lane < LANES; lane++) dst[lane] = pad[lane];
+		for(auint loop = 0; loop < iterations; loop++) {
+			const bool store = loop % lookupGap == 0;
+			SequentialIterationLanes<LANES>(state, loop % 2, store? dst : nullptr, mix);
+			if(store) {
+				for(asizei lane = 0; lane < LANES; lane++) dst[lane] += 64;
+			}
+		}
+	}
+
+	template<typename MixFunc>
+	static void SequentialWrite(auint iterations, auint *pad, auint *state, MixFunc &&mix, auint lookupGap = 1) {
+		SequentialWriteLanes<1>(iterations, &pad, &state, mix, lookupGap);
+	}
+
+	/*! Pull out the pad entry which would have been written by SequentialWrite at iteration index if lookup gap was 1.
+	If it wasn't stored, start from the closest previous entry and run again the sequential write iterations to rebuild it. */
+	template<typename MixFunc>
+	static void PadEntry(auint entry[64], const auint *pad, auint index, auint lookupGap, MixFunc &&mix) {
+		const auint first = (index / lookupGap) * lookupGap;
+		const auint *stored = pad + (index / lookupGap) * 64;
+		auint state[64];
+		for(auint slice = 0; slice < 4; slice++) {
+			for(auint el = 0; el < 16; el++) state[slicePerm[first % 2][slice] * 16 + el] = stored[slice * 16 + el];
+		}
+		for(auint loop = first; loop < index; loop++) SequentialIteration(state, loop % 2, nullptr, mix);
+		for(auint slice = 0; slice < 4; slice++) {
+			for(auint el = 0; el < 16; el++) entry[slice * 16 + el] = state[slicePerm[index % 2][slice] * 16 + el];
+		}
+	}
+
+	//! Each lane reads from its own pad at its own index, only the sequential iteration following is run on all lanes together.
+	template<asizei LANES, typename MixFunc>
+	static void IndirectedReadLanes(auint iterations, auint *const *state, const auint *const *pad, MixFunc &&mix, auint lookupGap = 1) {
+		for(auint loop = 0; loop < iterations; loop++) {
+			for(asizei lane = 0; lane < LANES; lane++) {
+				const auint indirected = state[lane][48] % 128;
+				auint entry[64];
+				PadEntry(entry, pad[lane], indirected, lookupGap, mix);
+				for(auint slice = 0; slice < 4; slice++) {
+					auint *one = state[lane] + slicePerm[loop % 2][slice] * 16;
+					for(auint el = 0; el < 16; el++) one[el] ^= entry[slice * 16 + el];
+				}
+			}
+			SequentialIterationLanes<LANES>(state, loop % 2, nullptr, mix);
+		}
+	}
+
+	template<typename MixFunc>
+	static void IndirectedRead(auint iterations, auint *state, const auint *pad, MixFunc &&mix, auint lookupGap = 1) {
+		IndirectedReadLanes<1>(iterations, &state, &pad, mix, lookupGap);
+	}
+
+	/*! The kernels keep states interleaved by work item in groups of 64: element el of slice for hash nonce is at
+	(nonce / 64) * 64 * 64 + (slice * 16 + el) * 64 + nonce % 64. */
+	inline void LoadState(auint state[64], const auint *buffer, asizei nonce) {
+		const asizei get_local_size = 64; // number of hashes per work group
+		const auint *src = buffer + (nonce / get_local_size) * get_local_size * 64 + nonce % get_local_size;
+		for(asizei slice = 0; slice < 4; slice++) {
+			const auint *currSlice = src + slice * 16 * get_local_size;
+			for(asizei el = 0; el < 16; el++) state[slice * 16 + el] = currSlice[el * get_local_size];
+		}
+	}
+}
+
+}
@@ -3,7 +3,7 @@
  * This code is released under the MIT license.
  * For conditions of distribution and use, see the LICENSE or hit the web.
  */
-#include "NS_KDFs_4W.h"
+#include "NeoscryptKDF.h"
 
 namespace stepTest {
 
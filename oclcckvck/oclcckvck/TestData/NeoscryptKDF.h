@@ -0,0 +1,34 @@
+/*
+ * Copyright (C) 2015 Massimo Del Zotto
+ * This code is released under the MIT license.
+ * For conditions of distribution and use, see the LICENSE or hit the web.
+ */
+#pragma once
+#include "../../Common/AREN/ArenDataTypes.h"
+#include <array>
+#include <cstring>
+
+
+// Host reference of the Neoscrypt KDFs, the step tests validating the kernels are in StepTest/NS_KDFs_4W.h.
+namespace stepTest {
+
+//! Stuff mostly copied from M8M BlockVerifier for Neoscrypt
+struct NS_KDFHelper {
+    static const auint KDF_CONST_N;
+    static const auint KDF_SIZE;
+	static const auint MIX_ROUNDS;
+	static const auint blake2S_IV[8];
+	static const aubyte blake2S_sigma[10][16];
+    
+
+    std::array<auint, 64> FirstKDF(const aubyte *block, aubyte *buff_a, aubyte *buff_b);
+	std::array<aubyte, 32> LastKDF(const std::array<auint, 64> &state, const aubyte *buff_a, aubyte *buff_b);
+
+private:
+    auint FastKDFIteration(auint buffStart, const aubyte *buff_a, aubyte *buff_b);
+    void FillInitialBuffer(aubyte *target, auint extraBytes, const aubyte *pattern, auint blockLen);
+    void Blake2S_64_32(auint *output, auint *input, auint *key, const auint numRounds);
+    std::array<auint, 8> Blake2SBlockXForm(const std::array<auint, 8> hash, const std::array<auint, 4> &counter, const auint numRounds, const std::array<auint, 16> &msg);
+};
+
+}
@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2015 Massimo Del Zotto
+ * This code is released under the MIT license.
+ * For conditions of distribution and use, see the LICENSE or hit the web.
+ */
+#include "Trace.h"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+#include <memory>
+#include <fstream>
+#include <cstring>
+
+namespace trace {
+
+
+bool enabled = false;
+
+
+struct Record {
+    char name[48];
+    aulong begin, end;
+    auint tid; //!< 0 for device commands
+};
+
+
+/*! Single writer, the thread currently owning it. written is only incremented after the record is in place so a reader sees
+complete records, at least until the writer goes around the ring. Then the oldest records are lost. */
+struct Ring {
+    static const asizei CAPACITY = 1 << 15;
+    std::atomic<aulong> written;
+    Record slot[CAPACITY];
+    Ring() : written(0) { }
+};
+
+
+static std::mutex registryLock;
+static std::vector<std::unique_ptr<Ring>> rings; //!< all the rings ever created, never destroyed as their records go to the next Session
+static std::vector<Ring*> released; //!< rings not owned by any thread
+static Ring *deviceRing = nullptr; //!< device commands, shared by all threads so guarded by deviceLock
+static std::mutex deviceLock;
+static std::atomic<auint> nextThread(1);
+static const std::chrono::high_resolution_clock::time_point epoch(std::chrono::high_resolution_clock::now());
+
+static __declspec(thread) Ring *threadRing = nullptr;
+static __declspec(thread) auint threadId = 0;
+
+
+aulong Now() {
+    using namespace std::chrono;
+    return aulong(duration_cast<nanoseconds>(high_resolution_clock::now() - epoch).count());
+}
+
+
+static Ring* NewRing() {
+    std::unique_lock<std::mutex> lock(registryLock);
+    if(released.size()) {
+        Ring *ret = released.back();
+        released.pop_back();
+        return ret;
+    }
+    rings.push_back(std::unique_ptr<Ring>(new Ring));
+    return rings.back().get();
+}
+
+
+static void Push(Ring &ring, const char *name, aulong begin, aulong end, auint tid) {
+    const aulong index = ring.written.load(std::memory_order_relaxed);
+    Record &rec(ring.slot[index % Ring::CAPACITY]);
+    strncpy_s(rec.name, sizeof(rec.name), name, _TRUNCATE);
+    rec.begin = begin;
+    rec.end = end;
+    rec.tid = tid;
+    ring.written.store(index + 1, std::memory_order_release);
+}
+
+
+void Host(const char *name, aulong begin, aulong end) {
+    if(!enabled) return;
+    if(!threadRing) threadRing = NewRing();
+    if(!threadId) threadId = nextThread++;
+    Push(*threadRing, name, begin, end, threadId);
+}
+
+
+void Device(const char *name, aulong begin, aulong end) {
+    if(!enabled) return;
+    std::unique_lock<std::mutex> lock(deviceLock);
+    if(!deviceRing) deviceRing = NewRing();
+    Push(*deviceRing, name, begin, end, 0);
+}
+
+
+void ReleaseThisThread() {
+    if(!threadRing) return;
+    std::unique_lock<std::mutex> lock(registryLock);
+    released.push_back(threadRing);
+    threadRing = nullptr;
+}
+
+
+static void Escaped(std::ofstream &out, const char *str) {
+    for(; *str; str++) {
+        if(*str == '"' || *str == '\\') out<<'\\';
+        if(*str >= 0 && *str < ' ') continue;
+        out<<*str;
+    }
+}
+
+
+Session::~Session() {
+    if(!enabled || file.empty()) return;
+    std::ofstream out(file, std::ios::out | std::ios::trunc);
+    if(!out.is_open()) return;
+    out<<"{\"traceEvents\":[\n";
+    out<<"{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"args\":{\"name\":\"host\"}},\n";
+    out<<"{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"device\"}}";
+    std::unique_lock<std::mutex> lock(registryLock);
+    std::unique_lock<std::mutex> device(deviceLock);
+    for(const auto &ring : rings) {
+        const aulong written = ring->written.load(std::memory_order_acquire);
+        const aulong first = written > Ring::CAPACITY? written - Ring::CAPACITY : 0;
+        for(aulong index = first; index < written; index++) {
+            const Record &rec(ring->slot[index % Ring::CAPACITY]);
+            if(rec.begin < since) continue;
+            out<<",\n{\"name\":\"";
+            Escaped(out, rec.name);
+            out<<"\",\"ph\":\"X\",\"pid\":"<<(rec.tid? 0 : 1)<<",\"tid\":"<<rec.tid;
+            out<<",\"ts\":"<<rec.begin / 1000<<'.'<<rec.begin % 1000 / 100<<rec.begin % 100 / 10<<rec.begin % 10;
+            const aulong dur = rec.end > rec.begin? rec.end - rec.begin : 0;
+            out<<",\"dur\":"<<dur / 1000<<'.'<<dur % 1000 / 100<<dur % 100 / 10<<dur % 10<<'}';
+        }
+    }
+    out<<"\n]}\n";
+}
+
+
+}
@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2015 Massimo Del Zotto
+ * This code is released under the MIT license.
+ * For conditions of distribution and use, see the LICENSE or hit the web.
+ */
+#pragma once
+#include "../Common/AREN/ArenDataTypes.h"
+#include <string>
+
+/*! Timeline of what the host and the device are doing, to be loaded in chrome://tracing or the Perfetto UI: gaps between a map completing
+and the next kernels being enqueued are easy to spot there. Each thread records spans in a ring buffer of its own, no locks involved after
+the first span so it can be left on for long runs. Device commands come from profiling events (see StopWaitDispatcher) converted to Now().
+Nothing is recorded unless enabled is set, a Session then writes everything recorded while it was alive. */
+namespace trace {
+
+extern bool enabled;
+
+//! Nanoseconds elapsed on the host clock since the first call.
+aulong Now();
+
+//! A span on the calling thread, name is copied (truncated to a few dozen chars) so it can be anything.
+void Host(const char *name, aulong begin, aulong end);
+
+//! A command run by the device, begin and end already converted to Now() clock.
+void Device(const char *name, aulong begin, aulong end);
+
+/*! Threads should call this before terminating (see VerifierPool) so their ring buffer gets reused by the next thread
+instead of being allocated again. What was recorded is kept. */
+void ReleaseThisThread();
+
+
+//! Records the span from construction to destruction on the calling thread. Name must be there until destruction.
+class Span {
+public:
+    explicit Span(const char *what) : name(what), begin(enabled? Now() : 0) { }
+    ~Span() { if(begin) Host(name, begin, Now()); }
+private:
+    const char *name;
+    const aulong begin;
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+};
+
+
+/*! Writes spans recorded from construction to destruction to fileName as chrome trace event JSON, even if leaving scope due to an exception.
+Host threads go in a "host" process, device commands in a "device" process. An empty fileName or tracing not being enabled writes nothing.
+Spans still being recorded while writing might be lost, only destroy a session when the threads it is interested in are done. */
+class Session {
+public:
+    explicit Session(const std::string &fileName) : file(fileName), since(Now()) { }
+    ~Session();
+private:
+    const std::string file;
+    const aulong since;
+    Session(const Session&) = delete;
+    Session& operator=(const Session&) = delete;
+};
+
+}
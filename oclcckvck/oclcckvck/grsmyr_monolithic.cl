@@ -470,7 +470,54 @@ uchar B64_6(ulong v) { return as_uchar8(v).s6; }
 uchar B64_7(ulong v) { return as_uchar8(v).s7; }
 
 
-ulong P_round(ulong *src, uint base, local ulong *t0, local ulong *t1, local ulong *t2, local ulong *t3, local ulong *t4, local ulong *t5) {
+/* Groestl T tables are all byte rotations of T0, with T4 being T0 rotated by 32 bits.
+GROESTL_LDS_TABLES selects how many of them are copied to LDS, the others are obtained by rotating those.
+6: the original layout, T0..T5 in LDS, T6, T7 straight from constant memory. 12 KiB LDS per workgroup.
+2: T0 and T4 in LDS, everything else rotated from those. 4 KiB.
+1: only T0 in LDS. 2 KiB, but most lookups need a rotate. */
+#if !defined GROESTL_LDS_TABLES
+#define GROESTL_LDS_TABLES 6
+#endif
+
+#if __ENDIAN_LITTLE__
+#define GROESTL_ROT(x, k) rotate(x, (ulong)(8 * (k)))
+#else
+#define GROESTL_ROT(x, k) rotate(x, (ulong)(64 - 8 * (k)))
+#endif
+
+#if GROESTL_LDS_TABLES == 6
+#define TL0(i) tables[256 * 0 + (i)]
+#define TL1(i) tables[256 * 1 + (i)]
+#define TL2(i) tables[256 * 2 + (i)]
+#define TL3(i) tables[256 * 3 + (i)]
+#define TL4(i) tables[256 * 4 + (i)]
+#define TL5(i) tables[256 * 5 + (i)]
+#define TL6(i) T6[i]
+#define TL7(i) T7[i]
+#elif GROESTL_LDS_TABLES == 2
+#define TL0(i) tables[i]
+#define TL1(i) GROESTL_ROT(tables[i], 1)
+#define TL2(i) GROESTL_ROT(tables[i], 2)
+#define TL3(i) GROESTL_ROT(tables[i], 3)
+#define TL4(i) tables[256 + (i)]
+#define TL5(i) GROESTL_ROT(tables[256 + (i)], 1)
+#define TL6(i) GROESTL_ROT(tables[256 + (i)], 2)
+#define TL7(i) GROESTL_ROT(tables[256 + (i)], 3)
+#elif GROESTL_LDS_TABLES == 1
+#define TL0(i) tables[i]
+#define TL1(i) GROESTL_ROT(tables[i], 1)
+#define TL2(i) GROESTL_ROT(tables[i], 2)
+#define TL3(i) GROESTL_ROT(tables[i], 3)
+#define TL4(i) GROESTL_ROT(tables[i], 4)
+#define TL5(i) GROESTL_ROT(tables[i], 5)
+#define TL6(i) GROESTL_ROT(tables[i], 6)
+#define TL7(i) GROESTL_ROT(tables[i], 7)
+#else
+#error GROESTL_LDS_TABLES must be 6, 2 or 1.
+#endif
+
+
+ulong P_round(ulong *src, uint base, local ulong *tables) {
     uint b0 = (base +  0) % 16;
     uint b1 = (base +  1) % 16;
     uint b2 = (base +  2) % 16;
@@ -479,12 +526,12 @@ ulong P_round(ulong *src, uint base, local ulong *t0, local ulong *t1, local ulo
     uint b5 = (base +  5) % 16;
     uint b6 = (base +  6) % 16;
     uint b7 = (base + 11) % 16;
-    return t0[B64_0(src[b0])] ^ t1[B64_1(src[b1])] ^ t2[B64_2(src[b2])] ^ t3[B64_3(src[b3])] ^
-           t4[B64_4(src[b4])] ^ t5[B64_5(src[b5])] ^ T6[B64_6(src[b6])] ^ T7[B64_7(src[b7])];
+    return TL0(B64_0(src[b0])) ^ TL1(B64_1(src[b1])) ^ TL2(B64_2(src[b2])) ^ TL3(B64_3(src[b3])) ^
+           TL4(B64_4(src[b4])) ^ TL5(B64_5(src[b5])) ^ TL6(B64_6(src[b6])) ^ TL7(B64_7(src[b7]));
 }
 
 
-ulong Q_round(ulong *src, uint base, local ulong *t0, local ulong *t1, local ulong *t2, local ulong *t3, local ulong *t4, local ulong *t5) {
+ulong Q_round(ulong *src, uint base, local ulong *tables) {
     uint b0 = (base +  1) % 16;
     uint b1 = (base +  3) % 16;
     uint b2 = (base +  5) % 16;
@@ -493,19 +540,22 @@ ulong Q_round(ulong *src, uint base, local ulong *t0, local ulong *t1, local ulo
     uint b5 = (base +  2) % 16;
     uint b6 = (base +  4) % 16;
     uint b7 = (base +  6) % 16;
-    return t0[B64_0(src[b0])] ^ t1[B64_1(src[b1])] ^ t2[B64_2(src[b2])] ^ t3[B64_3(src[b3])] ^
-           t4[B64_4(src[b4])] ^ t5[B64_5(src[b5])] ^ T6[B64_6(src[b6])] ^ T7[B64_7(src[b7])];
+    return TL0(B64_0(src[b0])) ^ TL1(B64_1(src[b1])) ^ TL2(B64_2(src[b2])) ^ TL3(B64_3(src[b3])) ^
+           TL4(B64_4(src[b4])) ^ TL5(B64_5(src[b5])) ^ TL6(B64_6(src[b6])) ^ TL7(B64_7(src[b7]));
 }
 
 
 void groestl(ulong *hashOut, local ulong *tables, global uchar *header, global uint *roundCount) {
-    local ulong *t0 = tables + 256 * 0;        local ulong *t1 = tables + 256 * 1;
-    local ulong *t2 = tables + 256 * 2;        local ulong *t3 = tables + 256 * 3;
-    local ulong *t4 = tables + 256 * 4;        local ulong *t5 = tables + 256 * 5;
     for(uint cp = get_local_id(0); cp < 256; cp += get_local_size(0)) {
-        t0[cp] = T0[cp];        t1[cp] = T1[cp];
-        t2[cp] = T2[cp];        t3[cp] = T3[cp];
-        t4[cp] = T4[cp];        t5[cp] = T5[cp];
+#if GROESTL_LDS_TABLES == 6
+        tables[256 * 0 + cp] = T0[cp];        tables[256 * 1 + cp] = T1[cp];
+        tables[256 * 2 + cp] = T2[cp];        tables[256 * 3 + cp] = T3[cp];
+        tables[256 * 4 + cp] = T4[cp];        tables[256 * 5 + cp] = T5[cp];
+#elif GROESTL_LDS_TABLES == 2
+        tables[cp] = T0[cp];        tables[256 + cp] = T4[cp];
+#else
+        tables[cp] = T0[cp];
+#endif
     }
 
     ulong H[16];
@@ -531,14 +581,14 @@ void groestl(ulong *hashOut, local ulong *tables, global uchar *header, global u
     for(int r = 0; r < roundCount[0]; r++) { // PERM_BIG_P(g);
         ulong t[16];
         for(int i = 0; i < 16; i++) g[i] ^= PC64(i << 4, r);
-        for(int i = 0; i < 16; i++) t[i] = P_round(g, i, t0, t1, t2, t3, t4, t5);
+        for(int i = 0; i < 16; i++) t[i] = P_round(g, i, tables);
         #pragma unroll
         for(int i = 0; i < 16; i++) g[i] = t[i];
     }
     for(int r = 0; r < roundCount[1]; r++) { //PERM_BIG_Q(m);
         ulong t[16];
         for(int i = 0; i < 16; i++) m[i] ^= QC64(i << 4, r);
-        for(int i = 0; i < 16; i++) t[i] = Q_round(m, i, t0, t1, t2, t3, t4, t5);
+        for(int i = 0; i < 16; i++) t[i] = Q_round(m, i, tables);
         #pragma unroll
         for(int i = 0; i < 16; i++) m[i] = t[i];
 
@@ -549,7 +599,7 @@ void groestl(ulong *hashOut, local ulong *tables, global uchar *header, global u
     for(int r = 0; r < roundCount[2]; r++) { // PERM_BIG_P(xH);
         ulong t[16];
         for(int i = 0; i < 16; i++) xH[i] ^= PC64(i << 4, r);
-        for(int i = 0; i < 16; i++) t[i] = P_round(xH, i, t0, t1, t2, t3, t4, t5);
+        for(int i = 0; i < 16; i++) t[i] = P_round(xH, i, tables);
         #pragma unroll
         for(int i = 0; i < 16; i++) xH[i] = t[i];
     }
@@ -795,7 +845,7 @@ kernel void grsmyr_monolithic(global uint *found, global uint *wuData, global ui
         ulong quad[8];
         uint dword[16];
     } hash;
-    local ulong tables[256 * 6];
+    local ulong tables[256 * GROESTL_LDS_TABLES];
     groestl(hash.quad, tables, (global uchar*)wuData, roundCount);
     sha256(hash.dword, roundCount[3], roundCount[4]);
     ulong target = (((ulong)dispatchData[1]) << 32) | dispatchData[2]; // watch out for endianess!
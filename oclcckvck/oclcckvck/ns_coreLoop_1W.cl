@@ -9,11 +9,36 @@ After the FastKDF, there's a loop to be executed twice with different parameters
 In the first iteration, Salsa is used. In the second iteration ChaCha.
 
 At a first glance, all those appear to be 4-way... see some notes on that.
+
+LOOKUP_GAP trades memory for computation. Only one state every LOOKUP_GAP iterations is written to the pad buffer, which is therefore
+LOOKUP_GAP times smaller. Missing entries are recomputed by the indirected read starting from the closest previous stored state.
+
+BLOCKMIX_DUAL builds the _dual kernels instead, running the Salsa and ChaCha loops in the same dispatch, each with its own pad.
+Those are dispatched as 2x64 workgroups: the first 64 work items in a group run Salsa, the others ChaCha, on the same 64 hashes.
+Each wavefront (or warp) still executes a single mix function but there are twice as many in flight, which helps small hashCounts.
+
+PAD_LAYOUT selects how the pad buffer is laid out in memory. The pad holds PAD_ENTRIES entries of 4 slices (16 uints each) for every hash.
+- PAD_SLICE_INTERLEAVED (default) puts all the hashes for the same entry and slice together, 16 uints each. Each hash is rotated by its
+  index in the workgroup and the whole slice block is staged in LDS so it goes out with a single async copy. Good for GCN.
+- PAD_HASH_MAJOR keeps all the pad entries of a hash contiguous, written and read directly with 64-byte accesses.
+- PAD_UINT4_STRIDED interleaves hashes every uint4, so consecutive work items access consecutive 16-byte elements.
 */
 
+#if !defined LOOKUP_GAP
+#define LOOKUP_GAP 1
+#endif
+#define PAD_ENTRIES ((128 + LOOKUP_GAP - 1) / LOOKUP_GAP)
 
-#if defined BLOCKMIX_SALSA
-void SliceMixVEC(uint16 *tmp, uint mixRounds) {
+#define PAD_SLICE_INTERLEAVED 0
+#define PAD_HASH_MAJOR 1
+#define PAD_UINT4_STRIDED 2
+#if !defined PAD_LAYOUT
+#define PAD_LAYOUT PAD_SLICE_INTERLEAVED
+#endif
+
+
+#if defined BLOCKMIX_SALSA || defined BLOCKMIX_DUAL
+void SalsaMixVEC(uint16 *tmp, uint mixRounds) {
     // In the beginning, this used a uint[16] and just took for granted the compiler would have
     // figured out it's all about constexpr.
     // It looks like **some** compilers are too lazy on figuring out something is constexpr so I had
@@ -65,8 +90,8 @@ void SliceMixVEC(uint16 *tmp, uint mixRounds) {
 }
 #endif
 
-#if defined BLOCKMIX_CHACHA
-void SliceMixVEC(uint16 *tmp, uint mixRounds) {
+#if defined BLOCKMIX_CHACHA || defined BLOCKMIX_DUAL
+void ChachaMixVEC(uint16 *tmp, uint mixRounds) {
     for(uint loop = 0; loop < mixRounds; loop++) {
         // Here we have some mangling "by column".
         (*tmp).s0 += (*tmp).s4;    (*tmp).sc = rotate((*tmp).sc ^ (*tmp).s0, 16u);
@@ -124,96 +149,160 @@ void SliceMixVEC(uint16 *tmp, uint mixRounds) {
 #endif
 
 
+#if defined BLOCKMIX_DUAL
+#define HASH_LINEAR_ID (get_local_id(0) + get_local_id(1) * get_local_size(0))
+#define CHAIN_INDEX (HASH_LINEAR_ID / 64)
+#define HASH_LOCAL_ID (HASH_LINEAR_ID % 64)
+#define HASH_GROUP_SIZE 64
+#define HASH_GROUP_ID get_group_id(1)
+#define HASH_COUNT get_global_size(1)
+
+void SliceMixVEC(uint16 *tmp, uint mixRounds) {
+    if(CHAIN_INDEX) ChachaMixVEC(tmp, mixRounds); // uniform across the wavefront
+    else SalsaMixVEC(tmp, mixRounds);
+}
+#else
+#define HASH_LOCAL_ID get_local_id(0)
+#define HASH_GROUP_SIZE get_local_size(0)
+#define HASH_GROUP_ID get_group_id(0)
+#define HASH_COUNT get_global_size(0)
+
+#if defined BLOCKMIX_SALSA
+#define SliceMixVEC SalsaMixVEC
+#else
+#define SliceMixVEC ChachaMixVEC
+#endif
+#endif
+
+
 uint16 LoadStateSlice(global const uint *src) {
     uint16 value;
-    value.s0 = src[ 0 * get_local_size(0)];
-    value.s1 = src[ 1 * get_local_size(0)];
-    value.s2 = src[ 2 * get_local_size(0)];
-    value.s3 = src[ 3 * get_local_size(0)];
-    value.s4 = src[ 4 * get_local_size(0)];
-    value.s5 = src[ 5 * get_local_size(0)];
-    value.s6 = src[ 6 * get_local_size(0)];
-    value.s7 = src[ 7 * get_local_size(0)];
-    value.s8 = src[ 8 * get_local_size(0)];
-    value.s9 = src[ 9 * get_local_size(0)];
-    value.sa = src[10 * get_local_size(0)];
-    value.sb = src[11 * get_local_size(0)];
-    value.sc = src[12 * get_local_size(0)];
-    value.sd = src[13 * get_local_size(0)];
-    value.se = src[14 * get_local_size(0)];
-    value.sf = src[15 * get_local_size(0)];
+    value.s0 = src[ 0 * HASH_GROUP_SIZE];
+    value.s1 = src[ 1 * HASH_GROUP_SIZE];
+    value.s2 = src[ 2 * HASH_GROUP_SIZE];
+    value.s3 = src[ 3 * HASH_GROUP_SIZE];
+    value.s4 = src[ 4 * HASH_GROUP_SIZE];
+    value.s5 = src[ 5 * HASH_GROUP_SIZE];
+    value.s6 = src[ 6 * HASH_GROUP_SIZE];
+    value.s7 = src[ 7 * HASH_GROUP_SIZE];
+    value.s8 = src[ 8 * HASH_GROUP_SIZE];
+    value.s9 = src[ 9 * HASH_GROUP_SIZE];
+    value.sa = src[10 * HASH_GROUP_SIZE];
+    value.sb = src[11 * HASH_GROUP_SIZE];
+    value.sc = src[12 * HASH_GROUP_SIZE];
+    value.sd = src[13 * HASH_GROUP_SIZE];
+    value.se = src[14 * HASH_GROUP_SIZE];
+    value.sf = src[15 * HASH_GROUP_SIZE];
     return value;
 }
 
 
 void StoreStateSlice(global uint *dst, const uint16 value) {
-    dst[ 0 * get_local_size(0)] = value.s0;
-    dst[ 1 * get_local_size(0)] = value.s1;
-    dst[ 2 * get_local_size(0)] = value.s2;
-    dst[ 3 * get_local_size(0)] = value.s3;
-    dst[ 4 * get_local_size(0)] = value.s4;
-    dst[ 5 * get_local_size(0)] = value.s5;
-    dst[ 6 * get_local_size(0)] = value.s6;
-    dst[ 7 * get_local_size(0)] = value.s7;
-    dst[ 8 * get_local_size(0)] = value.s8;
-    dst[ 9 * get_local_size(0)] = value.s9;
-    dst[10 * get_local_size(0)] = value.sa;
-    dst[11 * get_local_size(0)] = value.sb;
-    dst[12 * get_local_size(0)] = value.sc;
-    dst[13 * get_local_size(0)] = value.sd;
-    dst[14 * get_local_size(0)] = value.se;
-    dst[15 * get_local_size(0)] = value.sf;
+    dst[ 0 * HASH_GROUP_SIZE] = value.s0;
+    dst[ 1 * HASH_GROUP_SIZE] = value.s1;
+    dst[ 2 * HASH_GROUP_SIZE] = value.s2;
+    dst[ 3 * HASH_GROUP_SIZE] = value.s3;
+    dst[ 4 * HASH_GROUP_SIZE] = value.s4;
+    dst[ 5 * HASH_GROUP_SIZE] = value.s5;
+    dst[ 6 * HASH_GROUP_SIZE] = value.s6;
+    dst[ 7 * HASH_GROUP_SIZE] = value.s7;
+    dst[ 8 * HASH_GROUP_SIZE] = value.s8;
+    dst[ 9 * HASH_GROUP_SIZE] = value.s9;
+    dst[10 * HASH_GROUP_SIZE] = value.sa;
+    dst[11 * HASH_GROUP_SIZE] = value.sb;
+    dst[12 * HASH_GROUP_SIZE] = value.sc;
+    dst[13 * HASH_GROUP_SIZE] = value.sd;
+    dst[14 * HASH_GROUP_SIZE] = value.se;
+    dst[15 * HASH_GROUP_SIZE] = value.sf;
 }
 
 
 uint16 LoadPadSlice(global const uint *src) {
     uint16 value;
-    value.s0 = src[( 0 + get_local_id(0)) % 16];
-    value.s1 = src[( 1 + get_local_id(0)) % 16];
-    value.s2 = src[( 2 + get_local_id(0)) % 16];
-    value.s3 = src[( 3 + get_local_id(0)) % 16];
-    value.s4 = src[( 4 + get_local_id(0)) % 16];
-    value.s5 = src[( 5 + get_local_id(0)) % 16];
-    value.s6 = src[( 6 + get_local_id(0)) % 16];
-    value.s7 = src[( 7 + get_local_id(0)) % 16];
-    value.s8 = src[( 8 + get_local_id(0)) % 16];
-    value.s9 = src[( 9 + get_local_id(0)) % 16];
-    value.sa = src[(10 + get_local_id(0)) % 16];
-    value.sb = src[(11 + get_local_id(0)) % 16];
-    value.sc = src[(12 + get_local_id(0)) % 16];
-    value.sd = src[(13 + get_local_id(0)) % 16];
-    value.se = src[(14 + get_local_id(0)) % 16];
-    value.sf = src[(15 + get_local_id(0)) % 16];
+    value.s0 = src[( 0 + HASH_LOCAL_ID) % 16];
+    value.s1 = src[( 1 + HASH_LOCAL_ID) % 16];
+    value.s2 = src[( 2 + HASH_LOCAL_ID) % 16];
+    value.s3 = src[( 3 + HASH_LOCAL_ID) % 16];
+    value.s4 = src[( 4 + HASH_LOCAL_ID) % 16];
+    value.s5 = src[( 5 + HASH_LOCAL_ID) % 16];
+    value.s6 = src[( 6 + HASH_LOCAL_ID) % 16];
+    value.s7 = src[( 7 + HASH_LOCAL_ID) % 16];
+    value.s8 = src[( 8 + HASH_LOCAL_ID) % 16];
+    value.s9 = src[( 9 + HASH_LOCAL_ID) % 16];
+    value.sa = src[(10 + HASH_LOCAL_ID) % 16];
+    value.sb = src[(11 + HASH_LOCAL_ID) % 16];
+    value.sc = src[(12 + HASH_LOCAL_ID) % 16];
+    value.sd = src[(13 + HASH_LOCAL_ID) % 16];
+    value.se = src[(14 + HASH_LOCAL_ID) % 16];
+    value.sf = src[(15 + HASH_LOCAL_ID) % 16];
     return value;
 }
 
 
 void PreparePadBlock(local uint *dst, const uint16 value) {
-    dst[( 0 + get_local_id(0)) % 16] = value.s0;
-    dst[( 1 + get_local_id(0)) % 16] = value.s1;
-    dst[( 2 + get_local_id(0)) % 16] = value.s2;
-    dst[( 3 + get_local_id(0)) % 16] = value.s3;
-    dst[( 4 + get_local_id(0)) % 16] = value.s4;
-    dst[( 5 + get_local_id(0)) % 16] = value.s5;
-    dst[( 6 + get_local_id(0)) % 16] = value.s6;
-    dst[( 7 + get_local_id(0)) % 16] = value.s7;
-    dst[( 8 + get_local_id(0)) % 16] = value.s8;
-    dst[( 9 + get_local_id(0)) % 16] = value.s9;
-    dst[(10 + get_local_id(0)) % 16] = value.sa;
-    dst[(11 + get_local_id(0)) % 16] = value.sb;
-    dst[(12 + get_local_id(0)) % 16] = value.sc;
-    dst[(13 + get_local_id(0)) % 16] = value.sd;
-    dst[(14 + get_local_id(0)) % 16] = value.se;
-    dst[(15 + get_local_id(0)) % 16] = value.sf;
+    dst[( 0 + HASH_LOCAL_ID) % 16] = value.s0;
+    dst[( 1 + HASH_LOCAL_ID) % 16] = value.s1;
+    dst[( 2 + HASH_LOCAL_ID) % 16] = value.s2;
+    dst[( 3 + HASH_LOCAL_ID) % 16] = value.s3;
+    dst[( 4 + HASH_LOCAL_ID) % 16] = value.s4;
+    dst[( 5 + HASH_LOCAL_ID) % 16] = value.s5;
+    dst[( 6 + HASH_LOCAL_ID) % 16] = value.s6;
+    dst[( 7 + HASH_LOCAL_ID) % 16] = value.s7;
+    dst[( 8 + HASH_LOCAL_ID) % 16] = value.s8;
+    dst[( 9 + HASH_LOCAL_ID) % 16] = value.s9;
+    dst[(10 + HASH_LOCAL_ID) % 16] = value.sa;
+    dst[(11 + HASH_LOCAL_ID) % 16] = value.sb;
+    dst[(12 + HASH_LOCAL_ID) % 16] = value.sc;
+    dst[(13 + HASH_LOCAL_ID) % 16] = value.sd;
+    dst[(14 + HASH_LOCAL_ID) % 16] = value.se;
+    dst[(15 + HASH_LOCAL_ID) % 16] = value.sf;
+}
+
+
+/* Pad buffers are offset to the hash being computed by this amount of uints, then pad slices are accessed by the functions below.
+PAD_SLICE_INTERLEAVED sequential writes don't use StorePadSlice, they go through PreparePadBlock. */
+#define PAD_HASH_OFFSET(slot) ((slot) * (PAD_LAYOUT == PAD_HASH_MAJOR? PAD_ENTRIES * 64 : (PAD_LAYOUT == PAD_UINT4_STRIDED? 4 : 16)))
+
+
+uint16 LoadPadEntrySlice(global const uint *padBuffer, const uint entry, const uint slice) {
+#if PAD_LAYOUT == PAD_HASH_MAJOR
+    return vload16(0, padBuffer + (entry * 4 + slice) * 16);
+#elif PAD_LAYOUT == PAD_UINT4_STRIDED
+    global const uint *src = padBuffer + (entry * 4 + slice) * 16 * HASH_COUNT;
+    uint16 value;
+    value.s0123 = vload4(0 * HASH_COUNT, src);
+    value.s4567 = vload4(1 * HASH_COUNT, src);
+    value.s89ab = vload4(2 * HASH_COUNT, src);
+    value.scdef = vload4(3 * HASH_COUNT, src);
+    return value;
+#else
+    return LoadPadSlice(padBuffer + (entry * 4 + slice) * 16 * HASH_COUNT);
+#endif
 }
 
 
+#if PAD_LAYOUT != PAD_SLICE_INTERLEAVED
+void StorePadSlice(global uint *padBuffer, const uint entry, const uint slice, const uint16 value) {
+#if PAD_LAYOUT == PAD_HASH_MAJOR
+    vstore16(value, 0, padBuffer + (entry * 4 + slice) * 16);
+#else
+    global uint *dst = padBuffer + (entry * 4 + slice) * 16 * HASH_COUNT;
+    vstore4(value.s0123, 0 * HASH_COUNT, dst);
+    vstore4(value.s4567, 1 * HASH_COUNT, dst);
+    vstore4(value.s89ab, 2 * HASH_COUNT, dst);
+    vstore4(value.scdef, 3 * HASH_COUNT, dst);
+#endif
+}
+#endif
+
+
 static constant uint slicePerm[2][4] = {
     { 0, 1, 2, 3 },
     { 0, 2, 1, 3 }
 };
 
 
+#if !defined BLOCKMIX_DUAL
 __attribute__((reqd_work_group_size(64, 1, 1)))
 kernel void sequentialWrite_1way(global uint *xin, global uint *padBuffer,
  const uint iterations, // 128
@@ -224,64 +313,175 @@ kernel void sequentialWrite_1way(global uint *xin, global uint *padBuffer,
     // Leave xin as is as it has to be reused next loop.
     // Copy to statex instead. It's super easy: they are the same thing.
     const uint slot = get_global_id(0) - get_global_offset(0);
-    xin    += get_group_id(0) * get_local_size(0) * 64;
-    statex += get_group_id(0) * get_local_size(0) * 64;
-    for(uint cp = 0; cp < 64; cp++) statex[cp * get_local_size(0) + get_local_id(0)] = xin[cp * get_local_size(0) + get_local_id(0)];
-    padBuffer += get_group_id(0) * get_local_size(0) * 16;
+    xin    += HASH_GROUP_ID * HASH_GROUP_SIZE * 64;
+    statex += HASH_GROUP_ID * HASH_GROUP_SIZE * 64;
+    for(uint cp = 0; cp < 64; cp++) statex[cp * HASH_GROUP_SIZE + HASH_LOCAL_ID] = xin[cp * HASH_GROUP_SIZE + HASH_LOCAL_ID];
+#if PAD_LAYOUT == PAD_SLICE_INTERLEAVED
+    padBuffer += HASH_GROUP_ID * HASH_GROUP_SIZE * 16;
     local uint lds[16 * 64]; // one slice at time, staggered 1 uint each hash, see PreparePadBlock
-    local uint *mySlice = lds + get_local_id(0) * 16;
+    local uint *mySlice = lds + HASH_LOCAL_ID * 16;
+#else
+    padBuffer += PAD_HASH_OFFSET(slot);
+#endif
     // updated state from previous slice iteration, this starts with slice[3]
-    xin    += get_local_id(0);
-    statex += get_local_id(0);
-    uint16 mangle = LoadStateSlice(xin + 16 * 3 * get_local_size(0));
+    xin    += HASH_LOCAL_ID;
+    statex += HASH_LOCAL_ID;
+    uint16 mangle = LoadStateSlice(xin + 16 * 3 * HASH_GROUP_SIZE);
     for(uint loop = 0; loop < iterations; loop++) {
         barrier(CLK_GLOBAL_MEM_FENCE);
+        const bool store = (loop % LOOKUP_GAP) == 0; // uniform across the workgroup, so it's ok to have async copies there
         for(uint slice = 0; slice < 4; slice++) {
             barrier(CLK_LOCAL_MEM_FENCE);
             // Load up state to be used from state buffer and keep it around. In legacy kernels, this is left ^= right. Also goes to padbuffer.
-            global uint *currentSlice = statex + slicePerm[loop % 2][slice] * 16 * get_local_size(0);
+            global uint *currentSlice = statex + slicePerm[loop % 2][slice] * 16 * HASH_GROUP_SIZE;
             const uint16 leftSlice = LoadStateSlice(currentSlice);
-            PreparePadBlock(mySlice, leftSlice);
-
-            event_t padOut = async_work_group_copy(padBuffer, lds, 16 * 64, 0);
-            //StorePadSlice(padBuffer, leftSlice);
-            padBuffer += 16 * get_global_size(0);
+#if PAD_LAYOUT == PAD_SLICE_INTERLEAVED
+            event_t padOut;
+            if(store) {
+                PreparePadBlock(mySlice, leftSlice);
+                padOut = async_work_group_copy(padBuffer, lds, 16 * 64, 0);
+                padBuffer += 16 * HASH_COUNT;
+            }
+#else
+            if(store) StorePadSlice(padBuffer, loop / LOOKUP_GAP, slice, leftSlice);
+#endif
             // Input to slicemix is xor of those values. Keep them around as we need to add them later.
             mangle ^= leftSlice;
             const uint16 prev = mangle;
             SliceMixVEC(&mangle, 10);
             mangle += prev;
             StoreStateSlice(currentSlice, mangle);
-            wait_group_events(1, &padOut);
+#if PAD_LAYOUT == PAD_SLICE_INTERLEAVED
+            if(store) wait_group_events(1, &padOut);
+#endif
         }
     }
 }
-
-
-__attribute__((reqd_work_group_size(64, 1, 1)))
-kernel void indirectedRead_1way(global uint *xio, global const uint *padBuffer,
+#else
+__attribute__((reqd_work_group_size(2, 64, 1)))
+kernel void sequentialWrite_dual(global uint *xin, global uint *padSalsa, global uint *padChacha,
  const uint iterations, // 128
- const uint xslices,
- const uint mixRounds // 10
+ const uint xslices, // 4
+ const uint mixRounds, // 10
+ global uint *xo, global uint *xi
 ) {
-    const uint slot = get_global_id(0) - get_global_offset(0);
-    xio += get_group_id(0) * get_local_size(0) * 64;
-    xio += get_local_id(0);
-    padBuffer += 16 * slot;
+    // Same as sequentialWrite_1way, except each half of the workgroup goes to a different state and pad.
+    global uint *statex = CHAIN_INDEX? xi : xo;
+    xin    += HASH_GROUP_ID * HASH_GROUP_SIZE * 64;
+    statex += HASH_GROUP_ID * HASH_GROUP_SIZE * 64;
+    for(uint cp = 0; cp < 64; cp++) statex[cp * HASH_GROUP_SIZE + HASH_LOCAL_ID] = xin[cp * HASH_GROUP_SIZE + HASH_LOCAL_ID];
+#if PAD_LAYOUT == PAD_SLICE_INTERLEAVED
+    padSalsa  += HASH_GROUP_ID * HASH_GROUP_SIZE * 16;
+    padChacha += HASH_GROUP_ID * HASH_GROUP_SIZE * 16;
+    local uint lds[2][16 * 64]; // one block per chain, see PreparePadBlock
+    local uint *mySlice = lds[CHAIN_INDEX] + HASH_LOCAL_ID * 16;
+#else
+    global uint *padBuffer = (CHAIN_INDEX? padChacha : padSalsa) + PAD_HASH_OFFSET(HASH_GROUP_ID * HASH_GROUP_SIZE + HASH_LOCAL_ID);
+#endif
+    xin    += HASH_LOCAL_ID;
+    statex += HASH_LOCAL_ID;
+    uint16 mangle = LoadStateSlice(xin + 16 * 3 * HASH_GROUP_SIZE);
+    for(uint loop = 0; loop < iterations; loop++) {
+        barrier(CLK_GLOBAL_MEM_FENCE);
+        const bool store = (loop % LOOKUP_GAP) == 0;
+        for(uint slice = 0; slice < 4; slice++) {
+            barrier(CLK_LOCAL_MEM_FENCE);
+            global uint *currentSlice = statex + slicePerm[loop % 2][slice] * 16 * HASH_GROUP_SIZE;
+            const uint16 leftSlice = LoadStateSlice(currentSlice);
+#if PAD_LAYOUT == PAD_SLICE_INTERLEAVED
+            event_t padOut;
+            if(store) {
+                PreparePadBlock(mySlice, leftSlice);
+                barrier(CLK_LOCAL_MEM_FENCE); // the copies below read the other half of the workgroup as well
+                padOut = async_work_group_copy(padSalsa, lds[0], 16 * 64, 0);
+                padOut = async_work_group_copy(padChacha, lds[1], 16 * 64, padOut);
+                padSalsa  += 16 * HASH_COUNT;
+                padChacha += 16 * HASH_COUNT;
+            }
+#else
+            if(store) StorePadSlice(padBuffer, loop / LOOKUP_GAP, slice, leftSlice);
+#endif
+            mangle ^= leftSlice;
+            const uint16 prev = mangle;
+            SliceMixVEC(&mangle, 10);
+            mangle += prev;
+            StoreStateSlice(currentSlice, mangle);
+#if PAD_LAYOUT == PAD_SLICE_INTERLEAVED
+            if(store) wait_group_events(1, &padOut);
+#endif
+        }
+    }
+}
+#endif
+
+
+#if LOOKUP_GAP > 1
+//! One slice of a sequential write iteration, minus the pad store.
+void RecomputeSlice(uint16 *mangle, uint16 *slice) {
+    *mangle ^= *slice;
+    const uint16 prev = *mangle;
+    SliceMixVEC(mangle, 10);
+    *mangle += prev;
+    *slice = *mangle;
+}
+
+
+/* The pad entry for iteration index was not necessarily stored by sequentialWrite_1way.
+Load the closest previous one and run sequential write iterations again, without writing anything, up to the requested one.
+Slices are returned in pad order, so they can be used exactly as they would be loaded from the pad buffer.
+State slices are named values rather than an array: slicePerm indexed by the loop parity is only known at runtime and
+would put the whole state in scratch memory. Parity only swaps slices 1 and 2 so they are selected instead. */
+void RecomputePadEntry(uint16 entry[4], global const uint *padBuffer, const uint index) {
+    const uint first = (index / LOOKUP_GAP) * LOOKUP_GAP;
+    const bool firstOdd = first % 2;
+    uint16 state0 = LoadPadEntrySlice(padBuffer, index / LOOKUP_GAP, 0);
+    uint16 state1 = LoadPadEntrySlice(padBuffer, index / LOOKUP_GAP, firstOdd? 2 : 1);
+    uint16 state2 = LoadPadEntrySlice(padBuffer, index / LOOKUP_GAP, firstOdd? 1 : 2);
+    uint16 state3 = LoadPadEntrySlice(padBuffer, index / LOOKUP_GAP, 3);
+    uint16 mangle = state3;
+    for(uint loop = first; loop < index; loop++) {
+        const bool odd = loop % 2;
+        uint16 second = odd? state2 : state1;
+        uint16 third = odd? state1 : state2;
+        RecomputeSlice(&mangle, &state0);
+        RecomputeSlice(&mangle, &second);
+        RecomputeSlice(&mangle, &third);
+        RecomputeSlice(&mangle, &state3);
+        state1 = odd? third : second;
+        state2 = odd? second : third;
+    }
+    const bool odd = index % 2;
+    entry[0] = state0;
+    entry[1] = odd? state2 : state1;
+    entry[2] = odd? state1 : state2;
+    entry[3] = state3;
+}
+#define PAD_SLICE(index) padEntry[index]
+#else
+#define PAD_SLICE(index) LoadPadEntrySlice(padBuffer, indirected, index)
+#endif
+
+
+/* Indirected read loop for a single hash. xio and padBuffer are already offset to the hash being computed. */
+void IndirectedRead(global uint *xio, global const uint *padBuffer, const uint iterations) {
     // updated state from previous slice iteration, this starts with slice[3]
-    uint16 mangle = LoadStateSlice(xio + 16 * 3 * get_local_size(0));
+    uint16 mangle = LoadStateSlice(xio + 16 * 3 * HASH_GROUP_SIZE);
     for(uint loop = 0; loop < iterations; loop++) {
         barrier(CLK_GLOBAL_MEM_FENCE);
-        const uint indirected = xio[48 * get_local_size(0)] % 128;
-        global const uint *padSlices = padBuffer + indirected * 64 * get_global_size(0);
+        const uint indirected = xio[48 * HASH_GROUP_SIZE] % 128;
+#if LOOKUP_GAP > 1
+        uint16 padEntry[4];
+        RecomputePadEntry(padEntry, padBuffer, indirected);
+        #pragma unroll // padEntry must be indexed by constants to stay in registers
+#endif
         for(uint slice = 0; slice < 4; slice++) {
             // First of all, load state and xor it with something from the pad buffer.
             // In general, we need a single XOR per iteration, except for the first slice which need one extra slice
             // as it comes from a previous iteration.
-            if(slice == 0) mangle ^= LoadPadSlice(padSlices + 3 * 16 * get_global_size(0));
-            global uint *currSlice = xio + slicePerm[loop % 2][slice] * 16 * get_local_size(0);
+            if(slice == 0) mangle ^= PAD_SLICE(3);
+            global uint *currSlice = xio + slicePerm[loop % 2][slice] * 16 * HASH_GROUP_SIZE;
             mangle ^= LoadStateSlice(currSlice);
-            mangle ^= LoadPadSlice(padSlices + slice * 16 * get_global_size(0));
+            mangle ^= PAD_SLICE(slice);
             const uint16 prev = mangle;
             SliceMixVEC(&mangle, 10);
             mangle += prev;
@@ -289,3 +489,34 @@ kernel void indirectedRead_1way(global uint *xio, global const uint *padBuffer,
         }
     }
 }
+
+
+#if !defined BLOCKMIX_DUAL
+__attribute__((reqd_work_group_size(64, 1, 1)))
+kernel void indirectedRead_1way(global uint *xio, global const uint *padBuffer,
+ const uint iterations, // 128
+ const uint xslices,
+ const uint mixRounds // 10
+) {
+    const uint slot = get_global_id(0) - get_global_offset(0);
+    xio += HASH_GROUP_ID * HASH_GROUP_SIZE * 64;
+    xio += HASH_LOCAL_ID;
+    padBuffer += PAD_HASH_OFFSET(slot);
+    IndirectedRead(xio, padBuffer, iterations);
+}
+#else
+__attribute__((reqd_work_group_size(2, 64, 1)))
+kernel void indirectedRead_dual(global uint *xo, global uint *xi, global const uint *padSalsa, global const uint *padChacha,
+ const uint iterations, // 128
+ const uint xslices,
+ const uint mixRounds // 10
+) {
+    const uint slot = HASH_GROUP_ID * HASH_GROUP_SIZE + HASH_LOCAL_ID;
+    global uint *xio = CHAIN_INDEX? xi : xo;
+    global const uint *padBuffer = CHAIN_INDEX? padChacha : padSalsa;
+    xio += HASH_GROUP_ID * HASH_GROUP_SIZE * 64;
+    xio += HASH_LOCAL_ID;
+    padBuffer += PAD_HASH_OFFSET(slot);
+    IndirectedRead(xio, padBuffer, iterations);
+}
+#endif
@@ -10,8 +10,10 @@ What happened is that many people couldn't get M8M to hash correctly and I could
 The current (yet-to-be-published) M8M source allows me to detect HW errors, but this does not solve the problem of giving users a tool to assess compatibility.
 
 This program runs M8M kernels with a known input obtained from a legacy miner. The results are checked against reference.
-This program only goal is to assess validity/compatibility, not performance. It is in that regard much more focused than the tool used internally during M8M development,
-which (arguably) does both and will hopefully be superceded by this one. */
+Assessing validity/compatibility is still the first goal and what runs by default. Since results must be right before speed matters,
+performance work is done here as well: after validation a run can be benchmarked, autotuned, profiled command by command, traced
+on a timeline or soaked for hours, and results go to a history file so kernel changes can be compared, see main for the switches.
+It is meant to supersede the tool used internally during M8M development, which did both. */
 #include <CL/cl.h>
 #include <chrono>
 #include <sstream>
@@ -19,62 +21,71 @@ which (arguably) does both and will hopefully be superceded by this one. */
 #include <iostream>
 #include <string>
 #include <fstream>
+#include <iomanip>
 #include "AbstractAlgorithm.h"
 #include "StopWaitDispatcher.h"
+#include "Benchmark.h"
+#include "Autotune.h"
+#include "ResultsHistory.h"
+#include "Soak.h"
 #include "misc.h"
 #include "StepTest/misc.h"
 
 
-#if defined(TEST_QUBIT_FIVESTEPS)
 #include "TestData/Qubit.h"
-#include "AlgoImplementations/QubitFiveStepsCL12.h"
-#endif
-
-#if defined(TEST_MYRGRS_MONOLITHIC)
 #include "TestData/MYRGRS.h"
-#include "AlgoImplementations/MYRGRSMonolithicCL12.h"
-#endif
-
-#if defined(TEST_FRESH_WARM)
 #include "TestData/Fresh.h"
-#include "AlgoImplementations/FreshWarmCL12.h"
-#endif
-
-#if defined(TEST_NEOSCRYPT_SMOOTH)
 #include "TestData/Neoscrypt.h"
+#include "TestData/CPUMiners.h"
+#include "AlgoImplementations/QubitFiveStepsCL12.h"
+#include "AlgoImplementations/MYRGRSMonolithicCL12.h"
+#include "AlgoImplementations/FreshWarmCL12.h"
 #include "AlgoImplementations/NeoscryptSmoothCL12.h"
-#endif
-
-#if defined(TEST_LUFFA_1W_HEAD)
+#include "AlgoImplementations/NeoscryptDualChainCL12.h"
 #include "StepTest/Luffa_1W.h"
-#endif
-
-#if defined(TEST_CUBEHASH_2W_CHAINED)
 #include "StepTest/CubeHash_2W.h"
-#endif
-
-#if defined(TEST_SHAVITE3_1W_CHAINED)
 #include "StepTest/Shavite3_1W.h"
-#endif
-
-#if defined(TEST_SIMD_16W_CHAINED)
 #include "StepTest/SIMD_16W.h"
-#endif
-
-#if defined(TEST_ECHO_8W_TAIL)
 #include "StepTest/ECHO_8W.h"
-#endif
-
-#if defined(TEST_NS_FIRSTKDF_4W_HEAD) || defined(TEST_NS_LASTKDF_4W_TAIL)
 #include "StepTest/NS_KDFs_4W.h"
-#endif
-
-#if defined(TEST_NS_SW_SALSA) || defined(TEST_NS_IR_SALSA) || defined(TEST_NS_SW_CHACHA) || defined(TEST_NS_IR_CHACHA)
 #include "StepTest/NS_CoreLoops.h"
-#endif
+#include "../Common/hashing.h"
+#include "../Common/AREN/SerializationBuffers.h"
+#include <memory>
+#include <algorithm>
+#include <functional>
+
+extern "C" {
+#include "../SPH/sph_echo.h"
+#include "../SPH/sph_shavite.h"
+#include "../SPH/sph_luffa.h"
+#include "../SPH/sph_cubehash.h"
+#include "../SPH/sph_simd.h"
+#include "../SPH/sph_groestl.h"
+#include "../SPH/sph_aesni.h"
+#include "../SPH/sph_batch.h"
+}
+#include <intrin.h>
 
 bool opt_verbose = true;
 bool opt_showTestTime = true;
+bool opt_goldenDigests = true; //!< skip checking step results hash by hash when they match the results of a previous, validated run
+const char *opt_goldenDigestsFile = "goldenDigests.txt";
+stepTest::Sampling opt_sampling; //!< for example stepTest::Sampling::Confidence(.001, .99) to check a few thousand hashes only
+bool opt_benchmark = false; //!< after validating, time repeated dispatches of the same algorithm, see Benchmark.h
+asizei opt_benchWarmUp = 4;
+asizei opt_benchRepetitions = 32;
+asizei opt_wavesPerCU = 40; //!< wavefronts a compute unit keeps in flight, for the occupancy estimates printed with benchmarks. 40 is GCN.
+bool opt_profileCommands = false; //!< time each command on the device and print a breakdown for each test run, including benchmark dispatches, --profile
+bool opt_trace = false; //!< write a chrome://tracing timeline of each test run, see Trace.h, --trace
+const char *opt_traceFile = nullptr; //!< with opt_trace, a single timeline of the whole program run goes there instead, --trace=file
+bool opt_autotune = false; //!< sweep concurrency of algorithms not in opt_tuningFile for this device and store the best, see Autotune.h, also PrintFastest
+const char *opt_tuningFile = "tuning.txt"; //!< algorithms found there run with the tuned concurrency instead of the one given to Dispatch
+bool opt_explicitConcurrency = false; //!< --concurrency given: tests run with it, tuned concurrencies are neither used nor searched
+AutotuneSweep opt_autotuneSweep;
+const char *opt_historyFile = "results.jsonl"; //!< every test and benchmark run appends a RunRecord there, nullptr to disable
+asizei opt_soakMinutes = 60; //!< how long SOAK_* tests keep the devices busy, see Soak
+asizei opt_soakReportSeconds = 60;
 
 
 struct Device {
@@ -89,6 +100,47 @@ struct Platform {
 };
 
 
+/*! Everything this program can run. Tests register themselves with REGISTERED_TEST so the command line can select them by name,
+see main. Host tests run first, then step tests, then algorithm tests, each kind in registration order.
+Only tests checking results run by default. Host benchmarks and soaks are OPTIONAL_TEST, so they take time only when asked for. */
+enum class TestKind {
+    host, //!< CPU only, concurrency and devices are meaningless
+    step,
+    algo
+};
+
+struct RegisteredTest {
+    typedef std::function<bool(const std::vector<Platform> &plats, const std::vector<cl_context> &platContext, asizei concurrency)> Run;
+    std::string name;
+    TestKind kind;
+    asizei concurrency; //!< used when not given on the command line
+    bool byDefault; //!< run when no test is selected on the command line
+    Run run; //!< returns false or throws std::string if something failed
+};
+
+std::vector<RegisteredTest>& Registry() {
+    static std::vector<RegisteredTest> tests;
+    return tests;
+}
+
+struct RegisterTest {
+    RegisterTest(const char *name, TestKind kind, asizei concurrency, bool byDefault, RegisteredTest::Run run) {
+        RegisteredTest test = { name, kind, concurrency, byDefault, run };
+        Registry().push_back(test);
+    }
+};
+
+#define REGISTER_TEST_IMPL(NAME, KIND, CONCURRENCY, BY_DEFAULT) \
+    static bool Test_##NAME(const std::vector<Platform> &plats, const std::vector<cl_context> &platContext, asizei concurrency); \
+    static RegisterTest register_##NAME(#NAME, TestKind::KIND, CONCURRENCY, BY_DEFAULT, Test_##NAME); \
+    static bool Test_##NAME(const std::vector<Platform> &plats, const std::vector<cl_context> &platContext, asizei concurrency)
+
+//! Defines a test function, bool(plats, platContext, concurrency), and registers it as NAME.
+#define REGISTERED_TEST(NAME, KIND, CONCURRENCY) REGISTER_TEST_IMPL(NAME, KIND, CONCURRENCY, true)
+//! Same as REGISTERED_TEST but only runs when selected by name.
+#define OPTIONAL_TEST(NAME, KIND, CONCURRENCY) REGISTER_TEST_IMPL(NAME, KIND, CONCURRENCY, false)
+
+
 std::vector<Platform> EnumeratePlatforms() {
     std::vector<cl_platform_id> plats;
     cl_uint avail = 0;
@@ -201,6 +253,38 @@ std::string Header(const std::vector<Platform> &plats, asizei plat, asizei dev)
 }
 
 
+//! Who is running what: the fields of a RunRecord shared by all the runs of algo on a device.
+RunRecord Identify(const std::vector<Platform> &plats, asizei plat, asizei dev, const AbstractAlgorithm &algo) {
+    std::vector<char> buff;
+    auto platform(plats[plat].clid);
+    auto device(plats[plat].devices[dev].clid);
+    auto getCLPlatProp = [&buff, platform](cl_platform_info what) -> std::string {
+        asizei required = 0;
+        clGetPlatformInfo(platform, what, 0, NULL, &required);
+        buff.resize(required + 1);
+        if(clGetPlatformInfo(platform, what, buff.size(), buff.data(), NULL) != CL_SUCCESS) return "<ERROR>";
+        return std::string(buff.data());
+    };
+    auto getCLDevPropSTRING = [&buff, device](cl_device_info what) -> std::string {
+        asizei required = 0;
+        clGetDeviceInfo(device, what, 0, NULL, &required);
+        buff.resize(required + 1);
+        if(clGetDeviceInfo(device, what, buff.size(), buff.data(), NULL) != CL_SUCCESS) return "<ERROR>";
+        return std::string(buff.data());
+    };
+    RunRecord ret;
+    ret.platform = getCLPlatProp(CL_PLATFORM_NAME);
+    ret.device = getCLDevPropSTRING(CL_DEVICE_NAME);
+    ret.driver = getCLDevPropSTRING(CL_DRIVER_VERSION);
+    ret.algorithm = algo.identifier.algorithm;
+    ret.implementation = algo.identifier.implementation;
+    ret.version = algo.identifier.version;
+    ret.versioning = algo.GetVersioningHash();
+    ret.concurrency = algo.hashCount;
+    return ret;
+}
+
+
 void Whoops(std::ofstream &errorLog, const std::string &filename, const char *msg) {
     if(errorLog.is_open() == false) {
         std::string fname(filename.c_str());
@@ -212,63 +296,197 @@ void Whoops(std::ofstream &errorLog, const std::string &filename, const char *ms
 }
 
 
-template<typename TestData, typename TestSubject>
-void Dispatch(const std::vector<Platform> &plats, const std::vector<cl_context> &platContext, asizei concurrency) {
+/*! For each kernel, what it takes from the device and the resulting occupancy (see KernelOccupancy).
+Work groups wasting lanes or too big for the kernel are flagged. */
+void PrintKernels(const std::vector<AbstractAlgorithm::KernelDesc> &kernels, cl_ulong deviceLDS) {
+    const auto flags(std::cout.flags());
+    const auto precision(std::cout.precision());
+    for(const auto &kernel : kernels) {
+        const KernelOccupancy occ(kernel, deviceLDS, opt_wavesPerCU);
+        std::cout<<"  "<<std::setw(40)<<std::left<<kernel.name<<std::right<<" wg="<<kernel.wgs[0];
+        for(auint dim = 1; dim < kernel.dimensionality; dim++) std::cout<<'x'<<kernel.wgs[dim];
+        std::cout<<" lds="<<kernel.localBytes<<" private="<<kernel.privateBytes<<" max wg="<<kernel.maxWorkGroupSize<<", ";
+        std::cout<<occ.wavesPerGroup<<" waves of "<<kernel.preferredMultiple<<", "<<occ.groupsPerCU<<" groups/CU ("<<(occ.ldsLimited? "LDS" : "waves")<<" bound)";
+        std::cout<<std::fixed<<std::setprecision(0)<<", occupancy "<<occ.occupancy * 100<<'%';
+        if(occ.laneUse < 1) std::cout<<", WASTES "<<(1 - occ.laneUse) * 100<<"% LANES";
+        if(!occ.fits) std::cout<<", WORK GROUP TOO BIG";
+        std::cout<<std::endl;
+        std::cout.flags(flags);
+        std::cout.precision(precision);
+    }
+}
+
+
+/*! Benchmark the algorithm driven by dispatcher, then PrintKernels. The benchmark is appended to opt_historyFile,
+identity being the result of Identify. */
+void PrintBenchmark(StopWaitDispatcher &dispatcher, RunRecord identity) {
+    const auto stats(Benchmark(dispatcher, opt_benchWarmUp, opt_benchRepetitions));
+    std::cout<<"  bench: "<<stats.Describe()<<std::endl;
+    if(opt_historyFile) {
+        identity.kind = "benchmark";
+        identity.hashCount = stats.hashCount * stats.latency.size();
+        identity.ms = stats.Mean() * stats.latency.size();
+        identity.hashesPerSecond = stats.HashesPerSecond();
+        identity.p50 = stats.Percentile(50);
+        identity.p95 = stats.Percentile(95);
+        identity.p99 = stats.Percentile(99);
+        AppendRecord(opt_historyFile, identity);
+    }
+    const cl_ulong deviceLDS = GetCLDevProp<cl_ulong>(CL_DEVICE_LOCAL_MEM_SIZE, dispatcher.algo.device);
+    const cl_uint computeUnits = GetCLDevProp<cl_uint>(CL_DEVICE_MAX_COMPUTE_UNITS, dispatcher.algo.device);
+    std::cout<<"  "<<computeUnits<<" compute units, "<<deviceLDS<<" LDS bytes each, "<<opt_wavesPerCU<<" waves each assumed"<<std::endl;
+    PrintKernels(dispatcher.algo.DescribeKernels(), deviceLDS);
+}
+
+
+/*! Device time taken by each command of a profiling dispatcher, averaged over all the dispatches whose results have been pulled out.
+Commands still in flight are completed first so step tests, which do not pull out results, get accounted as well. */
+void PrintProfile(StopWaitDispatcher &dispatcher) {
+    DrainDispatcher(dispatcher);
+    const auto &profile(dispatcher.GetProfile());
+    const aulong hashes = dispatcher.GetProfiledHashes();
+    aulong total = 0;
+    for(const auto &cmd : profile) total += cmd.ns;
+    if(!hashes || !total) return;
+    const auto flags(std::cout.flags());
+    const auto precision(std::cout.precision());
+    std::cout<<"  "<<std::setw(40)<<std::left<<"command"<<std::right<<std::setw(12)<<"ns/hash"<<std::setw(8)<<"%"<<std::endl;
+    for(const auto &cmd : profile) {
+        std::cout<<"  "<<std::setw(40)<<std::left<<cmd.name<<std::right<<std::fixed<<std::setprecision(3)<<std::setw(12)<<double(cmd.ns) / hashes;
+        std::cout<<std::setprecision(1)<<std::setw(8)<<cmd.ns * 100.0 / total<<std::endl;
+    }
+    std::cout<<"  "<<std::setw(40)<<std::left<<"total"<<std::right<<std::setprecision(3)<<std::setw(12)<<double(total) / hashes<<std::endl;
+    std::cout.flags(flags);
+    std::cout.precision(precision);
+}
+
+
+/*! A tunable to be replaced by the variant PrintFastest found to be the fastest for each device, see Resolve. what is the name given
+to PrintFastest, given is used on devices not benchmarked yet. */
+template<typename Variant>
+struct Pick {
+    const char *what;
+    Variant given;
+};
+
+template<typename Variant>
+Pick<Variant> PickOr(const char *what, Variant given) {
+    Pick<Variant> ret;
+    ret.what = what;
+    ret.given = given;
+    return ret;
+}
+
+template<typename Value>
+std::string PickName(Value value) { return std::to_string(value); }
+inline std::string PickName(algoImplementations::AESTablesSource value) { return GetName(value); }
+inline std::string PickName(algoImplementations::GroestlTables value) { return GetName(value); }
+inline std::string PickName(algoImplementations::NeoscryptPadLayout value) { return GetName(value); }
+
+
+//! Tunables which are not a Pick go to the ctor as they are.
+template<typename Value>
+Value Resolve(const TuningProfiles &tuning, cl_device_id dev, const std::string &where, Value value) { return value; }
+
+//! Variant stored in tuning for the device or what pick was given. Telling it every time makes runs on different devices comparable.
+template<typename Variant>
+Variant Resolve(const TuningProfiles &tuning, cl_device_id dev, const std::string &where, Pick<Variant> pick) {
+    auint value = 0;
+    if(!tuning.FindPick(value, dev, pick.what) || PickName(Variant(value)) == "<unknown>") return pick.given;
+    std::cout<<where<<' '<<pick.what<<": "<<PickName(Variant(value))<<", picked by benchmark"<<std::endl;
+    return Variant(value);
+}
+
+
+/*! Runs TestData on a device, tunables are already resolved. */
+template<typename TestData, typename TestSubject, typename... Tunables>
+void DispatchOn(const std::vector<Platform> &plats, const std::vector<cl_context> &platContext, unsigned p, unsigned d, std::ofstream &errorLog, TuningProfiles &tuning, asizei defaultConcurrency, Tunables... tunables) {
+    asizei concurrency = defaultConcurrency;
+    if(!opt_explicitConcurrency) concurrency = TunedConcurrency<TestData, TestSubject>(tuning, opt_autotune, opt_autotuneSweep, platContext[p], plats[p].devices[d].clid, defaultConcurrency, tunables...);
+    TestSubject imp(platContext[p], plats[p].devices[d].clid, concurrency, tunables...);
+    if(concurrency != defaultConcurrency) {
+        std::cout<<"plat"<<p<<".dev"<<d<<' '<<imp.identifier.Presentation()<<": tuned concurrency "<<concurrency;
+        std::cout<<" instead of "<<defaultConcurrency<<std::endl;
+    }
+    trace::Session traceSession(opt_traceFile? std::string() : 'p' + std::to_string(p) + 'd' + std::to_string(d) + '-' + imp.identifier.Presentation() + ".trace.json");
+    StopWaitDispatcher dispatcher(imp, opt_profileCommands || opt_trace);
+    auto presentation(imp.identifier.Presentation());
+    std::string hexSign;
+    auto filename = [p, d, &presentation, &hexSign]() -> std::string {
+        std::string ret('p' + std::to_string(p) + 'd' + std::to_string(d) + '-' + presentation);
+        if(hexSign.length()) ret += hexSign;
+        else ret += "failed initialization";
+        return ret + ".txt";
+    };
+    try {
+        auto errors(imp.Init(nullptr, dispatcher.AsValueProvider(), ""));
+        hexSign = imp.GetVersioningHash()? Hex(imp.GetVersioningHash()) : std::string("-failed_to_init");
+        if(errors.size()) {
+            std::string meh;
+            for(auto err : errors) meh += err + "\n\n";
+            throw meh;
+        }
+        TestData test;
+        if(opt_verbose) std::cout<<"Testing "<<presentation<<" ("<<hexSign<<") on plat"<<p<<".dev"<<d<<"\n";
+        if(!test.CanRunTests(concurrency)) {
+            std::string msg(presentation);
+            msg += " cannot be tested with concurrency " + std::to_string(concurrency);
+            msg += ", not currently supposed to happen.";
+            throw msg;
+        }
+        if(opt_verbose) {
+            for(asizei t = 0; t < test.GetNumTests(); t++) std::cout<<char('0' + t % 10);
+            std::cout<<std::endl;
+            test.onBlockHashed = [](asizei progress) { std::cout<<'.'; };
+        }
+        const auto start(std::chrono::system_clock::now());
+        try {
+            errors = test.RunTests(dispatcher);
+        } catch(const std::string &msg) {
+            errors.push_back(msg);
+        } catch(const char *msg) {
+            errors.push_back(msg);
+        }
+        const auto finished(std::chrono::system_clock::now());
+        const RunRecord identity(Identify(plats, p, d, imp));
+        if(opt_historyFile) {
+            RunRecord record(identity);
+            record.kind = "test";
+            record.check = "nonces";
+            record.hashCount = test.GetTotalHashes();
+            record.ms = adouble(std::chrono::duration_cast<std::chrono::microseconds>(finished - start).count()) / 1000.0;
+            record.errors = errors.size();
+            record.hashesPerSecond = record.ms > 0? record.hashCount * 1000.0 / record.ms : .0;
+            AppendRecord(opt_historyFile, record);
+        }
+        if(errors.size()) {
+            std::string allErrors(Header(imp.identifier, hexSign) + Header(plats, p, d));
+            for(auto err : errors) allErrors += err + '\n';
+            throw allErrors;
+        }
+        if(opt_verbose) std::cout<<std::endl;
+        if(opt_showTestTime) std::cout<<"t="<<std::chrono::duration_cast<std::chrono::milliseconds>(finished - start).count()<<" ms"<<std::endl;
+        if(opt_benchmark) PrintBenchmark(dispatcher, identity);
+        if(opt_profileCommands) PrintProfile(dispatcher);
+    } catch(const std::string &msg) {
+        Whoops(errorLog, filename(), msg.c_str());
+    } catch(const char *msg) {
+        Whoops(errorLog, filename(), msg);
+    }
+}
+
+
+/*! Additional parameters, if any, are forwarded to TestSubject ctor to select implementation tunables, Pick ones being resolved
+for each device first. Unless opt_explicitConcurrency, concurrency is replaced by the tuned one for each device, if any, see TunedConcurrency. */
+template<typename TestData, typename TestSubject, typename... Tunables>
+void Dispatch(const std::vector<Platform> &plats, const std::vector<cl_context> &platContext, asizei defaultConcurrency, Tunables... tunables) {
     std::ofstream errorLog;
+    TuningProfiles tuning(opt_tuningFile);
     for(unsigned p = 0; p < plats.size(); p++) {
         for(unsigned d = 0; d < plats[p].devices.size(); d++) {
-            TestSubject imp(platContext[p], plats[p].devices[d].clid, concurrency);
-            StopWaitDispatcher dispatcher(imp);
-            auto presentation(imp.identifier.Presentation());
-            std::string hexSign;
-            auto filename = [p, d, &presentation, &hexSign]() -> std::string {
-                std::string ret('p' + std::to_string(p) + 'd' + std::to_string(d) + '-' + presentation);
-                if(hexSign.length()) ret += hexSign;
-                else ret += "failed initialization";
-                return ret + ".txt";
-            };
-            try {
-                auto errors(imp.Init(nullptr, dispatcher.AsValueProvider(), ""));
-                hexSign = imp.GetVersioningHash()? Hex(imp.GetVersioningHash()) : std::string("-failed_to_init");
-                if(errors.size()) {
-                    std::string meh;
-                    for(auto err : errors) meh += err + "\n\n";
-                    throw meh;
-                }
-                TestData test;
-                if(opt_verbose) std::cout<<"Testing "<<presentation<<" ("<<hexSign<<") on plat"<<p<<".dev"<<d<<"\n";
-                if(!test.CanRunTests(concurrency)) {
-                    std::string msg(presentation);
-                    msg += " cannot be tested with concurrency " + std::to_string(concurrency);
-                    msg += ", not currently supposed to happen.";
-                    throw msg;
-                }
-                if(opt_verbose) {
-                    for(asizei t = 0; t < test.GetNumTests(); t++) std::cout<<char('0' + t % 10);
-                    std::cout<<std::endl;
-                    test.onBlockHashed = [](asizei progress) { std::cout<<'.'; };
-                }
-                const auto start(std::chrono::system_clock::now());
-                try {
-                    errors = test.RunTests(dispatcher);
-                } catch(const std::string &msg) {
-                    errors.push_back(msg);
-                } catch(const char *msg) {
-                    errors.push_back(msg);
-                }
-                const auto finished(std::chrono::system_clock::now());
-                if(errors.size()) {
-                    std::string allErrors(Header(imp.identifier, hexSign) + Header(plats, p, d));
-                    for(auto err : errors) allErrors += err + '\n';
-                    throw allErrors;
-                }
-                if(opt_verbose) std::cout<<std::endl;
-                if(opt_showTestTime) std::cout<<"t="<<std::chrono::duration_cast<std::chrono::milliseconds>(finished - start).count()<<" ms"<<std::endl;
-            } catch(const std::string &msg) {
-                Whoops(errorLog, filename(), msg.c_str());
-            } catch(const char *msg) {
-                Whoops(errorLog, filename(), msg);
-            }
+            const cl_device_id dev = plats[p].devices[d].clid;
+            const std::string where("plat" + std::to_string(p) + ".dev" + std::to_string(d));
+            DispatchOn<TestData, TestSubject>(plats, platContext, p, d, errorLog, tuning, defaultConcurrency, Resolve(tuning, dev, where, tunables)...);
         }
     }
 }
@@ -277,10 +495,12 @@ void Dispatch(const std::vector<Platform> &plats, const std::vector<cl_context>
 template<typename StepComparator>
 void Compare(const std::vector<Platform> &plats, const std::vector<cl_context> &platContext, asizei concurrency) {
     std::ofstream errorLog;
+    stepTest::GoldenDigests goldenDigests(opt_goldenDigestsFile);
     for(unsigned p = 0; p < plats.size(); p++) {
         for(unsigned d = 0; d < plats[p].devices.size(); d++) {
             StepComparator test(platContext[p], plats[p].devices[d].clid, concurrency);
-            StopWaitDispatcher dispatcher(test.algo);
+            trace::Session traceSession(opt_traceFile? std::string() : 'p' + std::to_string(p) + 'd' + std::to_string(d) + '-' + test.algo.identifier.Presentation() + ".trace.json");
+            StopWaitDispatcher dispatcher(test.algo, opt_profileCommands || opt_trace);
             test.MakeInputData(dispatcher);
             auto presentation(test.algo.identifier.Presentation());
             std::string hexSign;
@@ -300,16 +520,62 @@ void Compare(const std::vector<Platform> &plats, const std::vector<cl_context> &
                 }
                 if(opt_verbose) std::cout<<"Testing "<<presentation<<" ("<<hexSign<<") on plat"<<p<<".dev"<<d<<"\n";
                 // It is assumed steps complete in a single dispatch so no need to iterate up to producing results!
+                const auto start(std::chrono::system_clock::now());
                 std::set<cl_event> triggered;
                 while(dispatcher.Tick(triggered) != AlgoEvent::working) { }
                 std::vector<cl_event> blockers;
                 dispatcher.GetEvents(blockers);
                 if(blockers.size()) { // step tests can still blocking map.
+                    trace::Span span("map wait");
                     clWaitForEvents(cl_uint(blockers.size()), blockers.data());
                 }
+                const auto computed(std::chrono::system_clock::now());
+                const RunRecord identity(Identify(plats, p, d, test.algo));
+                RunRecord record(identity);
+                record.kind = "test";
+                record.hashCount = test.algo.hashCount;
+                record.ms = adouble(std::chrono::duration_cast<std::chrono::microseconds>(computed - start).count()) / 1000.0;
+                record.hashesPerSecond = record.ms > 0? record.hashCount * 1000.0 / record.ms : .0;
+                hashing::SHA256::Digest digest;
+                const bool digested = opt_goldenDigests && stepTest::ResultsDigest(digest, test.algo, dispatcher.GetQueue());
+                const bool golden = digested && goldenDigests.Matches(test.algo.GetVersioningHash(), StepComparator::seed, test.algo.hashCount, digest);
+                if(golden) {
+                    if(opt_showTestTime) {
+                        using std::chrono::milliseconds;
+                        using std::chrono::duration_cast;
+                        std::cout<<"gpu="<<duration_cast<milliseconds>(computed - start).count()<<" ms, ";
+                        std::cout<<"digest="<<duration_cast<milliseconds>(std::chrono::system_clock::now() - computed).count()<<" ms, matches golden"<<std::endl;
+                    }
+                    if(opt_historyFile) {
+                        record.check = "golden";
+                        AppendRecord(opt_historyFile, record);
+                    }
+                    if(opt_benchmark) PrintBenchmark(dispatcher, identity);
+                    if(opt_profileCommands) PrintProfile(dispatcher);
+                    continue;
+                }
                 typedef std::array<aubyte, 64> Hash;
-                auto bad(test.Check(dispatcher));
-                if(bad.Failed()) throw bad.Describe(test.algo.hashCount);
+                test.sampling = opt_sampling;
+                auto bad([&test, &dispatcher]() {
+                    trace::Span span("Check");
+                    return test.Check(dispatcher);
+                }());
+                const auto checked(std::chrono::system_clock::now());
+                if(opt_showTestTime) {
+                    using std::chrono::milliseconds;
+                    using std::chrono::duration_cast;
+                    std::cout<<"gpu="<<duration_cast<milliseconds>(computed - start).count()<<" ms, check="<<duration_cast<milliseconds>(checked - computed).count()<<" ms"<<std::endl;
+                }
+                if(!test.sampled.Full()) std::cout<<"  sampled: "<<test.sampled.Describe()<<std::endl;
+                if(opt_historyFile) {
+                    record.check = test.sampled.Full()? "full" : "sampled";
+                    record.errors = bad.Count();
+                    AppendRecord(opt_historyFile, record);
+                }
+                if(bad.Failed()) throw bad.Describe(test.sampled.Checked());
+                if(digested && test.sampled.Full()) goldenDigests.Store(test.algo.GetVersioningHash(), StepComparator::seed, test.algo.hashCount, digest);
+                if(opt_benchmark) PrintBenchmark(dispatcher, identity);
+                if(opt_profileCommands) PrintProfile(dispatcher);
             } catch(const std::string &msg) {
                 Whoops(errorLog, filename(), msg.c_str());
             } catch(const char *msg) {
@@ -320,109 +586,949 @@ void Compare(const std::vector<Platform> &plats, const std::vector<cl_context> &
 }
 
 
-void AlgoTests(const std::vector<Platform> &plats, const std::vector<cl_context> &platContext) {
-#if defined(TEST_QUBIT_FIVESTEPS)
-    try {
-        const asizei concurrency = 1024 * 16;
-        Dispatch<testData::Qubit, algoImplementations::QubitFiveStepsCL12>(plats, platContext, concurrency);
-    } catch(const std::string &what) { std::cout<<what<<std::endl; }
-#endif
-#if defined(TEST_MYRGRS_MONOLITHIC)
-    try {
-        const asizei concurrency = 1024 * 16;
-        Dispatch<testData::MYRGRS, algoImplementations::MYRGRSMonolithicCL12>(plats, platContext, concurrency);
-    } catch(const std::string &what) { std::cout<<what<<std::endl; }
-#endif
-#if defined(TEST_FRESH_WARM)
-    try {
-        const asizei concurrency = 1024 * 16;
-        Dispatch<testData::Fresh, algoImplementations::FreshWarmCL12>(plats, platContext, concurrency);
-    } catch(const std::string &what) { std::cout<<what<<std::endl; }
-#endif
-#if defined(TEST_NEOSCRYPT_SMOOTH)
-    try {
-        const asizei concurrency = 1024 * 4;
-        Dispatch<testData::Neoscrypt, algoImplementations::NeoscryptSmoothCL12>(plats, platContext, concurrency);
-    } catch(const std::string &what) { std::cout<<what<<std::endl; }
-#endif
+//! What BenchmarkDevices measured on a device.
+struct DeviceBenchmark {
+    BenchmarkStats stats; //!< no latency samples if the device could not run it
+    std::vector<AbstractAlgorithm::KernelDesc> kernels; //!< as built, see KernelOccupancy
+    cl_ulong localBytes = 0; //!< CL_DEVICE_LOCAL_MEM_SIZE
+    aulong deviceBytes = 0; //!< device memory taken by the algorithm resources, as ConfigDesc tells
+};
+
+
+/*! Build TestSubject with exactly concurrency on each device and time it with Benchmark from an all-zero header with a zero target, as
+Autotune does. Only device work is timed so variants can be compared without host checks getting in the way. Nothing is validated,
+variants are supposed to go through Dispatch first. Devices failing to build are reported and left without samples. */
+template<typename TestSubject, typename... Tunables>
+std::vector<DeviceBenchmark> BenchmarkDevices(const std::vector<Platform> &plats, const std::vector<cl_context> &platContext, asizei concurrency, Tunables... tunables) {
+    std::vector<DeviceBenchmark> ret;
+    for(unsigned p = 0; p < plats.size(); p++) {
+        for(unsigned d = 0; d < plats[p].devices.size(); d++) {
+            DeviceBenchmark measured;
+            try {
+                std::unique_ptr<TestSubject> imp;
+                std::unique_ptr<StopWaitDispatcher> dispatcher;
+                BuildForTuning(imp, dispatcher, platContext[p], plats[p].devices[d].clid, concurrency, tunables...);
+                dispatcher->BlockHeader(std::array<aubyte, 80>());
+                dispatcher->TargetBits(0);
+                measured.stats = Benchmark(*dispatcher, opt_benchWarmUp, opt_benchRepetitions);
+                measured.kernels = imp->DescribeKernels();
+                AbstractAlgorithm::ConfigDesc desc;
+                imp->Init(&desc, dispatcher->AsValueProvider(), "");
+                for(const auto &mem : desc.memUsage) {
+                    if(mem.memoryType == AbstractAlgorithm::ConfigDesc::as_device) measured.deviceBytes += mem.bytes;
+                }
+                measured.localBytes = GetCLDevProp<cl_ulong>(CL_DEVICE_LOCAL_MEM_SIZE, plats[p].devices[d].clid);
+            } catch(const std::string &msg) {
+                std::cout<<"plat"<<p<<".dev"<<d<<" cannot benchmark: "<<msg<<std::endl;
+            } catch(const char *msg) {
+                std::cout<<"plat"<<p<<".dev"<<d<<" cannot benchmark: "<<msg<<std::endl;
+            }
+            ret.push_back(measured);
+        }
+    }
+    return ret;
+}
+
+
+/*! Given BenchmarkDevices results for each variant of an implementation, print them with the kernels they built (see PrintKernels),
+then tell which variant was the fastest for each device. measured[variant] has an entry for each device, in enumeration order.
+The fastest one is also stored in opt_tuningFile as values[variant] so a Pick named what resolves to it from now on. */
+void PrintFastest(const std::vector<Platform> &plats, const char *what, const std::vector<std::string> &variants, const std::vector<auint> &values, const std::vector< std::vector<DeviceBenchmark> > &measured) {
+    TuningProfiles tuning(opt_tuningFile);
+    asizei device = 0;
+    for(unsigned p = 0; p < plats.size(); p++) {
+        for(unsigned d = 0; d < plats[p].devices.size(); d++) {
+            asizei best = variants.size();
+            for(asizei test = 0; test < variants.size(); test++) {
+                const BenchmarkStats &stats(measured[test][device].stats);
+                if(stats.latency.empty()) continue;
+                std::cout<<"plat"<<p<<".dev"<<d<<' '<<what<<' '<<variants[test]<<": "<<stats.Describe()<<std::endl;
+                PrintKernels(measured[test][device].kernels, measured[test][device].localBytes);
+                if(best == variants.size() || stats.HashesPerSecond() > measured[best][device].stats.HashesPerSecond()) best = test;
+            }
+            if(best != variants.size()) {
+                const auto flags(std::cout.flags());
+                const auto precision(std::cout.precision());
+                std::cout<<"plat"<<p<<".dev"<<d<<" fastest "<<what<<": "<<variants[best];
+                std::cout<<" ("<<std::fixed<<std::setprecision(1)<<measured[best][device].stats.HashesPerSecond() / 1000.0<<" kH/s)"<<std::endl;
+                std::cout.flags(flags);
+                std::cout.precision(precision);
+                tuning.StorePick(plats[p].devices[d].clid, what, values[best], variants[best]);
+            }
+            device++;
+        }
+    }
+}
+
+
+/*! Keep TestSubject running on all devices at once for opt_soakMinutes, each dispatch hashing a new random header from a random nonce.
+Target is set so each dispatch produces about 8 candidates, all of them checked by a VerifierPool using miner while the devices keep going.
+Every opt_soakReportSeconds a line for each device tells hash rate since last report and hardware errors so far, then one tells
+how the verifiers keep up: if the queue is often found full or latency grows, host checks are slowing down dispatching.
+Returns false if any device produced a wrong candidate or could not be initialized. */
+template<typename TestSubject, typename... Tunables>
+bool Soak(const std::vector<Platform> &plats, const std::vector<cl_context> &platContext, asizei concurrency, const testData::CPUMiner &miner, Tunables... tunables) {
+    using namespace std::chrono;
+    struct Slot {
+        unsigned p, d;
+        std::unique_ptr<TestSubject> imp;
+        std::unique_ptr<StopWaitDispatcher> dispatcher;
+        std::array<aubyte, 80> header;
+        aulong targetBits;
+        std::string name;
+    };
+    bool good = true;
+    std::vector<std::unique_ptr<Slot>> slots;
+    TuningProfiles tuning(opt_tuningFile);
+    for(unsigned p = 0; p < plats.size(); p++) {
+        for(unsigned d = 0; d < plats[p].devices.size(); d++) {
+            std::unique_ptr<Slot> slot(new Slot);
+            slot->p = p;
+            slot->d = d;
+            slot->name = "plat" + std::to_string(p) + ".dev" + std::to_string(d);
+            try {
+                slot->imp.reset(new TestSubject(platContext[p], plats[p].devices[d].clid, concurrency, Resolve(tuning, plats[p].devices[d].clid, slot->name, tunables)...));
+                slot->dispatcher.reset(new StopWaitDispatcher(*slot->imp));
+                auto errors(slot->imp->Init(nullptr, slot->dispatcher->AsValueProvider(), ""));
+                if(errors.size()) {
+                    std::string meh;
+                    for(auto err : errors) meh += err + "\n\n";
+                    throw meh;
+                }
+            } catch(const std::string &msg) {
+                std::cout<<slot->name<<" cannot soak: "<<msg<<std::endl;
+                good = false;
+                continue;
+            } catch(const char *msg) {
+                std::cout<<slot->name<<" cannot soak: "<<msg<<std::endl;
+                good = false;
+                continue;
+            }
+            slot->targetBits = (~0ull / slot->imp->hashCount) * 8;
+            slots.push_back(std::move(slot));
+        }
+    }
+    if(slots.empty()) return false;
+    const std::string presentation(slots.front()->imp->identifier.Presentation());
+    std::random_device entropy;
+    std::mt19937 rng(entropy());
+    VerifierPool pool(miner, slots.size());
+    if(opt_verbose) std::cout<<"Soaking "<<presentation<<" on "<<slots.size()<<" device"<<(slots.size() > 1? "s" : "")<<" for "<<opt_soakMinutes<<" minutes"<<std::endl;
+
+    const auto start(steady_clock::now());
+    const auto deadline(start + minutes(opt_soakMinutes));
+    auto lastReport(start);
+    std::vector<SoakTally> reported(slots.size());
+    auto report = [&](bool final) {
+        const auto now(steady_clock::now());
+        const auto tallies(pool.Tallies());
+        const double elapsed = duration<double>(now - (final? start : lastReport)).count();
+        const auto flags(std::cout.flags());
+        const auto precision(std::cout.precision());
+        for(asizei s = 0; s < slots.size(); s++) {
+            const aulong hashes = tallies[s].hashes - (final? 0 : reported[s].hashes);
+            std::cout<<(final? "soaked " : "soak ")<<duration_cast<minutes>(now - start).count()<<" min "<<slots[s]->name<<' '<<presentation<<": ";
+            std::cout<<std::fixed<<std::setprecision(1)<<(elapsed > 0? hashes / elapsed / 1000 : .0)<<" kH/s, ";
+            std::cout<<tallies[s].candidates<<" candidates, "<<tallies[s].wrong<<" HW errors ("<<std::setprecision(3)<<tallies[s].ErrorRate() * 100<<"%)";
+            std::cout<<(tallies[s].wrong? " UNSTABLE" : "")<<std::endl;
+        }
+        const VerifierMetrics queue(pool.Metrics());
+        std::cout<<"    verified "<<queue.batches<<" dispatches, queue depth mean "<<std::setprecision(2)<<queue.meanDepth<<" max "<<queue.maxDepth<<'/'<<queue.capacity;
+        std::cout<<", "<<queue.stalls<<" full, latency mean "<<std::setprecision(3)<<queue.meanLatencyMs<<" max "<<queue.maxLatencyMs<<" ms"<<std::endl;
+        std::cout.flags(flags);
+        std::cout.precision(precision);
+        reported = tallies;
+        lastReport = now;
+    };
+
+    while(steady_clock::now() < deadline) {
+        std::set<cl_event> done;
+        std::vector<cl_event> pending;
+        for(auto &slot : slots) {
+            for(auto &b : slot->header) b = aubyte(rng());
+            std::array<aubyte, 80> dispatched(slot->header);
+            if(slot->imp->BigEndian()) {
+                for(asizei i = 0; i < dispatched.size(); i += 4) {
+                    std::swap(dispatched[i + 0], dispatched[i + 3]);
+                    std::swap(dispatched[i + 1], dispatched[i + 2]);
+                }
+            }
+            slot->dispatcher->BlockHeader(dispatched);
+            slot->dispatcher->TargetBits(slot->targetBits);
+            slot->imp->Restart(asizei(rng() % (auint(-1) - slot->imp->hashCount)));
+            if(slot->dispatcher->Tick(done) != AlgoEvent::dispatched) throw std::string("Soak could not dispatch work.");
+            slot->dispatcher->GetEvents(pending);
+        }
+        {
+            trace::Span span("map wait");
+            clWaitForEvents(cl_uint(pending.size()), pending.data());
+        }
+        done.insert(pending.cbegin(), pending.cend());
+        for(asizei s = 0; s < slots.size(); s++) {
+            Slot &slot(*slots[s]);
+            if(slot.dispatcher->Tick(done) != AlgoEvent::results) throw std::string("Soak dispatch completed without results.");
+            const asizei stalls = slot.dispatcher->PushResults(pool.Queue(), s);
+            pool.Pushed(s, slot.imp->hashCount, stalls);
+        }
+        if(steady_clock::now() - lastReport >= seconds(opt_soakReportSeconds)) report(false);
+    }
+    pool.Drain();
+    report(true);
+
+    const auto tallies(pool.Tallies());
+    const double ms = duration<double, std::milli>(steady_clock::now() - start).count();
+    for(asizei s = 0; s < slots.size(); s++) {
+        good &= tallies[s].wrong == 0;
+        if(!opt_historyFile) continue;
+        RunRecord record(Identify(plats, slots[s]->p, slots[s]->d, *slots[s]->imp));
+        record.kind = "test";
+        record.check = "soak";
+        record.hashCount = tallies[s].hashes;
+        record.ms = ms;
+        record.errors = tallies[s].wrong;
+        record.hashesPerSecond = ms > 0? tallies[s].hashes * 1000.0 / ms : .0;
+        AppendRecord(opt_historyFile, record);
+    }
+    return good;
+}
+
+
+/*! Host only: the SPH hashes using AES rounds must give the same digests with the tables and with AES-NI. Lengths go around the
+64 and 128 byte blocks so both the full and the partial final blocks are compressed. Without AES-NI there is nothing to compare. */
+bool CheckSPHAES() {
+    struct Hasher {
+        const char *name;
+        void (*init)(void *cc);
+        void (*update)(void *cc, const void *data, size_t len);
+        void (*close)(void *cc, void *dst);
+    };
+    const Hasher hashers[] = {
+        { "ECHO-256", sph_echo256_init, sph_echo256, sph_echo256_close },
+        { "ECHO-512", sph_echo512_init, sph_echo512, sph_echo512_close },
+        { "SHAvite-512", sph_shavite512_init, sph_shavite512, sph_shavite512_close }
+    };
+    const asizei lengths[] = { 0, 1, 64, 80, 127, 128, 129, 192, 1000 };
+    if(!sph_aesni_available()) {
+        std::cout<<"SPH AES rounds: AES-NI not available, nothing to compare"<<std::endl;
+        return true;
+    }
+    std::vector<aubyte> data(1000);
+    for(asizei loop = 0; loop < data.size(); loop++) data[loop] = aubyte(loop * 7 + 3);
+    std::cout<<"SPH AES rounds, tables against AES-NI:";
+    bool good = true;
+    for(const auto &hasher : hashers) {
+        bool same = true;
+        for(auto len : lengths) {
+            aubyte digest[2][64];
+            for(int use = 0; use < 2; use++) {
+                sph_aesni_enable(use);
+                union {
+                    sph_echo_small_context echo256;
+                    sph_echo_big_context echo512;
+                    sph_shavite_big_context shavite;
+                } cc;
+                hasher.init(&cc);
+                hasher.update(&cc, data.data(), len);
+                hasher.close(&cc, digest[use]);
+            }
+            same &= memcmp(digest[0], digest[1], sizeof(digest[0])) == 0;
+        }
+        std::cout<<' '<<hasher.name<<(same? " OK" : " MISMATCH");
+        good &= same;
+    }
+    std::cout<<std::endl;
+    sph_aesni_enable(1);
+    return good;
+}
+
+REGISTERED_TEST(SPH_AESNI, host, 0) {
+    return CheckSPHAES();
+}
+
+
+/*! Not a GPU test, only run when selected: cycles per byte taken by the SPH ECHO-512 and SHAvite-512 used by the validators, with the table driven AES rounds
+and, if the CPU has them, with AES-NI. Short messages are what the step validators hash, long ones show the compression function alone.
+Cycles are TSC ticks, which run at nominal frequency on most CPUs so only compare them on the same machine. */
+void BenchSPHAES() {
+    struct Hasher {
+        const char *name;
+        void (*init)(void *cc);
+        void (*update)(void *cc, const void *data, size_t len);
+        void (*close)(void *cc, void *dst);
+    };
+    const Hasher hashers[] = {
+        { "ECHO-512", sph_echo512_init, sph_echo512, sph_echo512_close },
+        { "SHAvite-512", sph_shavite512_init, sph_shavite512, sph_shavite512_close }
+    };
+    const asizei lengths[] = { 64, 64 * 1024 };
+    const asizei totalBytes = 1024 * 1024;
+    const bool aesni = sph_aesni_available() != 0;
+    std::vector<aubyte> data(lengths[1]);
+    for(asizei loop = 0; loop < data.size(); loop++) data[loop] = aubyte(loop * 7 + 3);
+    std::cout<<"SPH AES rounds, AES-NI "<<(aesni? "available" : "not available, tables only")<<std::endl;
+    for(const auto &hasher : hashers) {
+        for(auto len : lengths) {
+            double cpb[2] = { .0, .0 };
+            for(int use = 0; use < (aesni? 2 : 1); use++) {
+                sph_aesni_enable(use);
+                union {
+                    sph_echo_big_context echo;
+                    sph_shavite_big_context shavite;
+                } cc;
+                aubyte digest[64];
+                aulong best = ~0ull;
+                for(int rep = 0; rep < 5; rep++) { // best of a few, so preemption does not count
+                    const aulong start = __rdtsc();
+                    for(asizei done = 0; done < totalBytes; done += len) {
+                        hasher.init(&cc);
+                        hasher.update(&cc, data.data(), len);
+                        hasher.close(&cc, digest);
+                    }
+                    const aulong ticks = __rdtsc() - start;
+                    if(ticks < best) best = ticks;
+                }
+                cpb[use] = double(best) / totalBytes;
+            }
+            std::cout<<"  "<<hasher.name<<", "<<len<<" byte messages: tables "<<cpb[0]<<" cycles/byte";
+            if(aesni) std::cout<<", AES-NI "<<cpb[1]<<" cycles/byte ("<<cpb[0] / cpb[1]<<"x)";
+            std::cout<<std::endl;
+        }
+    }
+    sph_aesni_enable(1);
+}
+
+OPTIONAL_TEST(SPH_AESNI_BENCH, host, 0) {
+    BenchSPHAES();
+    return true;
+}
+
+
+/*! Host only: the batched CPU Scrypt(1024) results are checked against, so it must give the same hashes as the template one
+running ROMix a header at a time, with 1, 4 (SSE2) and 8 (AVX2) lanes as long as the CPU has them. 19 headers are never a multiple
+of the lanes so the lanes finishing each batch one at a time are checked as well. */
+bool CheckScryptCPU() {
+    hashing::ScratchArena::ThreadScope arena;
+    const asizei count = 19;
+    std::vector<std::array<auint, 20>> header(count);
+    for(asizei i = 0; i < count; i++) {
+        for(asizei w = 0; w < 20; w++) header[i][w] = auint(i * 0x9E3779B9 + w);
+    }
+    std::vector<std::array<aubyte, 32>> ref(count), got(count);
+    {
+        std::unique_ptr<std::array<auint, 4 * 8 * 1024>> pad(new std::array<auint, 4 * 8 * 1024>);
+        for(asizei i = 0; i < count; i++) hashing::Scrypt<1024>(ref[i], header[i], *pad);
+    }
+    const struct {
+        const char *name;
+        auint features;
+    } lanes[] = {
+        { "1 lane", 0 },
+        { "4 lanes", hashing::sha256::SSE2 },
+        { "8 lanes", hashing::sha256::SSE2 | hashing::sha256::AVX2 }
+    };
+    std::cout<<"CPU Scrypt(1024), batched against one at a time:";
+    bool good = true;
+    for(const auto &run : lanes) {
+        if((hashing::sha256::Available() & run.features) != run.features) continue;
+        hashing::sha256::Enable(run.features);
+        hashing::Scrypt(got.data(), header.data(), count, 1024);
+        std::cout<<' '<<run.name<<(got == ref? " OK" : " MISMATCH");
+        good &= got == ref;
+    }
+    std::cout<<std::endl;
+    hashing::sha256::Enable(~0u);
+    return good;
+}
+
+REGISTERED_TEST(SCRYPT_CPU, host, 0) {
+    return CheckScryptCPU();
+}
+
+
+/*! Not a GPU test either, only run when selected: hashes per second a single core gets out of the CPU Scrypt(1024) used to check
+results. The template one runs ROMix a header at a time, the runtime N one is measured with 1, 4 (SSE2) and 8 (AVX2) lanes as long
+as the CPU has them. Multiply by the amount of cores for an idea of how many hashes a validating thread pool can go through.
+Returns false if a batched run does not give the same hashes as the template one. */
+bool BenchScryptCPU() {
+    hashing::ScratchArena::ThreadScope arena;
+    const asizei count = 64;
+    std::vector<std::array<auint, 20>> header(count);
+    for(asizei i = 0; i < count; i++) {
+        for(asizei w = 0; w < 20; w++) header[i][w] = auint(i * 0x9E3779B9 + w);
+    }
+    std::vector<std::array<aubyte, 32>> ref(count), got(count);
+    auto seconds = [](std::chrono::high_resolution_clock::time_point start) {
+        return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    };
+    std::cout<<"CPU Scrypt(1024), hashes/s on a single core"<<std::endl;
+    {
+        std::unique_ptr<std::array<auint, 4 * 8 * 1024>> pad(new std::array<auint, 4 * 8 * 1024>);
+        const auto start(std::chrono::high_resolution_clock::now());
+        for(asizei i = 0; i < count; i++) hashing::Scrypt<1024>(ref[i], header[i], *pad);
+        std::cout<<"  one at a time: "<<count / seconds(start)<<std::endl;
+    }
+    const struct {
+        const char *name;
+        auint features;
+    } lanes[] = {
+        { "1 lane", 0 },
+        { "4 lanes", hashing::sha256::SSE2 },
+        { "8 lanes", hashing::sha256::SSE2 | hashing::sha256::AVX2 }
+    };
+    bool good = true;
+    for(const auto &run : lanes) {
+        if((hashing::sha256::Available() & run.features) != run.features) continue;
+        hashing::sha256::Enable(run.features);
+        const auto start(std::chrono::high_resolution_clock::now());
+        hashing::Scrypt(got.data(), header.data(), count, 1024);
+        const double elapsed = seconds(start);
+        std::cout<<"  batched, "<<run.name<<": "<<count / elapsed<<(got == ref? "" : ", RESULTS MISMATCH")<<std::endl;
+        good &= got == ref;
+    }
+    hashing::sha256::Enable(~0u);
+    return good;
+}
+
+OPTIONAL_TEST(SCRYPT_CPU_BENCH, host, 0) {
+    return BenchScryptCPU();
 }
 
 
+/*! Host only: the batched SPH hashes the step validators use must give the same digests as hashing each message by itself,
+with and without a prefix, for lengths around the block sizes and with each amount of lanes the CPU has. 19 messages are never a
+multiple of the lanes so the one at a time path finishing the batch is checked as well. */
+bool CheckSPHBatch() {
+    typedef void (*Batch)(const void *prefix, size_t prefix_len, const void *data, size_t len, size_t count, void *dst);
+    struct Hasher {
+        const char *name;
+        Batch batch;
+        void (*init)(void *cc);
+        void (*update)(void *cc, const void *data, size_t len);
+        void (*close)(void *cc, void *dst);
+    };
+    const Hasher hashers[] = {
+        { "Luffa-512", sph_luffa512_batch, sph_luffa512_init, sph_luffa512, sph_luffa512_close },
+        { "CubeHash-512", sph_cubehash512_batch, sph_cubehash512_init, sph_cubehash512, sph_cubehash512_close },
+        { "SHAvite-512", sph_shavite512_batch, sph_shavite512_init, sph_shavite512, sph_shavite512_close },
+        { "SIMD-512", sph_simd512_batch, sph_simd512_init, sph_simd512, sph_simd512_close },
+        { "ECHO-512", sph_echo512_batch, sph_echo512_init, sph_echo512, sph_echo512_close },
+        { "Groestl-512", sph_groestl512_batch, sph_groestl512_init, sph_groestl512, sph_groestl512_close }
+    };
+    const asizei prefixes[] = { 0, 1, 32, 64, 100, 128 };
+    const asizei lengths[] = { 0, 16, 31, 64, 80, 129 };
+    const asizei count = 19;
+    std::vector<aubyte> prefix(128), data(count * 129), got(count * 64);
+    for(asizei loop = 0; loop < prefix.size(); loop++) prefix[loop] = aubyte(loop * 13 + 5);
+    for(asizei loop = 0; loop < data.size(); loop++) data[loop] = aubyte(loop * 7 + 3);
+    const auint available = sph_batch_lanes_available();
+    std::cout<<"SPH batched hashing against one message at a time, up to "<<available<<" lanes"<<std::endl;
+    bool good = true;
+    const auint lanes[] = { 1, 4, 8 };
+    for(auto limit : lanes) {
+        if(limit > available) continue;
+        sph_batch_max_lanes(limit);
+        std::cout<<"  "<<sph_batch_lanes()<<(limit == 1? " lane:" : " lanes:");
+        for(const auto &hasher : hashers) {
+            bool same = true;
+            for(auto pre : prefixes) {
+                for(auto len : lengths) {
+                    hasher.batch(pre? prefix.data() : nullptr, pre, data.data(), len, count, got.data());
+                    for(asizei i = 0; i < count; i++) {
+                        union {
+                            sph_luffa512_context luffa;
+                            sph_cubehash512_context cubehash;
+                            sph_shavite512_context shavite;
+                            sph_simd512_context simd;
+                            sph_echo512_context echo;
+                            sph_groestl512_context groestl;
+                        } cc;
+                        aubyte digest[64];
+                        hasher.init(&cc);
+                        if(pre) hasher.update(&cc, prefix.data(), pre);
+                        hasher.update(&cc, data.data() + i * len, len);
+                        hasher.close(&cc, digest);
+                        same &= memcmp(digest, got.data() + i * 64, 64) == 0;
+                    }
+                }
+            }
+            std::cout<<' '<<hasher.name<<(same? " OK" : " MISMATCH");
+            good &= same;
+        }
+        std::cout<<std::endl;
+    }
+    sph_batch_max_lanes(8);
+    return good;
+}
+
+REGISTERED_TEST(SPH_BATCH, host, 0) {
+    return CheckSPHBatch();
+}
 
-bool StepTests(const std::vector<Platform> &plats, const std::vector<cl_context> &platContext) {
-    bool failed = false;
+
+/*! Host only as well: the CPU miners must find the very same nonces the legacy miner found for the test data.
+Scanning whole runs takes way too long so for the first run producing results, a window around each nonce is scanned and must give
+all the nonces of the run falling in it, and no more. The found_candidates of a run are complete so this catches false positives as well. */
+template<typename TestData>
+bool CheckCPUMiner(const testData::CPUMiner &miner, const TestData &data, auint window) {
+    const auto runs(data.GetHeaders());
+    const auto found(data.GetFound());
+    const auint *expected = found.first;
+    asizei run = 0;
+    while(run < runs.second && runs.first[run].numResults == 0) run++;
+    if(run == runs.second) return true;
+    for(asizei prev = 0; prev < run; prev++) expected += runs.first[prev].numResults;
+    const auto &test(runs.first[run]);
+    bool good = true;
+    asizei scanned = 0;
+    const auto start(std::chrono::high_resolution_clock::now());
+    for(asizei check = 0; check < test.numResults; check++) {
+        const auint nonce = SWAP_BYTES(expected[check]);
+        const aulong first = nonce > window? nonce - window : 0;
+        const aulong count = 2ull * window;
+        std::vector<auint> inWindow;
+        for(asizei i = 0; i < test.numResults; i++) {
+            const auint other = SWAP_BYTES(expected[i]);
+            if(other >= first && other - first < count) inWindow.push_back(expected[i]);
+        }
+        std::sort(inWindow.begin(), inWindow.end(), [](auint a, auint b) { return SWAP_BYTES(a) < SWAP_BYTES(b); });
+        if(miner.Scan(test.clData, test.targetBits, first, count) != inWindow) good = false;
+        scanned += asizei(count);
+    }
+    const double elapsed = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    std::cout<<"  "<<miner.name<<" run ["<<run<<"]: "<<(good? "OK" : "NONCES MISMATCH")<<", "<<scanned / elapsed / 1000.0<<" kH/s"<<std::endl;
+    return good;
+}
+
+
+bool CheckCPUMiners() {
+    std::cout<<"CPU reference miners against test data"<<std::endl;
+    bool good = true;
+    good &= CheckCPUMiner(testData::QubitCPU(), testData::Qubit(), 32 * 1024);
+    good &= CheckCPUMiner(testData::FreshCPU(), testData::Fresh(), 32 * 1024);
+    good &= CheckCPUMiner(testData::MYRGRSCPU(), testData::MYRGRS(), 32 * 1024);
+    good &= CheckCPUMiner(testData::NeoscryptCPU(), testData::Neoscrypt(), 512);
+    return good;
+}
+
+REGISTERED_TEST(CPU_MINERS, host, 0) {
+    return CheckCPUMiners();
+}
+
+
+REGISTERED_TEST(LUFFA_1W_HEAD, step, 1024 * 16 * 4) {
+    Compare< stepTest::HeadTest<stepTest::Luffa_1W> >(plats, platContext, concurrency);
+    return true;
+}
+
+REGISTERED_TEST(CUBEHASH_2W_CHAINED, step, 1024 * 16 * 4) {
+    Compare< stepTest::StepTest<stepTest::CubeHash_2W> >(plats, platContext, concurrency);
+    return true;
+}
+
+REGISTERED_TEST(SHAVITE3_1W_CHAINED, step, 1024 * 16 * 4) {
+    Compare< stepTest::StepTest<stepTest::ShaVite3_1W> >(plats, platContext, concurrency);
+    return true;
+}
+
+REGISTERED_TEST(SIMD_16W_CHAINED, step, 1024 * 16 * 4) {
+    Compare< stepTest::StepTest<stepTest::SIMD_16W> >(plats, platContext, concurrency);
+    return true;
+}
+
+REGISTERED_TEST(ECHO_8W_TAIL, step, 1024 * 16 * 4) {
+    Compare< stepTest::TailTest<stepTest::ECHO_8W> >(plats, platContext, concurrency);
+    return true;
+}
+
+REGISTERED_TEST(NS_FIRSTKDF_4W_HEAD, step, 1024 * 16 * 4) {
+    Compare< stepTest::HeadTest<stepTest::NS_FirstKDF_4W> >(plats, platContext, concurrency);
+    return true;
+}
+
+REGISTERED_TEST(NS_SW_SALSA, step, 1024 * 8) {
     using namespace stepTest;
-#if defined(TEST_LUFFA_1W_HEAD)
-    try {
-        const asizei concurrency = 1024 * 16 * 4;
-        Compare< HeadTest<Luffa_1W> >(plats, platContext, concurrency);
-    } catch(const std::string &what) { std::cout<<what<<std::endl;    failed = true; }
-#endif
-#if defined(TEST_CUBEHASH_2W_CHAINED)
-    try {
-        const asizei concurrency = 1024 * 16 * 4;
-        Compare< StepTest< CubeHash_2W> >(plats, platContext, concurrency);
-    } catch(const std::string &what) { std::cout<<what<<std::endl;    failed = true; }
-#endif
-#if defined(TEST_SHAVITE3_1W_CHAINED)
-    try {
-        const asizei concurrency = 1024 * 16 * 4;
-        Compare< StepTest< ShaVite3_1W> >(plats, platContext, concurrency);
-    } catch(const std::string &what) { std::cout<<what<<std::endl;    failed = true; }
-#endif
-#if defined(TEST_SIMD_16W_CHAINED)
-    try {
-        const asizei concurrency = 1024 * 16 * 4;
-        Compare< StepTest<SIMD_16W> >(plats, platContext, concurrency);
-    } catch(const std::string &what) { std::cout<<what<<std::endl;    failed = true; }
-#endif
-#if defined(TEST_ECHO_8W_TAIL)
-    try {
-        const asizei concurrency = 1024 * 16 * 4;
-        Compare< TailTest<ECHO_8W> >(plats, platContext, concurrency);
-    } catch(const std::string &what) { std::cout<<what<<std::endl;    failed = true; }
-#endif
-#if defined(TEST_NS_FIRSTKDF_4W_HEAD)
-    try {
-        const asizei concurrency = 1024 * 16 * 4;
-        Compare< HeadTest<NS_FirstKDF_4W> >(plats, platContext, concurrency);
-    } catch(const std::string &what) { std::cout<<what<<std::endl;    failed = true; }
-#endif
-#if defined(TEST_NS_SW_SALSA)
-    try {
-        const asizei concurrency = 1024 * 8;
-        Compare< StepTest< NS_SW<nsHelp::Salsa> > >(plats, platContext, concurrency);
-    } catch(const std::string &what) { std::cout<<what<<std::endl;    failed = true; }
-#endif
-#if defined(TEST_NS_IR_SALSA)
-    try {
-        const asizei concurrency = 1024 * 8;
-        Compare< StepTest< NS_IR<nsHelp::Salsa> > >(plats, platContext, concurrency);
-    } catch(const std::string &what) { std::cout<<what<<std::endl;    failed = true; }
-#endif
-#if defined(TEST_NS_SW_CHACHA)
-    try {
-        const asizei concurrency = 1024 * 8;
-        Compare< StepTest< NS_SW<nsHelp::Chacha> > >(plats, platContext, concurrency);
-    } catch(const std::string &what) { std::cout<<what<<std::endl;    failed = true; }
-#endif
-#if defined(TEST_NS_IR_CHACHA)
-    try {
-        const asizei concurrency = 1024 * 8;
-        Compare< StepTest< NS_IR<nsHelp::Chacha> > >(plats, platContext, concurrency);
-    } catch(const std::string &what) { std::cout<<what<<std::endl;    failed = true; }
-#endif
-#if defined(TEST_NS_FASTKDF_4W_TAIL)
-    try {
-        const asizei concurrency = 1024 * 16 * 4;
-        Compare< TailTest<NS_LastKDF_4W> >(plats, platContext, concurrency);
-    } catch(const std::string &what) { std::cout<<what<<std::endl;    failed = true; }
-#endif
-    return !failed;
+    Compare< StepTest< NS_SW<nsHelp::Salsa> > >(plats, platContext, concurrency);
+    return true;
 }
 
+REGISTERED_TEST(NS_IR_SALSA, step, 1024 * 8) {
+    using namespace stepTest;
+    Compare< StepTest< NS_IR<nsHelp::Salsa> > >(plats, platContext, concurrency);
+    return true;
+}
+
+REGISTERED_TEST(NS_SW_CHACHA, step, 1024 * 8) {
+    using namespace stepTest;
+    Compare< StepTest< NS_SW<nsHelp::Chacha> > >(plats, platContext, concurrency);
+    return true;
+}
+
+REGISTERED_TEST(NS_IR_CHACHA, step, 1024 * 8) {
+    using namespace stepTest;
+    Compare< StepTest< NS_IR<nsHelp::Chacha> > >(plats, platContext, concurrency);
+    return true;
+}
+
+REGISTERED_TEST(NS_LOOKUP_GAP, step, 1024 * 8) {
+    using namespace stepTest;
+    Compare< StepTest< NS_SW<nsHelp::Salsa, 2> > >(plats, platContext, concurrency);
+    Compare< StepTest< NS_IR<nsHelp::Salsa, 2> > >(plats, platContext, concurrency);
+    Compare< StepTest< NS_SW<nsHelp::Chacha, 4> > >(plats, platContext, concurrency);
+    Compare< StepTest< NS_IR<nsHelp::Chacha, 4> > >(plats, platContext, concurrency);
+    return true;
+}
 
-int main() {
+REGISTERED_TEST(NS_PAD_LAYOUT, step, 1024 * 8) {
+    using namespace stepTest;
+    using algoImplementations::NeoscryptPadLayout;
+    Compare< StepTest< NS_SW<nsHelp::Salsa, 1, NeoscryptPadLayout::hashMajor> > >(plats, platContext, concurrency);
+    Compare< StepTest< NS_IR<nsHelp::Salsa, 1, NeoscryptPadLayout::hashMajor> > >(plats, platContext, concurrency);
+    Compare< StepTest< NS_SW<nsHelp::Chacha, 1, NeoscryptPadLayout::uint4Strided> > >(plats, platContext, concurrency);
+    Compare< StepTest< NS_IR<nsHelp::Chacha, 1, NeoscryptPadLayout::uint4Strided> > >(plats, platContext, concurrency);
+    Compare< StepTest< NS_SW<nsHelp::Chacha, 2, NeoscryptPadLayout::hashMajor> > >(plats, platContext, concurrency);
+    Compare< StepTest< NS_IR<nsHelp::Salsa, 2, NeoscryptPadLayout::uint4Strided> > >(plats, platContext, concurrency);
+    return true;
+}
+
+// Never ran when tests were selected at build time: it checked for a misspelled macro. Only runs on request until it is known to pass.
+OPTIONAL_TEST(NS_LASTKDF_4W_TAIL, step, 1024 * 16 * 4) {
+    Compare< stepTest::TailTest<stepTest::NS_LastKDF_4W> >(plats, platContext, concurrency);
+    return true;
+}
+
+
+REGISTERED_TEST(QUBIT_FIVESTEPS, algo, 1024 * 16) {
+    using algoImplementations::AESTablesSource;
+    Dispatch<testData::Qubit, algoImplementations::QubitFiveStepsCL12>(plats, platContext, concurrency, PickOr("Qubit AES tables", AESTablesSource::lds));
+    return true;
+}
+
+REGISTERED_TEST(MYRGRS_MONOLITHIC, algo, 1024 * 16) {
+    using algoImplementations::GroestlTables;
+    Dispatch<testData::MYRGRS, algoImplementations::MYRGRSMonolithicCL12>(plats, platContext, concurrency, PickOr("Groestl tables", GroestlTables::six));
+    return true;
+}
+
+REGISTERED_TEST(FRESH_WARM, algo, 1024 * 16) {
+    using algoImplementations::AESTablesSource;
+    Dispatch<testData::Fresh, algoImplementations::FreshWarmCL12>(plats, platContext, concurrency, PickOr("Fresh AES tables", AESTablesSource::lds));
+    return true;
+}
+
+REGISTERED_TEST(NEOSCRYPT_SMOOTH, algo, 1024 * 4) {
+    using algoImplementations::NeoscryptPadLayout;
+    Dispatch<testData::Neoscrypt, algoImplementations::NeoscryptSmoothCL12>(plats, platContext, concurrency, PickOr("Neoscrypt lookup gap", auint(1)), PickOr("Neoscrypt pad layout", NeoscryptPadLayout::sliceInterleaved));
+    return true;
+}
+
+/* Pad memory goes down with the lookup gap so concurrency can go up. Test data cannot be split in more than 8Ki hashes so gaps are
+validated at the same concurrency. When benchmarking, gaps 1, 2 and 4 are then compared at equal pad memory: gap G runs G times
+the hashes a gap of 1 does. The fastest gap is picked for NEOSCRYPT_SMOOTH, which runs it at its tuned concurrency if any. */
+REGISTERED_TEST(NEOSCRYPT_SMOOTH_LOOKUP_GAP, algo, 1024 * 8) {
+    using algoImplementations::NeoscryptSmoothCL12;
+    const auint lookupGap[] = { 2, 4 };
+    bool good = true;
+    for(auto gap : lookupGap) {
+        try {
+            if(opt_verbose) std::cout<<"Neoscrypt lookup gap "<<gap<<std::endl;
+            Dispatch<testData::Neoscrypt, NeoscryptSmoothCL12>(plats, platContext, concurrency, gap);
+        } catch(const std::string &what) { std::cout<<what<<std::endl;    good = false; }
+    }
+    if(!good || (!opt_benchmark && !opt_autotune)) return good;
+    const auint compared[] = { 1, 2, 4 };
+    std::vector<std::string> names;
+    std::vector<auint> values;
+    std::vector< std::vector<DeviceBenchmark> > measured;
+    for(auto gap : compared) {
+        names.push_back(std::to_string(gap) + ", " + std::to_string(concurrency * gap) + " hashes");
+        values.push_back(gap);
+        measured.push_back(BenchmarkDevices<NeoscryptSmoothCL12>(plats, platContext, concurrency * gap, gap));
+    }
+    PrintFastest(plats, "Neoscrypt lookup gap", names, values, measured);
+    return good;
+}
+
+/* When benchmarking, dual chain is timed against NeoscryptSmoothCL12 at the same concurrency. Memory per hash is printed next to it:
+the second pad only pays off if hash rate goes up more than memory does, otherwise smooth at a higher concurrency is better. */
+REGISTERED_TEST(NEOSCRYPT_DUAL_CHAIN, algo, 1024 * 4) {
+    using algoImplementations::NeoscryptSmoothCL12;
+    using algoImplementations::NeoscryptDualChainCL12;
+    Dispatch<testData::Neoscrypt, NeoscryptDualChainCL12>(plats, platContext, concurrency);
+    if(!opt_benchmark) return true;
+    const auto smooth(BenchmarkDevices<NeoscryptSmoothCL12>(plats, platContext, concurrency));
+    const auto dual(BenchmarkDevices<NeoscryptDualChainCL12>(plats, platContext, concurrency));
+    const auto flags(std::cout.flags());
+    const auto precision(std::cout.precision());
+    asizei device = 0;
+    for(unsigned p = 0; p < plats.size(); p++) {
+        for(unsigned d = 0; d < plats[p].devices.size(); d++, device++) {
+            const DeviceBenchmark &before(smooth[device]), &after(dual[device]);
+            if(before.stats.latency.empty() || after.stats.latency.empty() || !before.deviceBytes) continue;
+            const adouble speed = after.stats.HashesPerSecond() / before.stats.HashesPerSecond();
+            const adouble memory = adouble(after.deviceBytes) / before.deviceBytes;
+            std::cout<<"plat"<<p<<".dev"<<d<<" Neoscrypt dual chain: "<<after.stats.Describe()<<std::endl;
+            PrintKernels(after.kernels, after.localBytes);
+            std::cout<<"plat"<<p<<".dev"<<d<<" dual chain vs smooth: "<<std::fixed<<std::setprecision(1);
+            std::cout<<after.stats.HashesPerSecond() / 1000.0<<" vs "<<before.stats.HashesPerSecond() / 1000.0<<" kH/s ("<<std::showpos<<(speed - 1) * 100<<"%)";
+            std::cout<<std::noshowpos<<", "<<after.deviceBytes / concurrency<<" vs "<<before.deviceBytes / concurrency<<" bytes per hash (";
+            std::cout<<std::showpos<<(memory - 1) * 100<<"%)"<<std::noshowpos<<std::endl;
+            std::cout.flags(flags);
+            std::cout.precision(precision);
+        }
+    }
+    return true;
+}
+
+/* All layouts are validated as usual. When benchmarking, each one is then timed with BenchmarkDevices at the same concurrency
+and the fastest one is picked for each device, NEOSCRYPT_SMOOTH and SOAK_NEOSCRYPT use it from then on. */
+REGISTERED_TEST(NEOSCRYPT_PAD_LAYOUT, algo, 1024 * 4) {
+    using algoImplementations::NeoscryptPadLayout;
+    using algoImplementations::NeoscryptSmoothCL12;
+    const NeoscryptPadLayout layouts[] = { NeoscryptPadLayout::sliceInterleaved, NeoscryptPadLayout::hashMajor, NeoscryptPadLayout::uint4Strided };
+    std::vector<std::string> names;
+    std::vector<auint> values;
+    for(auto layout : layouts) {
+        if(opt_verbose) std::cout<<"Neoscrypt pad layout: "<<GetName(layout)<<std::endl;
+        names.push_back(GetName(layout));
+        values.push_back(auint(layout));
+        Dispatch<testData::Neoscrypt, NeoscryptSmoothCL12>(plats, platContext, concurrency, auint(1), layout);
+    }
+    if(!opt_benchmark && !opt_autotune) return true;
+    std::vector< std::vector<DeviceBenchmark> > measured;
+    for(auto layout : layouts) measured.push_back(BenchmarkDevices<NeoscryptSmoothCL12>(plats, platContext, concurrency, auint(1), layout));
+    PrintFastest(plats, "Neoscrypt pad layout", names, values, measured);
+    return true;
+}
+
+// Same thing as NEOSCRYPT_PAD_LAYOUT but for the AES T tables used by SHAvite3 and Echo, picked for Qubit and Fresh independently.
+REGISTERED_TEST(AES_TABLES, algo, 1024 * 16) {
+    using algoImplementations::AESTablesSource;
+    const AESTablesSource sources[] = { AESTablesSource::lds, AESTablesSource::global, AESTablesSource::image };
+    std::vector<std::string> names;
+    std::vector<auint> values;
+    for(auto source : sources) {
+        if(opt_verbose) std::cout<<"AES tables from "<<GetName(source)<<std::endl;
+        names.push_back(GetName(source));
+        values.push_back(auint(source));
+        Dispatch<testData::Qubit, algoImplementations::QubitFiveStepsCL12>(plats, platContext, concurrency, source);
+        Dispatch<testData::Fresh, algoImplementations::FreshWarmCL12>(plats, platContext, concurrency, source);
+    }
+    if(!opt_benchmark && !opt_autotune) return true;
+    std::vector< std::vector<DeviceBenchmark> > qubit, fresh;
+    for(auto source : sources) {
+        qubit.push_back(BenchmarkDevices<algoImplementations::QubitFiveStepsCL12>(plats, platContext, concurrency, source));
+        fresh.push_back(BenchmarkDevices<algoImplementations::FreshWarmCL12>(plats, platContext, concurrency, source));
+    }
+    PrintFastest(plats, "Qubit AES tables", names, values, qubit);
+    PrintFastest(plats, "Fresh AES tables", names, values, fresh);
+    return true;
+}
+
+/* Groestl with fewer LDS tables trades lookups for rotates, picked as NEOSCRYPT_PAD_LAYOUT does. Kernels of each variant are printed
+with their estimated occupancy: fewer tables only pays off when LDS was the limit. */
+REGISTERED_TEST(GROESTL_TABLES, algo, 1024 * 16) {
+    using algoImplementations::GroestlTables;
+    const GroestlTables variants[] = { GroestlTables::six, GroestlTables::two, GroestlTables::one };
+    std::vector<std::string> names;
+    std::vector<auint> values;
+    for(auto tables : variants) {
+        if(opt_verbose) std::cout<<"Groestl with "<<GetName(tables)<<std::endl;
+        names.push_back(GetName(tables));
+        values.push_back(auint(tables));
+        Dispatch<testData::MYRGRS, algoImplementations::MYRGRSMonolithicCL12>(plats, platContext, concurrency, tables);
+    }
+    if(!opt_benchmark && !opt_autotune) return true;
+    std::vector< std::vector<DeviceBenchmark> > measured;
+    for(auto tables : variants) measured.push_back(BenchmarkDevices<algoImplementations::MYRGRSMonolithicCL12>(plats, platContext, concurrency, tables));
+    PrintFastest(plats, "Groestl tables", names, values, measured);
+    return true;
+}
+
+
+// Soaking takes opt_soakMinutes for each algorithm so they only run on request, see Soak.
+OPTIONAL_TEST(SOAK_QUBIT, algo, 1024 * 16) {
+    using algoImplementations::AESTablesSource;
+    return Soak<algoImplementations::QubitFiveStepsCL12>(plats, platContext, concurrency, testData::QubitCPU(), PickOr("Qubit AES tables", AESTablesSource::lds));
+}
+
+OPTIONAL_TEST(SOAK_MYRGRS, algo, 1024 * 16) {
+    using algoImplementations::GroestlTables;
+    return Soak<algoImplementations::MYRGRSMonolithicCL12>(plats, platContext, concurrency, testData::MYRGRSCPU(), PickOr("Groestl tables", GroestlTables::six));
+}
+
+OPTIONAL_TEST(SOAK_FRESH, algo, 1024 * 16) {
+    using algoImplementations::AESTablesSource;
+    return Soak<algoImplementations::FreshWarmCL12>(plats, platContext, concurrency, testData::FreshCPU(), PickOr("Fresh AES tables", AESTablesSource::lds));
+}
+
+OPTIONAL_TEST(SOAK_NEOSCRYPT, algo, 1024 * 4) {
+    using algoImplementations::NeoscryptPadLayout;
+    return Soak<algoImplementations::NeoscryptSmoothCL12>(plats, platContext, concurrency, testData::NeoscryptCPU(), PickOr("Neoscrypt lookup gap", auint(1)), PickOr("Neoscrypt pad layout", NeoscryptPadLayout::sliceInterleaved));
+}
+
+
+//! What the command line selects, see main.
+struct Selection {
+    std::vector<std::string> tests; //!< names, a trailing '*' matches any name starting with what's before it. Empty selects the default ones.
+    std::vector<std::pair<unsigned, unsigned>> devices; //!< platform, device as enumerated. Empty selects all.
+    std::vector<asizei> concurrency; //!< each test runs once for each. Empty uses the registered concurrency.
+
+    bool Selected(const RegisteredTest &test) const {
+        if(tests.empty()) return test.byDefault;
+        for(const auto &name : tests) {
+            if(name == test.name) return true;
+            if(name.length() && name.back() == '*' && test.name.compare(0, name.length() - 1, name, 0, name.length() - 1) == 0) return true;
+        }
+        return false;
+    }
+};
+
+
+/*! Runs the selected tests, host first, then steps. Algorithms only run if all the steps passed: they build on the same kernels.
+Returns the amount of tests failing. */
+asizei RunTests(const std::vector<Platform> &plats, const std::vector<cl_context> &platContext, const Selection &selection) {
+    const TestKind order[] = { TestKind::host, TestKind::step, TestKind::algo };
+    asizei failed = 0, hostFailed = 0;
+    for(auto kind : order) {
+        if(kind == TestKind::step) hostFailed = failed;
+        if(kind == TestKind::algo && failed > hostFailed) {
+            const asizei steps = failed - hostFailed;
+            std::cout<<"Skipping algorithm tests, "<<steps<<" step test"<<(steps > 1? "s" : "")<<" failed."<<std::endl;
+            break;
+        }
+        for(const auto &test : Registry()) {
+            if(test.kind != kind || !selection.Selected(test)) continue;
+            std::vector<asizei> concurrency(selection.concurrency);
+            if(concurrency.empty() || kind == TestKind::host) concurrency.assign(1, test.concurrency);
+            for(auto c : concurrency) {
+                if(opt_verbose && selection.concurrency.size() > 1 && kind != TestKind::host) std::cout<<test.name<<", concurrency "<<c<<std::endl;
+                try {
+                    if(!test.run(plats, platContext, c)) failed++;
+                } catch(const std::string &what) { std::cout<<what<<std::endl;    failed++; }
+                catch(const char *what) { std::cout<<what<<std::endl;    failed++; }
+            }
+        }
+    }
+    return failed;
+}
+
+
+static std::vector<std::string> SplitList(const std::string &list) {
+    std::vector<std::string> ret;
+    std::stringstream parse(list);
+    std::string item;
+    while(std::getline(parse, item, ',')) {
+        if(item.length()) ret.push_back(item);
+    }
+    return ret;
+}
+
+
+/*! Parses the test selection options, see main. Throws std::string on anything not making sense. */
+static Selection ParseCommandLine(int argc, char *argv[], bool &list) {
+    Selection ret;
+    list = false;
+    for(int arg = 1; arg < argc; arg++) {
+        const std::string opt(argv[arg]);
+        if(opt == "--list") {
+            list = true;
+            continue;
+        }
+        if(opt == "--profile") {
+            opt_profileCommands = true;
+            continue;
+        }
+        if(opt == "--trace" || opt.compare(0, 8, "--trace=") == 0) {
+            opt_trace = true;
+            if(opt.length() > 8) opt_traceFile = argv[arg] + 8;
+            continue;
+        }
+        if(arg + 1 == argc) throw std::string("Missing value for ") + opt;
+        const auto values(SplitList(argv[++arg]));
+        if(opt == "--tests") ret.tests.insert(ret.tests.end(), values.cbegin(), values.cend());
+        else if(opt == "--devices") {
+            for(const auto &el : values) {
+                unsigned p = 0, d = 0;
+                char dot = 0;
+                std::stringstream parse(el);
+                if(!(parse>>p>>dot>>d) || dot != '.') throw std::string("Devices are selected as platform.device, got ") + el;
+                ret.devices.push_back(std::make_pair(p, d));
+            }
+        }
+        else if(opt == "--concurrency") {
+            opt_explicitConcurrency = true;
+            for(const auto &el : values) {
+                asizei concurrency = 0;
+                std::stringstream parse(el);
+                if(!(parse>>concurrency) || !concurrency) throw std::string("Bad concurrency ") + el;
+                ret.concurrency.push_back(concurrency);
+            }
+        }
+        else if(opt == "--soak-minutes") {
+            std::stringstream parse(values.size()? values.front() : std::string());
+            if(!(parse>>opt_soakMinutes)) throw std::string("Bad soak duration ") + argv[arg];
+        }
+        else if(opt == "--mode") {
+            opt_benchmark = opt_autotune = false;
+            for(const auto &el : values) {
+                if(el == "bench") opt_benchmark = true;
+                else if(el == "tune") opt_autotune = true;
+                else if(el != "validate") throw std::string("Unknown mode ") + el + ", use validate, bench or tune.";
+            }
+        }
+        else throw std::string("Unknown option ") + opt;
+    }
+    return ret;
+}
+
+
+/*! Without arguments, runs the tests registered to run by default on all devices.
+    --list                        prints the registered tests
+    --tests NAME,PREFIX*,...      runs those instead
+    --devices P.D,...             only on those devices, numbered as in the results after dropping platforms without GPUs
+    --concurrency N,...           runs each test once for each value instead of the concurrency it is registered with or tuned
+    --mode validate,bench,tune    validation always happens, bench and tune set opt_benchmark and opt_autotune. Both benchmark the
+                                  variants of *_LOOKUP_GAP, *_PAD_LAYOUT and *_TABLES tests and store the fastest for each device
+    --soak-minutes M              how long each SOAK_* test runs, those are only run when selected, for example --tests SOAK_*
+    --profile                     times each command on the device and prints ns/hash for each of them after each run, see PrintProfile
+    --trace[=file]                writes a chrome://tracing timeline of each run to p<P>d<D>-<algorithm>.trace.json, or of the whole
+                                  program run to file. Only the most recent spans of each thread are kept, see Trace.h
+The host benchmarks are only run when selected as well, for example --tests SPH_AESNI_BENCH,SCRYPT_CPU_BENCH
+Exit code is the amount of tests failing.
+    oclcckvck compare <baseline> <candidate> [threshold%]
+compares benchmarks of two versioning hashes (hex) found in opt_historyFile, exit code being the amount of devices where candidate
+is more than threshold% (default 2) slower than baseline. */
+int main(int argc, char *argv[]) {
+    if(argc >= 4 && std::string(argv[1]) == "compare") {
+        try {
+            const aulong baseline = std::stoull(argv[2], nullptr, 16), candidate = std::stoull(argv[3], nullptr, 16);
+            const adouble threshold = argc >= 5? std::stod(argv[4]) : 2.0;
+            return int(CompareSignatures(LoadRecords(opt_historyFile), baseline, candidate, threshold, std::cout));
+        } catch(const std::exception &) {
+            std::cout<<"Usage: oclcckvck compare <baseline versioning hash> <candidate versioning hash> [threshold %]"<<std::endl;
+            return -1;
+        }
+    }
+    Selection selection;
+    bool list = false;
+    try {
+        selection = ParseCommandLine(argc, argv, list);
+    } catch(const std::string &msg) {
+        std::cout<<msg<<std::endl;
+        return -1;
+    }
+    if(list) {
+        const char *kind[] = { "host", "step", "algo" };
+        for(const auto &test : Registry()) {
+            std::cout<<test.name<<" ("<<kind[int(test.kind)]<<(test.byDefault? "" : ", optional");
+            if(test.kind != TestKind::host) std::cout<<", concurrency "<<test.concurrency;
+            std::cout<<')'<<std::endl;
+        }
+        return 0;
+    }
+    trace::enabled = opt_trace;
+    trace::Session wholeRun(opt_traceFile? opt_traceFile : "");
+    asizei failed = 0;
     try {
         std::vector<Platform> plats(EnumeratePlatforms());
         if(opt_verbose) std::cout<<"Found "<<plats.size()<<" OpenCL platform"<<(plats.size() > 1? "s" : "")<<" for processing."<<std::endl;
@@ -433,6 +1539,19 @@ int main() {
             }
             else if(opt_verbose) std::cout<<"Platform "<<plats[p].clIndex<<" counts "<<plats[p].devices.size()<<" device"<<(plats[p].devices.size() > 1? "s" : "")<<" to test."<<std::endl;
         }
+        if(selection.devices.size()) {
+            std::vector<Platform> keep;
+            for(unsigned p = 0; p < plats.size(); p++) {
+                Platform plat(plats[p]);
+                plat.devices.clear();
+                for(unsigned d = 0; d < plats[p].devices.size(); d++) {
+                    if(std::find(selection.devices.cbegin(), selection.devices.cend(), std::make_pair(p, d)) != selection.devices.cend()) plat.devices.push_back(plats[p].devices[d]);
+                }
+                if(plat.devices.size()) keep.push_back(plat);
+            }
+            plats = std::move(keep);
+            if(opt_verbose) std::cout<<"Testing "<<selection.devices.size()<<" selected device"<<(selection.devices.size() > 1? "s" : "")<<" only."<<std::endl;
+        }
         if(opt_verbose) std::cout<<"- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - "<<std::endl;
         std::vector<cl_context> platContext;
         platContext.reserve(plats.size());
@@ -453,11 +1572,8 @@ int main() {
             cl_context ctx = clCreateContext(ctxprops, cl_uint(devs.size()), devs.data(), errorFunc, plats.data() + p, &err);
             platContext.push_back(ctx); // reserved, cannot fail
         }
-        bool algoTests = true;
-        const bool stepTests = true;
-        if(stepTests) algoTests &= StepTests(plats, platContext);
-        if(algoTests) AlgoTests(plats, platContext);
-    } catch(const char *msg) { std::cout<<msg<<std::endl; }
-    catch(const std::string &msg) { std::cout<<msg<<std::endl; }
-    return 0;
+        failed = RunTests(plats, platContext, selection);
+    } catch(const char *msg) { std::cout<<msg<<std::endl;    failed++; }
+    catch(const std::string &msg) { std::cout<<msg<<std::endl;    failed++; }
+    return int(failed);
 }